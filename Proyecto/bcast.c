@@ -0,0 +1,456 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la difusión de las lecturas a los suscriptores locales
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "bcast.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BCAST_SUBSCRIBERS 64 // Suscriptores conectados a la vez
+#define BCAST_WAKE_BATCH 256 // Muestras publicadas entre despertares dentro de una tanda larga
+#define BCAST_CHECK_MS 1000  // Espera máxima de un suscriptor antes de comprobar si el monitor sigue vivo
+
+// Métricas de la difusión
+bcast_metrics bcast_counters;
+
+// 1 si el monitor difunde las lecturas
+int bcast_enabled = 0;
+
+static bcast_ring *ring;            // Buffer de difusión (lectura y escritura, sólo el recolector escribe)
+static size_t ring_size;            // Tamaño del mapeo
+static int readonly_fd = -1;        // Descriptor de sólo lectura que se entrega a los suscriptores
+static uint64_t produced;           // Copia local de head
+static uint64_t woken;              // head en el último despertar
+static unsigned since_wake;         // Muestras publicadas desde el último despertar
+static int64_t batch_ms;            // Hora de llegada de las muestras de la tanda (0 = leerla de nuevo)
+static pthread_t serve_thread;      // Hilo que atiende el socket de suscripción
+static int listen_fd = -1;          // Socket Unix de suscripción
+static int stop_fd = -1;            // eventfd que despierta al hilo para terminar
+
+// Hora actual en milisegundos desde la época.
+static int64_t epoch_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Envía el saludo con el descriptor de sólo lectura del buffer.
+static int send_handshake(int sock_fd) {
+    char text[] = BCAST_HANDSHAKE;
+    struct iovec iov = { text, sizeof(text) - 1 };
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &readonly_fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock_fd, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    return n == (ssize_t)iov.iov_len ? 0 : -1;
+}
+
+// Hilo de suscripción: entrega el buffer a cada suscriptor nuevo y cuenta
+// las conexiones abiertas. No toca las muestras.
+static void *serve_loop(void *param) {
+    (void)param;
+    struct pollfd fds[2 + BCAST_SUBSCRIBERS];
+    int clients[BCAST_SUBSCRIBERS];
+    int count = 0;
+
+    while (1) {
+        fds[0] = (struct pollfd){ .fd = stop_fd, .events = POLLIN };
+        fds[1] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        for (int i = 0; i < count; i++) {
+            fds[2 + i] = (struct pollfd){ .fd = clients[i], .events = POLLIN };
+        }
+
+        int ready = poll(fds, (nfds_t)(2 + count), -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error waiting for subscribers");
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+
+        // Un suscriptor no manda nada: si su conexión se lee, es que se fue.
+        for (int i = count - 1; i >= 0; i--) {
+            if (fds[2 + i].revents) {
+                char discard[64];
+                ssize_t n = read(clients[i], discard, sizeof(discard));
+                if (n <= 0 && !(n == -1 && errno == EINTR)) {
+                    close(clients[i]);
+                    clients[i] = clients[--count];
+                }
+            }
+        }
+
+        if (fds[1].revents) {
+            int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client != -1) {
+                if (count == BCAST_SUBSCRIBERS || send_handshake(client) == -1) {
+                    close(client);
+                } else {
+                    clients[count++] = client;
+                }
+            }
+        }
+        metric_set(&bcast_counters.subscribers, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        close(clients[i]);
+    }
+    metric_set(&bcast_counters.subscribers, 0);
+    return NULL;
+}
+
+// Crea el buffer en un segmento sin nombre (se borra apenas se abre dos
+// veces: lectura y escritura para el recolector, sólo lectura para los
+// suscriptores) y abre el socket de suscripción.
+int bcast_start(const char *socket_path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    char name[64];
+    snprintf(name, sizeof(name), "/monitor-bcast-%d", (int)getpid());
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        perror("Error creating the broadcast buffer");
+        return -1;
+    }
+    readonly_fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    shm_unlink(name);
+
+    ring_size = sizeof(bcast_ring) + (size_t)BCAST_CAPACITY * sizeof(bcast_slot);
+    if (readonly_fd == -1 || ftruncate(fd, (off_t)ring_size) == -1) {
+        perror("Error sizing the broadcast buffer");
+        close(fd);
+        return -1;
+    }
+    ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+        perror("Error mapping the broadcast buffer");
+        ring = NULL;
+        return -1;
+    }
+
+    // ftruncate deja el buffer en ceros: nada publicado y ninguna posición escrita.
+    ring->magic = BCAST_MAGIC;
+    ring->version = BCAST_VERSION;
+    ring->capacity = BCAST_CAPACITY;
+    ring->slot_size = sizeof(bcast_slot);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("Error creating the subscription socket");
+        return -1;
+    }
+
+    // Un socket que quedó de una ejecución anterior impediría el bind.
+    struct stat st;
+    if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(socket_path);
+    }
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listen_fd, 16) == -1) {
+        perror("Error listening on the subscription socket");
+        return -1;
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd == -1 || pthread_create(&serve_thread, NULL, serve_loop, NULL) != 0) {
+        perror("Error starting the subscription thread");
+        return -1;
+    }
+    bcast_enabled = 1;
+    printf("Broadcasting samples on socket: '%s'\n", socket_path);
+    return 0;
+}
+
+// Publica una muestra (sólo el recolector). Nunca espera: si un suscriptor
+// no leyó la posición que se pisa, lo nota él al leerla.
+void bcast_publish(int sensor_type, uint32_t instance, float value, int64_t sent_ns) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // La hora se lee con la primera muestra de la tanda, no al terminar la
+    // anterior: después de una espera larga sería la de la tanda vieja.
+    if (batch_ms == 0) {
+        batch_ms = epoch_ms();
+    }
+
+    uint64_t n = produced;
+    bcast_slot *s = &ring->slots[n & (BCAST_CAPACITY - 1)];
+    atomic_store_explicit(&s->seq, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&s->sensor_type, sensor_type, memory_order_relaxed);
+    atomic_store_explicit(&s->instance, instance, memory_order_relaxed);
+    atomic_store_explicit(&s->value, bits, memory_order_relaxed);
+    atomic_store_explicit(&s->sent_ns, sent_ns, memory_order_relaxed);
+    atomic_store_explicit(&s->when_ms, batch_ms, memory_order_relaxed);
+
+    atomic_store_explicit(&s->seq, 2 * n + 2, memory_order_release);
+    produced = n + 1;
+    atomic_store_explicit(&ring->head, produced, memory_order_release);
+    metric_add(&bcast_counters.published, 1);
+
+    // Dentro de una tanda muy larga también se despierta cada tanto.
+    if (++since_wake >= BCAST_WAKE_BATCH) {
+        bcast_flush();
+    }
+}
+
+// Fin de una tanda del recolector: despierta con una sola llamada a todos los
+// suscriptores que esperan, si hay muestras nuevas y alguien conectado.
+void bcast_flush(void) {
+    batch_ms = 0;
+    if (produced == woken) {
+        return;
+    }
+    woken = produced;
+    since_wake = 0;
+    if (metric_get(&bcast_counters.subscribers) > 0) {
+        atomic_fetch_add_explicit(&ring->wake, 1, memory_order_release);
+        syscall(SYS_futex, &ring->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        metric_add(&bcast_counters.wakeups, 1);
+    }
+}
+
+// Marca el fin de la difusión (después de la última muestra), despierta a
+// los suscriptores y libera el buffer.
+void bcast_stop(void) {
+    if (!bcast_enabled) {
+        return;
+    }
+
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    atomic_fetch_add_explicit(&ring->wake, 1, memory_order_release);
+    syscall(SYS_futex, &ring->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) == -1) {
+        perror("Error stopping the subscription thread");
+    }
+    pthread_join(serve_thread, NULL);
+    close(stop_fd);
+    close(listen_fd);
+    close(readonly_fd);
+    munmap(ring, ring_size);
+    ring = NULL;
+    bcast_enabled = 0;
+}
+
+// Recibe el saludo del monitor con el descriptor del buffer. Devuelve el
+// descriptor o -1.
+static int receive_handshake(int sock_fd) {
+    char text[sizeof(BCAST_HANDSHAKE)];
+    struct iovec iov = { text, sizeof(text) - 1 };
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    ssize_t n;
+    do {
+        n = recvmsg(sock_fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+
+    int fd = -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (n > 0 && cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+        memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (fd != -1 && ((size_t)n != iov.iov_len || memcmp(text, BCAST_HANDSHAKE, iov.iov_len) != 0)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// Se conecta al socket de suscripción del monitor y mapea el buffer sólo
+// para lectura. La primera muestra que se lee es la próxima que se publique.
+int bcast_subscribe(bcast_subscriber *s, const char *socket_path) {
+    memset(s, 0, sizeof(*s));
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    s->sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (s->sock_fd == -1 || connect(s->sock_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        return -1;
+    }
+    int fd = receive_handshake(s->sock_fd);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(bcast_ring)) {
+        if (fd != -1) {
+            close(fd);
+        }
+        close(s->sock_fd);
+        errno = EPROTO;
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    const bcast_ring *r = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) {
+        close(s->sock_fd);
+        return -1;
+    }
+    uint64_t capacity = r->capacity;
+    if (r->magic != BCAST_MAGIC || r->version != BCAST_VERSION || r->slot_size != sizeof(bcast_slot) ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        capacity > (size - sizeof(bcast_ring)) / sizeof(bcast_slot)) {
+        munmap((void *)r, size);
+        close(s->sock_fd);
+        errno = EPROTO;
+        return -1;
+    }
+
+    s->ring = r;
+    s->map_size = size;
+    s->mask = capacity - 1;
+    s->cursor = atomic_load_explicit(&r->head, memory_order_acquire);
+    return 0;
+}
+
+// El suscriptor quedó atrás: salta a la mitad de la vuelta más reciente (así
+// tiene margen antes de que lo vuelvan a pisar) y cuenta las muestras perdidas.
+static void skip_ahead(bcast_subscriber *s) {
+    uint64_t head = atomic_load_explicit(&s->ring->head, memory_order_acquire);
+    uint64_t half = (s->mask + 1) / 2;
+    uint64_t target = head > half ? head - half : 0;
+    if (target <= s->cursor) {
+        target = s->cursor + 1;
+    }
+    s->lost += target - s->cursor;
+    s->cursor = target;
+}
+
+// 1 si el monitor cerró la conexión (terminó sin marcar closed).
+static int monitor_gone(const bcast_subscriber *s) {
+    struct pollfd pfd = { .fd = s->sock_fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0;
+}
+
+// Lee la próxima muestra. Espera hasta timeout_ms (-1 = sin límite) si el
+// suscriptor está al día. Devuelve 1 con una muestra, 0 si no llegó ninguna
+// o -1 si el monitor terminó y no quedan muestras.
+int bcast_next(bcast_subscriber *s, bcast_sample *out, int timeout_ms) {
+    const bcast_ring *r = s->ring;
+    while (1) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (s->cursor != head) {
+            if (head - s->cursor > s->mask + 1) {
+                skip_ahead(s);
+                continue;
+            }
+
+            // La posición está completa si su seq es el de esta vuelta; si
+            // cambió durante la copia, el recolector la pisó con una más nueva.
+            const bcast_slot *slot = &r->slots[s->cursor & s->mask];
+            uint64_t expected = 2 * s->cursor + 2;
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) == expected) {
+                uint32_t bits = atomic_load_explicit(&slot->value, memory_order_relaxed);
+                out->sensor_type = atomic_load_explicit(&slot->sensor_type, memory_order_relaxed);
+                out->instance = atomic_load_explicit(&slot->instance, memory_order_relaxed);
+                out->sent_ns = atomic_load_explicit(&slot->sent_ns, memory_order_relaxed);
+                out->when_ms = atomic_load_explicit(&slot->when_ms, memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == expected) {
+                    memcpy(&out->value, &bits, sizeof(bits));
+                    s->cursor++;
+                    return 1;
+                }
+            }
+            skip_ahead(s);
+            continue;
+        }
+
+        if (atomic_load_explicit(&r->closed, memory_order_acquire)) {
+            return -1;
+        }
+        if (timeout_ms == 0) {
+            return 0;
+        }
+
+        // Al día: se duerme hasta el próximo despertar del recolector. Si
+        // publicó entre medio, wake ya cambió y el futex vuelve enseguida.
+        unsigned wake = atomic_load_explicit(&r->wake, memory_order_acquire);
+        if (atomic_load_explicit(&r->head, memory_order_acquire) != s->cursor) {
+            continue;
+        }
+        int wait_ms = timeout_ms < 0 || timeout_ms > BCAST_CHECK_MS ? BCAST_CHECK_MS : timeout_ms;
+        struct timespec limit = { wait_ms / 1000, (long)(wait_ms % 1000) * 1000000L };
+        if (syscall(SYS_futex, &r->wake, FUTEX_WAIT, wake, &limit, NULL, 0) == -1 && errno == ETIMEDOUT) {
+            if (monitor_gone(s)) {
+                return -1;
+            }
+            if (timeout_ms > 0) {
+                timeout_ms -= wait_ms;
+                if (timeout_ms == 0) {
+                    return 0;
+                }
+            }
+        }
+    }
+}
+
+// Desmapea el buffer y cierra la conexión (el monitor descuenta al suscriptor).
+void bcast_unsubscribe(bcast_subscriber *s) {
+    munmap((void *)s->ring, s->map_size);
+    s->ring = NULL;
+    close(s->sock_fd);
+    s->sock_fd = -1;
+}
@@ -0,0 +1,106 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la difusión de las lecturas a los suscriptores locales
+**************************************************************/
+
+#ifndef BCAST_H
+#define BCAST_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "metrics.h"
+
+// Con "-B <socket>" el recolector copia cada lectura aceptada por el
+// protocolo, una sola vez, a un buffer circular de difusión en memoria
+// compartida. Cada suscriptor (historiador, servicio de alarmas, tablero...)
+// se conecta al socket y recibe un descriptor de sólo lectura del buffer:
+//   suscriptor -> monitor: conexión
+//   monitor -> suscriptor: "bcast\n" + [descriptor del buffer, sólo lectura]
+// Cada suscriptor lleva su propio cursor en su memoria y filtra los tipos que
+// le interesan; no hay copias por suscriptor ni el monitor los espera:
+//   - Cada posición es un seqlock (seq = 2n + 1 mientras se escribe la
+//     muestra n y 2n + 2 al terminar). El recolector nunca espera: si un
+//     suscriptor lento se queda atrás más de una vuelta, sus muestras se
+//     pisan y al notarlo salta hacia adelante y cuenta las perdidas.
+//   - Los suscriptores al día duermen en un futex compartido (wake) que el
+//     recolector incrementa y despierta una vez por tanda de lecturas, y sólo
+//     si hay suscriptores conectados.
+// La conexión queda abierta: el monitor cuenta los suscriptores y el
+// suscriptor nota que el monitor terminó (también por la marca closed).
+
+#define BCAST_MAGIC 0x54534342u // "BCST"
+#define BCAST_VERSION 1         // Versión del formato del buffer
+#define BCAST_CAPACITY 65536    // Muestras del buffer (2 MiB)
+#define BCAST_HANDSHAKE "bcast\n" // Mensaje que acompaña al descriptor
+
+// Muestra tal como la ven los suscriptores
+typedef struct {
+    int sensor_type;   // Tipo de sensor
+    uint32_t instance; // Instancia del sensor
+    float value;       // Valor medido
+    int64_t sent_ns;   // Instante de envío (CLOCK_MONOTONIC en ns, 0 si no se conoce)
+    int64_t when_ms;   // Hora de llegada al monitor (ms desde la época)
+} bcast_sample;
+
+// Posición del buffer (las escribe sólo el recolector)
+typedef struct {
+    atomic_uint_least64_t seq;     // 2n + 1 escribiendo la muestra n; 2n + 2 completa
+    atomic_int sensor_type;        // Tipo de sensor
+    atomic_uint instance;          // Instancia del sensor
+    atomic_uint value;             // Bits del valor (float)
+    atomic_uint reserved;          // Relleno para alinear
+    atomic_int_least64_t sent_ns;  // Instante de envío
+    atomic_int_least64_t when_ms;  // Hora de llegada
+} bcast_slot;
+
+// Encabezado del buffer, seguido de capacity posiciones
+typedef struct {
+    uint32_t magic;     // BCAST_MAGIC
+    uint32_t version;   // BCAST_VERSION
+    uint64_t capacity;  // Posiciones (potencia de 2)
+    uint32_t slot_size; // sizeof(bcast_slot)
+
+    _Alignas(64) atomic_uint_least64_t head; // Muestras publicadas
+    atomic_uint wake;                        // Futex de los suscriptores que esperan
+    atomic_int closed;                       // 1 cuando el monitor terminó
+
+    _Alignas(64) bcast_slot slots[];
+} bcast_ring;
+
+// Métricas de la difusión (las escribe el recolector, salvo subscribers)
+typedef struct {
+    metric_counter published;  // Muestras publicadas
+    metric_counter wakeups;    // Despertares de los suscriptores (uno por tanda)
+    metric_gauge subscribers;  // Suscriptores conectados
+} bcast_metrics;
+
+// Extremo de un suscriptor
+typedef struct {
+    const bcast_ring *ring; // Buffer mapeado sólo para lectura
+    size_t map_size;        // Tamaño del mapeo
+    uint64_t mask;          // Capacidad - 1 (guardada al validar el encabezado)
+    uint64_t cursor;        // Próxima muestra por leer
+    uint64_t lost;          // Muestras pisadas antes de leerlas
+    int sock_fd;            // Conexión con el monitor
+} bcast_subscriber;
+
+// Declaración de variables globales
+extern bcast_metrics bcast_counters; // Métricas de la difusión
+extern int bcast_enabled;            // 1 si el monitor difunde las lecturas
+
+// Prototipos de funciones (monitor)
+int bcast_start(const char *socket_path); // Crea el buffer y atiende a los suscriptores
+void bcast_publish(int sensor_type, uint32_t instance, float value, int64_t sent_ns); // Sólo el recolector
+void bcast_flush(void); // Despierta a los suscriptores si hay muestras nuevas (fin de cada tanda)
+void bcast_stop(void);  // Marca el fin, despierta a los suscriptores y libera
+
+// Prototipos de funciones (suscriptores)
+int bcast_subscribe(bcast_subscriber *s, const char *socket_path); // Se conecta y mapea el buffer
+int bcast_next(bcast_subscriber *s, bcast_sample *out, int timeout_ms); // 1 muestra, 0 sin muestras, -1 fin
+void bcast_unsubscribe(bcast_subscriber *s); // Desmapea y cierra la conexión
+
+#endif // BCAST_H
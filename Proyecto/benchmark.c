@@ -0,0 +1,360 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Banco de pruebas de rendimiento sensor -> pipe -> buffer -> archivo
+**************************************************************/
+
+#include "calib.h"
+#include "protocol.h"
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_PRODUCERS 256 // Máximo de sensores generadores de carga
+
+// Lanza un programa con sus argumentos; si quiet es 1 descarta su salida estándar.
+static pid_t launch(char *const argv[], int quiet) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (quiet && freopen("/dev/null", "w", stdout) == NULL) {
+      _exit(127);
+    }
+    execv(argv[0], argv);
+    perror("Error starting a benchmark process");
+    _exit(127);
+  }
+  if (pid == -1) {
+    perror("Error creating a benchmark process");
+  }
+  return pid;
+}
+
+// Espera a que termine un proceso. Devuelve 0 si salió sin error.
+static int wait_for(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Busca "clave=valor" en el informe del monitor y devuelve el valor.
+static double report_value(const char *report, const char *key) {
+  FILE *f = fopen(report, "r");
+  if (f == NULL) {
+    return 0;
+  }
+  char line[512];
+  size_t len = strlen(key);
+  double value = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strncmp(line, key, len) == 0 && line[len] == '=') {
+      value = atof(line + len + 1);
+    }
+  }
+  fclose(f);
+  return value;
+}
+
+// Instante monotónico en segundos.
+static double seconds_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Decodificación de un registro como la hacía el monitor antes de los lotes
+// (strtol y strtof); es la referencia del camino escalar.
+static int legacy_parse(const char *line, proto_record *rec) {
+  char *end;
+  long type = strtol(line, &end, 10);
+  if (end == line || *end != ':') {
+    return -1;
+  }
+  const char *value = end + 1;
+  rec->value = strtof(value, &end);
+  if (end == value) {
+    return -1;
+  }
+  rec->sensor_type = (int)type;
+  rec->sent_ns = 0;
+  rec->instance = -1;
+  if (*end == ':') {
+    rec->sent_ns = strtoll(end + 1, &end, 10);
+    if (*end == ':') {
+      rec->instance = strtoll(end + 1, &end, 10);
+    }
+  }
+  return *end == '\0' ? 0 : -1;
+}
+
+// Banco del núcleo por lotes (-K), dentro de este proceso: decodificación de
+// registros de texto y calibración con validación de rango, comparando el
+// camino escalar de una lectura por vez con el núcleo de cada ancho.
+static int kernel_bench(long count) {
+  char (*records)[PROTO_MAX_RECORD] = malloc((size_t)count * PROTO_MAX_RECORD);
+  float *raw = malloc((size_t)count * sizeof(float));
+  float *legacy = malloc((size_t)count * sizeof(float));
+  float *values = malloc((size_t)count * sizeof(float));
+  uint64_t *expected = calloc(CALIB_MASK_WORDS((size_t)count), sizeof(uint64_t));
+  uint64_t *accept = malloc(CALIB_MASK_WORDS((size_t)count) * sizeof(uint64_t));
+  if (!records || !raw || !legacy || !values || !expected || !accept) {
+    perror("Error allocating the kernel benchmark data");
+    return 1;
+  }
+
+  // Registros como los de un sensor: valores de 2 decimales, un 10% fuera de rango.
+  srand(1);
+  for (long i = 0; i < count; i++) {
+    float value = 18.0f + (rand() % 1500) / 100.0f;
+    snprintf(records[i], PROTO_MAX_RECORD, "1:%.2f:%lld:%u", value, 1000000000LL + i * 1000, (unsigned)(i % 64));
+  }
+
+  // Decodificación: strtol/strtof contra el lector de dígitos del protocolo.
+  int failed = 0;
+  proto_record rec;
+  double start = seconds_now();
+  for (long i = 0; i < count; i++) {
+    failed |= legacy_parse(records[i], &rec);
+    legacy[i] = rec.value;
+  }
+  double legacy_s = seconds_now() - start;
+  start = seconds_now();
+  for (long i = 0; i < count; i++) {
+    failed |= proto_parse(records[i], &rec);
+    raw[i] = rec.value;
+  }
+  double parse_s = seconds_now() - start;
+  long mismatched = 0;
+  for (long i = 0; i < count; i++) {
+    mismatched += raw[i] != legacy[i];
+  }
+  printf("parse_strtof_samples_per_s=%.0f\n", count / legacy_s);
+  printf("parse_fast_samples_per_s=%.0f\n", count / parse_s);
+  printf("parse_mismatched=%ld\n", mismatched);
+
+  // Calibración y rango: una lectura por vez, como el consumidor antes de los lotes.
+  calib_params p = { 1.0f, 0.0f, 20.0f, 31.6f };
+  int passes = 20;
+  long accepted = 0;
+  start = seconds_now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (long i = 0; i < count; i++) {
+      float value = raw[i] * p.gain + p.offset;
+      legacy[i] = value;
+      if (value < p.min || value > p.max) {
+        continue;
+      }
+      accepted++;
+      expected[i >> 6] |= 1ULL << (i & 63);
+    }
+  }
+  double scalar_s = seconds_now() - start;
+  printf("validate_per_sample_samples_per_s=%.0f accepted=%ld\n", passes * count / scalar_s, accepted / passes);
+
+  // El mismo trabajo con el núcleo por lotes de cada ancho que soporta la CPU.
+  const char *kernels[] = { "scalar", "sse", "avx2" };
+  for (int k = 0; k < 3; k++) {
+    if (calib_select(kernels[k]) == -1) {
+      printf("validate_%s=unsupported\n", kernels[k]);
+      continue;
+    }
+    start = seconds_now();
+    for (int pass = 0; pass < passes; pass++) {
+      for (long i = 0; i < count; i += CALIB_BATCH) {
+        size_t n = count - i < CALIB_BATCH ? (size_t)(count - i) : CALIB_BATCH;
+        calib_batch(raw + i, values + i, n, &p, accept + i / 64);
+      }
+    }
+    double batch_s = seconds_now() - start;
+    long differ = 0;
+    for (long i = 0; i < count; i++) {
+      differ += values[i] != legacy[i] ||
+                ((accept[i >> 6] >> (i & 63)) & 1) != ((expected[i >> 6] >> (i & 63)) & 1);
+    }
+    printf("validate_batch_%s_samples_per_s=%.0f mismatched=%ld\n", kernels[k], passes * count / batch_s, differ);
+    failed |= differ != 0;
+  }
+
+  free(records);
+  free(raw);
+  free(legacy);
+  free(values);
+  free(expected);
+  free(accept);
+  return failed || mismatched ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  int flags;
+  int producers = 4;          // Sensores generadores de carga
+  long count = 100000;        // Lecturas por sensor
+  char *rate = "0";           // Lecturas por segundo de cada sensor (0 = sin pausa)
+  char *buffer_size = "1024"; // Tamaño del buffer de cada canal
+  char *format = "text";      // Formato de los archivos de salida
+  char *transport = "pipe";   // Transporte de los sensores (pipe | shm)
+  char *consumers = "1";      // Consumidores por canal del monitor
+  int kernel = 0;             // 1 para medir sólo el núcleo por lotes, sin procesos
+  char monitor_path[PATH_MAX], sensor_path[PATH_MAX];
+
+  while ((flags = getopt(argc, argv, "P:n:r:b:f:m:j:K")) != -1) {
+    switch (flags) {
+      case 'P': // Bandera de la cantidad de sensores
+        producers = atoi(optarg);
+        break;
+      case 'n': // Bandera de las lecturas por sensor
+        count = atol(optarg);
+        break;
+      case 'r': // Bandera de la tasa de cada sensor
+        rate = optarg;
+        break;
+      case 'b': // Bandera del tamaño del buffer del monitor
+        buffer_size = optarg;
+        break;
+      case 'f': // Bandera del formato de salida del monitor (text | binary)
+        format = optarg;
+        break;
+      case 'm': // Bandera del transporte de los sensores (pipe | shm)
+        transport = optarg;
+        break;
+      case 'j': // Bandera de los consumidores por canal del monitor
+        consumers = optarg;
+        break;
+      case 'K': // Bandera del banco del núcleo de decodificación y validación por lotes
+        kernel = 1;
+        break;
+      default:
+        fprintf(stderr,
+                "Usage: %s [-P producers] [-n samples-per-producer] [-r rate] "
+                "[-b buffer-size] [-f text|binary] [-m pipe|shm] [-j consumers-per-channel] [-K]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+  int use_shm = strcmp(transport, "shm") == 0;
+  if (!use_shm && strcmp(transport, "pipe") != 0) {
+    fprintf(stderr, "Error: Unknown transport '%s' (pipe | shm).\n", transport);
+    return 1;
+  }
+  if (producers <= 0 || producers > MAX_PRODUCERS || count <= 0) {
+    fprintf(stderr, "Error: Invalid number of producers or samples.\n");
+    return 1;
+  }
+  if (kernel) {
+    return kernel_bench(count * producers);
+  }
+
+  // Los programas se buscan junto al banco de pruebas antes de cambiar de directorio
+  if (realpath("./monitor", monitor_path) == NULL || realpath("./sensor", sensor_path) == NULL) {
+    perror("Error locating ./monitor and ./sensor");
+    return 1;
+  }
+
+  // Cada ejecución trabaja en un directorio temporal propio
+  char dir[] = "/tmp/sensor-bench-XXXXXX";
+  if (mkdtemp(dir) == NULL || chdir(dir) == -1) {
+    perror("Error creating the benchmark directory");
+    return 1;
+  }
+
+  // El pipe se crea antes de lanzar los sensores para que puedan abrirlo de inmediato.
+  // Con memoria compartida los sensores se conectan al socket del monitor.
+  if (!use_shm && mkfifo("pipeBENCH", 0666) == -1) {
+    perror("Error creating the benchmark pipe");
+    return 1;
+  }
+
+  char *monitor_argv[] = { monitor_path, "-b", buffer_size, "-t", "bench-temp.txt",
+                           "-h", "bench-ph.txt", use_shm ? "-u" : "-p", "pipeBENCH", "-f", format,
+                           "-R", "bench.report", "-j", consumers, NULL };
+  pid_t monitor = launch(monitor_argv, 1);
+  if (monitor == -1) {
+    return 1;
+  }
+
+  // Esperar (hasta 5 s) a que el monitor cree su socket
+  for (int i = 0; use_shm && i < 500 && access("pipeBENCH", F_OK) == -1; i++) {
+    usleep(10000);
+  }
+
+  // Los sensores se reparten entre temperatura y pH con valores dentro del rango válido
+  char count_arg[32];
+  snprintf(count_arg, sizeof(count_arg), "%ld", count);
+  pid_t sensors[MAX_PRODUCERS];
+  int failed = 0;
+  for (int i = 0; i < producers; i++) {
+    int temperature = i % 2 == 0;
+    char *sensor_argv[] = { sensor_path, "-s", temperature ? "1" : "2", "-r", rate,
+                            "-n", count_arg, "-g", temperature ? "20:30" : "6.5:7.5",
+                            "-p", "pipeBENCH", "-m", transport, NULL };
+    sensors[i] = launch(sensor_argv, 0);
+    if (sensors[i] == -1) {
+      failed = 1;
+      producers = i;
+      break;
+    }
+  }
+  for (int i = 0; i < producers; i++) {
+    if (wait_for(sensors[i]) == -1) {
+      failed = 1;
+    }
+  }
+
+  // El monitor vacía lo pendiente antes de terminar y escribe el informe
+  kill(monitor, SIGTERM);
+  if (wait_for(monitor) == -1) {
+    fprintf(stderr, "Error: The monitor did not exit cleanly.\n");
+    failed = 1;
+  }
+
+  // Mostrar el informe del monitor con los totales del banco de pruebas
+  FILE *report = fopen("bench.report", "r");
+  if (report == NULL) {
+    perror("Error opening the benchmark report");
+    return 1;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), report) != NULL) {
+    fputs(line, stdout);
+  }
+  fclose(report);
+
+  unsigned long long sent = (unsigned long long)producers * (unsigned long long)count;
+  double received = report_value("bench.report", "received");
+  double malformed = report_value("bench.report", "malformed");
+  printf("producers=%d\n", producers);
+  printf("sent=%llu\n", sent);
+  printf("dropped=%.0f\n", sent - received - malformed);
+
+  // Limpiar el directorio temporal
+  unlink("pipeBENCH");
+  unlink("bench-temp.txt");
+  unlink("bench-ph.txt");
+  for (int k = 0;; k++) {
+    // Segmentos de cada consumidor cuando el monitor usa -j
+    char temp_segment[32], ph_segment[32];
+    snprintf(temp_segment, sizeof(temp_segment), "bench-temp.txt.%d", k);
+    snprintf(ph_segment, sizeof(ph_segment), "bench-ph.txt.%d", k);
+    if (unlink(temp_segment) == -1 && unlink(ph_segment) == -1) {
+      break;
+    }
+    unlink(ph_segment);
+  }
+  unlink("bench.report");
+  if (chdir("/") == 0) {
+    rmdir(dir);
+  }
+
+  return failed;
+}
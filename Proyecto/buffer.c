@@ -6,276 +6,215 @@ Tema: Proyecto
 Archivo: Implementación de las funciones de buffer
 **************************************************************/
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <pthread.h>
-#include <semaphore.h>
 #include <time.h>
+#include "buffer.h"
+#include "calib.h"
+#include "channel.h"
+#include "journal.h"
+#include "protocol.h"
+#include "segment.h"
+#include "snapshot.h"
+#include "writer.h"
 
-// Definiciones de banderas para identificar tipos de datos
-//Bandera para datos de temperatura
-#define FLAG_TEMP "TEMP" 
+// Capacidad solicitada para cada buffer (se redondea a potencia de 2)
+int BUFFER_SIZE;
 
-// Bandera para datos de pH
-#define FLAG_PH "PH"
 
-// Arreglos de punteros para los buffers de temperatura y pH
-char **buffertemp, **bufferph;
-
-// Variables globales para el tamaño del buffer y los semáforos y mutex asociados
-int BUFFER_SIZE;            // Tamaño del buffer
-sem_t empty_temp, full_temp, empty_ph, full_ph; // Semáforos para controlar el acceso al buffer
-pthread_mutex_t mutex_temp, mutex_ph;           // Mutex para garantizar la exclusión mutua al acceder al buffer
-
-// Variables para los índices de entrada y salida de los buffers
-int in_temp = 0, out_temp = 0; // Índices de entrada y salida para el buffer de temperatura
-int in_ph = 0, out_ph = 0;     // Índices de entrada y salida para el buffer de pH
-
-// Variables para almacenar los nombres de los archivos de datos de temperatura y pH
-char *file_temp = NULL, *file_ph = NULL;
-
-
-// Función para inicializar los buffers que almacenarán datos de temperatura y pH.
+// Función para inicializar las partes de cada canal configurado y sus buffers.
 void ini_buffers() {
-    // Se asigna memoria para el array de punteros a char que representan los buffers.
-    buffertemp = (char **)malloc(BUFFER_SIZE * sizeof(char *));
-    bufferph = (char **)malloc(BUFFER_SIZE * sizeof(char *));
+    for (int i = 0; i < channel_count; i++) {
+        channel *ch = &channels[i];
+        ch->shards = calloc((size_t)channel_shards, sizeof(channel_shard));
+        if (ch->shards == NULL) {
+            perror("Error allocating memory for buffers");
+            exit(1);
+        }
 
-    // Se verifica si la asignación de memoria fue exitosa.
-    if (!buffertemp || !bufferph) {
-        // Si falla la asignación, se imprime un mensaje de error y se sale del programa.
-        perror("Error allocating memory for buffers");
-        exit(1);
-    }
+        // Cada buffer es un único arreglo contiguo de muestras, sin reservas por posición.
+        for (int k = 0; k < channel_shards; k++) {
+            channel_shard *shard = &ch->shards[k];
+            shard->ch = ch;
+            shard->index = k;
 
-    // Se asigna memoria para cada uno de los buffers individuales.
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        // Se asigna memoria para un buffer individual de tamaño 128 chars.
-        buffertemp[i] = (char *)malloc(128 * sizeof(char));
-        bufferph[i] = (char *)malloc(128 * sizeof(char));
+            // Con varias partes cada una escribe su propio segmento "<archivo>.<índice>".
+            if (channel_shards == 1) {
+                snprintf(shard->file, sizeof(shard->file), "%s", ch->file);
+            } else {
+                snprintf(shard->file, sizeof(shard->file), "%s.%d", ch->file, k);
+            }
 
-        // Se verifica si la asignación de memoria fue exitosa.
-        if (!buffertemp[i] || !bufferph[i]) {
-            // Si falla la asignación, se imprime un mensaje de error y se sale del programa.
-            perror("Error allocating memory for buffers");
-            exit(1);
+            if (BUFFER_SIZE <= 0 || ring_init(&shard->ring, BUFFER_SIZE) == -1) {
+                // Si falla la asignación, se imprime un mensaje de error y se sale del programa.
+                perror("Error allocating memory for buffers");
+                exit(1);
+            }
         }
     }
 }
 
 // Función para liberar la memoria asignada para los buffers
 void free_memory_from_buffers() {
-    // Se libera la memoria asignada para cada buffer individual.
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        free(buffertemp[i]);
-        free(bufferph[i]);
+    for (int i = 0; i < channel_count; i++) {
+        for (int k = 0; k < channel_shards; k++) {
+            ring_destroy(&channels[i].shards[k].ring);
+        }
+        free(channels[i].shards);
+        channels[i].shards = NULL;
     }
-    // Se libera la memoria asignada para los arrays de punteros a char que representan los buffers.
-    free(buffertemp);
-    free(bufferph);
 }
 
-// Función de hilo para recolectar datos de los sensores
-void *recolector(void *param) {
-    // Se obtiene el nombre del pipe desde el parámetro de entrada.
-    char *pipe_name = (char *)param;
-
-    // Se abre el pipe en modo lectura.
-    int fd = open(pipe_name, O_RDONLY);  
-    if (fd == -1) {
-        // Si ocurre un error al abrir el pipe, se imprime un mensaje de error y se sale del programa.
-        perror("Error opening the pipe in the collector");
-        exit(1);
+// El menor de dos plazos en milisegundos (-1 = sin plazo).
+static int earliest(int a, int b) {
+    if (a == -1) {
+        return b;
     }
-
-    // Se declara un buffer para leer los datos del pipe.
-    char read_buffer[1024];
-
-    // Se inicia un bucle para leer continuamente datos del pipe.
-    while (read(fd, read_buffer, sizeof(read_buffer)) > 0) {
-        // Se verifica si el último caracter del buffer es un salto de línea y se reemplaza por un terminador nulo si es necesario.
-        if (read_buffer[strlen(read_buffer) - 1] == '\n') {
-            read_buffer[strlen(read_buffer) - 1] = '\0';
-        }
-
-        // Se divide el contenido del buffer usando el delimitador ":".
-        char *token = strtok(read_buffer, ":");
-        int sensor_type = atoi(token);  
-        token = strtok(NULL, ":");
-        char *data = token;
-
-        // Se verifica el tipo de sensor y se procesa la lectura.
-        if (sensor_type == 1 || sensor_type == 2) { 
-            // Seleccionar los semáforos, mutex y buffers correspondientes según el tipo de sensor.
-            sem_t *empty, *full; 
-            pthread_mutex_t *mutex;  
-            char **buffer;  
-            int *in;  
-
-            if (sensor_type == 1) {
-                empty = &empty_temp;
-                full = &full_temp;
-                mutex = &mutex_temp;
-                buffer = buffertemp;
-                in = &in_temp;
-            } else {
-                empty = &empty_ph;
-                full = &full_ph;
-                mutex = &mutex_ph;
-                buffer = bufferph;
-                in = &in_ph;
-            }
-
-            // Esperar hasta que haya espacio disponible en el buffer.
-            sem_wait(empty);
-
-            // Bloquear el mutex para acceder al buffer de manera segura.
-            pthread_mutex_lock(mutex);  
-
-            // Almacenar los datos en el buffer con un formato específico.
-            sprintf(buffer[*in], "%s:%s", (sensor_type == 1) ? FLAG_TEMP : FLAG_PH, data);
-
-            // Actualizar el índice de entrada del buffer circular.
-            *in = (*in + 1) % BUFFER_SIZE;  
-
-            // Desbloquear el mutex para permitir el acceso a otros hilos.
-            pthread_mutex_unlock(mutex); 
-
-            // Aumentar el contador de elementos en el buffer.
-            sem_post(full);  
-        } else {
-            // Si se recibe una lectura incorrecta, se imprime un mensaje de error.
-          printf("Error: Incorrect measurement received.\n");
-        }
+    if (b == -1) {
+        return a;
     }
+    return a < b ? a : b;
+}
 
-    // Esperar 10 segundos antes de liberar los semáforos de espacio vacío.
-    sleep(10);
-    sem_post(&empty_temp);
-    sem_post(&empty_ph);
-
-    // Cerrar el descriptor del pipe.
-    close(fd);  
-
-    // Terminar la ejecución del hilo.
-    return NULL;
+// Milisegundos hasta el próximo vencimiento de la parte: el lote o la rotación del archivo, los agregados o las alertas.
+static int next_deadline(const segment_writer *output, const channel_shard *shard) {
+    return earliest(earliest(segment_wait_ms(output), stats_wait_ms(&shard->stats)),
+                    detect_wait_ms(&shard->detect));
 }
 
-// Función de hilo para recolectar datos de temperatura
-void *temper_thread_collec() {
-    // Se abre el archivo de temperatura en modo de añadir contenido al final del archivo.
-    FILE *fileData = fopen(file_temp, "a");
-    if (fileData == NULL) {
+// Función de hilo consumidor de una parte de un canal: calibra y valida el rango por lotes y guarda las lecturas aceptadas
+void *channel_thread(void *param) {
+    channel_shard *shard = (channel_shard *)param;
+    channel *ch = shard->ch;
+
+    // Se abre el archivo de la parte en modo de añadir contenido al final del archivo
+    // (con rotación, los segmentos de cada partición se abren con su primera lectura).
+    // Se mide la latencia de extremo a extremo de las lecturas que traen instante de envío.
+    hist_reset(&shard->latency);
+    segment_writer output;
+    if (segment_open(&output, shard->file, &shard->latency, &shard->output) == -1) {
         // Si ocurre un error al abrir el archivo, se imprime un mensaje de error y se sale del programa.
-        perror("Error opening the temperature file");
+        fprintf(stderr, "Error opening the %s file: %s\n", ch->name, shard->file);
         exit(1);
     }
 
-    // Bucle infinito para procesar continuamente los datos de temperatura.
-    while (1) {
-        // Esperar a que haya datos disponibles en el buffer de temperatura.
-        sem_wait(&full_temp);
-
-        // Bloquear el mutex para acceder al buffer de temperatura de manera segura.
-        pthread_mutex_lock(&mutex_temp);
-
-        // Verificar si el dato en el buffer de temperatura es una lectura válida.
-        if (strncmp(buffertemp[out_temp], FLAG_TEMP, strlen(FLAG_TEMP)) == 0) {
-            // Extraer el valor de temperatura del dato en el buffer.
-            char *data = buffertemp[out_temp] + strlen(FLAG_TEMP) + 1;
-
-            // Convertir el dato de temperatura a un número flotante.
-            float temp = atof(data);
-
-            // Obtener la marca de tiempo actual.
-            time_t now = time(NULL);
-            struct tm *tm_info = localtime(&now);
-            char timestamp[20];
-            strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-
-            // Verificar si la temperatura está dentro del rango aceptable.
-            if (temp < 20.0 || temp > 31.6) {
-              printf("Alert: Temperature out of range! %.1f\n",temp);
-            } else {
-              // Escribir la marca de tiempo y el valor de temperatura en el archivo de temperatura.
-              fprintf(fileData, "{%s} %f\n", timestamp, temp);
-              fflush(fileData);
-            }
-        }
-
-        // Actualizar el índice de salida del buffer circular de temperatura.
-        out_temp = (out_temp + 1) % BUFFER_SIZE;
-
-        // Desbloquear el mutex para permitir el acceso a otros hilos.
-        pthread_mutex_unlock(&mutex_temp);
-
-        // Aumentar el contador de espacios vacíos en el buffer de temperatura.
-        sem_post(&empty_temp);
+    // Se preparan las estadísticas móviles y los archivos de agregados del segmento.
+    if (stats_init(&shard->stats, shard->file) == -1) {
+        fprintf(stderr, "Error initializing the %s statistics\n", ch->name);
+        exit(1);
     }
 
-    // Cerrar el archivo de temperatura al finalizar el hilo.
-    fclose(fileData);
-
-    // Terminar la ejecución del hilo.
-    return NULL;
-}
-
-// Función de hilo para recolectar datos de pH
-void *ph_thread_collec() {
-    // Se abre el archivo de pH en modo de añadir contenido al final del archivo.
-    FILE *fileData = fopen(file_ph, "a");
-    if (fileData == NULL) {
-        // Si ocurre un error al abrir el archivo, se imprime un mensaje de error y se sale del programa.
-        perror("Error opening the pH file");
+    // Se prepara la detección de anomalías de los sensores que atiende la parte.
+    if (detect_init(&shard->detect, ch->name, ch->min, ch->max, &ch->detect, &shard->alerts,
+                    &shard->alerts_suppressed) == -1) {
+        fprintf(stderr, "Error initializing the %s anomaly detection\n", ch->name);
         exit(1);
     }
 
-    // Bucle infinito para procesar continuamente los datos de pH.
-    while (1) {
-        // Esperar a que haya datos disponibles en el buffer de pH.
-        sem_wait(&full_ph);
-
-        // Bloquear el mutex para acceder al buffer de pH de manera segura.
-        pthread_mutex_lock(&mutex_ph);
-
-        // Verificar si el dato en el buffer de pH es una lectura válida.
-        if (strncmp(bufferph[out_ph], FLAG_PH, strlen(FLAG_PH)) == 0) {
-            // Extraer el valor de pH del dato en el buffer.
-            char *data = bufferph[out_ph] + strlen(FLAG_PH) + 1; 
-            float ph = atof(data);  
+    // Con diario de ingesta (-J) la parte guarda hasta dónde llegó su archivo.
+    journal_cursor progress = { 0 };
+    if (journal_enabled) {
+        journal_track(&progress, shard, &output);
+    }
 
-            // Obtener la marca de tiempo actual.
-            time_t now = time(NULL);  
-            struct tm *tm_info = localtime(&now);  
-            char timestamp[20];
-            strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);  
+    // Calibración y rango del canal para el núcleo por lotes.
+    calib_params calib = { ch->gain, ch->offset, ch->min, ch->max };
+    sample items[CALIB_BATCH];
+    float raw[CALIB_BATCH], values[CALIB_BATCH];
+    uint64_t accept[CALIB_MASK_WORDS(CALIB_BATCH)];
+
+    // Bucle para procesar los datos de la parte por lotes hasta que se cierre el buffer.
+    // La espera en el buffer se limita al próximo vencimiento (lote pendiente o ventana de agregados).
+    int count;
+    while ((count = ring_pop_batch(&shard->ring, items, CALIB_BATCH, next_deadline(&output, shard))) != 0) {
+        if (count > 0) {
+            size_t n = (size_t)count;
+
+            // La hora y los contadores de rendimiento se actualizan una vez por lote.
+            int64_t now_ms = writer_epoch_ms();
+            int64_t now_ns = proto_now_ns();
+            metric_set(&shard->last_ns, now_ns);
+            if (metric_read(&shard->received) == 0) {
+                shard->first_ns = now_ns;
+            }
+            metric_add(&shard->received, n);
 
-            // Verificar si el pH está dentro del rango aceptable.
-            if (ph < 6 || ph > 8) {
-              printf("Alert: pH out of range! %.1f\n", ph);
-            } else {
-                // Escribir la marca de tiempo y el valor de pH en el archivo de pH.
-                fprintf(fileData, "{%s} %f\n", timestamp, ph);
-                fflush(fileData);  
+            // Calibrar el lote y verificar el rango del tipo de sensor con el núcleo vectorial.
+            for (size_t i = 0; i < n; i++) {
+                raw[i] = items[i].value;
+            }
+            calib_batch(raw, values, n, &calib, accept);
+            uint32_t accepted = calib_count(accept, n);
+            metric_add(&shard->accepted, accepted);
+            metric_add(&shard->out_of_range, n - accepted);
+
+            for (size_t i = 0; i < n; i++) {
+                const sample *item = &items[i];
+                float value = values[i];
+                int in_range = (int)((accept[i >> 6] >> (i & 63)) & 1);
+                // Una muestra reinyectada del diario trae la hora en que llegó antes del fallo.
+                int64_t when_ms = item->when_ms ? item->when_ms : now_ms;
+
+                // Detectores de anomalías del sensor (rango, velocidad, z, CUSUM, trabado);
+                // las alertas van al destino de alertas, no a la salida estándar.
+                uint32_t alarms = detect_sample(&shard->detect, item->instance, value,
+                                                item->sent_ns ? item->sent_ns : now_ns, when_ms);
+
+                // Última lectura del sensor en la tabla de consultas (-L / -Q): la
+                // posición sólo la escribe esta parte y nunca espera a los lectores.
+                if (snapshot_shared) {
+                    snapshot_slot *slot = snapshot_claim(snapshot_shared, ch->id, item->instance);
+                    if (slot) {
+                        snapshot_publish(slot, value, when_ms, alarms | (in_range ? 0 : SNAPSHOT_OUT_OF_RANGE));
+                    }
+                }
+
+                // Agregar la marca de tiempo y el valor aceptado al lote del archivo del
+                // segmento. Las estadísticas móviles y los agregados usan la misma máscara
+                // de rango que la salida, así que describen exactamente lo que se guardó.
+                if (in_range) {
+                    segment_append(&output, when_ms, value, item->sent_ns, item->seq);
+                    stats_add(&shard->stats, value);
+                    stats_rollup(&shard->stats, when_ms, value);
+                }
+                progress.processed = item->seq;
             }
         }
 
-        // Actualizar el índice de salida del buffer circular de pH.
-        out_ph = (out_ph + 1) % BUFFER_SIZE;  
-
-        // Desbloquear el mutex para permitir el acceso a otros hilos.
-        pthread_mutex_unlock(&mutex_ph);
+        // Escribir el lote cuando se cumple su plazo (el tamaño se controla al agregar)
+        // y cerrar la partición cuando termina.
+        segment_flush(&output);
+        stats_flush(&shard->stats);
+        detect_flush(&shard->detect);
+        if (journal_enabled) {
+            journal_progress(&progress, &output);
+        }
+    }
 
-        // Aumentar el contador de espacios vacíos en el buffer de pH.
-        sem_post(&empty_ph);  
+    // Resumen de las estadísticas de la parte (con varias partes se indica cuál).
+    channel_stats *st = &shard->stats;
+    if (st->total.count > 0) {
+        char label[CHANNEL_NAME_LEN + 16];
+        if (channel_shards == 1) {
+            snprintf(label, sizeof(label), "%s", ch->name);
+        } else {
+            snprintf(label, sizeof(label), "%s[%d]", ch->name, shard->index);
+        }
+        printf("%s: count=%llu mean=%.3f stddev=%.3f ewma=%.3f window min=%.3f max=%.3f\n",
+               label, (unsigned long long)st->total.count, st->total.mean,
+               sqrt(stats_variance(st)), st->ewma, stats_window_min(st), stats_window_max(st));
     }
 
-    // Cerrar el archivo de pH al finalizar el hilo.
-    fclose(fileData); 
+    // Escribir lo pendiente y cerrar el archivo del segmento al finalizar el hilo.
+    segment_close(&output);
+    if (journal_enabled) {
+        journal_progress(&progress, &output);
+    }
+    stats_close(&shard->stats);
+    detect_close(&shard->detect);
 
     // Terminar la ejecución del hilo.
     return NULL;
-}
\ No newline at end of file
+}
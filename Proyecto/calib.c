@@ -0,0 +1,126 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la calibración y validación de lecturas por lotes
+**************************************************************/
+
+#include "calib.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CALIB_X86 1
+#endif
+
+// Núcleo de calibración y validación de un lote
+typedef void (*calib_kernel)(const float *in, float *out, size_t n, const calib_params *p, uint64_t *accept);
+
+// Versión escalar: una lectura por iteración. También termina los lotes de
+// las versiones vectoriales cuando n no es múltiplo de su ancho.
+static void batch_scalar_from(const float *in, float *out, size_t from, size_t n, const calib_params *p,
+                              uint64_t *accept) {
+    for (size_t i = from; i < n; i++) {
+        float scaled = in[i] * p->gain;
+        float value = scaled + p->offset;
+        out[i] = value;
+        accept[i >> 6] |= (uint64_t)(value >= p->min && value <= p->max) << (i & 63);
+    }
+}
+
+// Versión escalar completa.
+static void batch_scalar(const float *in, float *out, size_t n, const calib_params *p, uint64_t *accept) {
+    memset(accept, 0, CALIB_MASK_WORDS(n) * sizeof(uint64_t));
+    batch_scalar_from(in, out, 0, n, p, accept);
+}
+
+#ifdef CALIB_X86
+// Versión SSE: 4 lecturas por instrucción. Las comparaciones ordenadas dan
+// falso con NaN, igual que en la versión escalar.
+__attribute__((target("sse2"))) static void batch_sse(const float *in, float *out, size_t n,
+                                                      const calib_params *p, uint64_t *accept) {
+    memset(accept, 0, CALIB_MASK_WORDS(n) * sizeof(uint64_t));
+    __m128 gain = _mm_set1_ps(p->gain);
+    __m128 offset = _mm_set1_ps(p->offset);
+    __m128 min = _mm_set1_ps(p->min);
+    __m128 max = _mm_set1_ps(p->max);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), gain), offset);
+        _mm_storeu_ps(out + i, value);
+        __m128 ok = _mm_and_ps(_mm_cmpge_ps(value, min), _mm_cmple_ps(value, max));
+        accept[i >> 6] |= (uint64_t)_mm_movemask_ps(ok) << (i & 63);
+    }
+    batch_scalar_from(in, out, i, n, p, accept);
+}
+
+// Versión AVX2: 8 lecturas por instrucción.
+__attribute__((target("avx2"))) static void batch_avx2(const float *in, float *out, size_t n,
+                                                      const calib_params *p, uint64_t *accept) {
+    memset(accept, 0, CALIB_MASK_WORDS(n) * sizeof(uint64_t));
+    __m256 gain = _mm256_set1_ps(p->gain);
+    __m256 offset = _mm256_set1_ps(p->offset);
+    __m256 min = _mm256_set1_ps(p->min);
+    __m256 max = _mm256_set1_ps(p->max);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 value = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), gain), offset);
+        _mm256_storeu_ps(out + i, value);
+        __m256 ok = _mm256_and_ps(_mm256_cmp_ps(value, min, _CMP_GE_OQ), _mm256_cmp_ps(value, max, _CMP_LE_OQ));
+        accept[i >> 6] |= (uint64_t)_mm256_movemask_ps(ok) << (i & 63);
+    }
+    batch_scalar_from(in, out, i, n, p, accept);
+}
+#endif
+
+static calib_kernel kernel = batch_scalar; // Núcleo elegido
+static const char *kernel_name = "scalar"; // Nombre del núcleo elegido
+
+// Elige el núcleo por nombre; "auto" toma el más ancho que soporta la CPU.
+// Se llama una vez al iniciar, antes de lanzar los consumidores. Devuelve 0
+// o -1 si el nombre no existe o la CPU no soporta ese núcleo.
+int calib_select(const char *name) {
+    int automatic = strcmp(name, "auto") == 0;
+#ifdef CALIB_X86
+    __builtin_cpu_init();
+    if ((automatic || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        kernel = batch_avx2;
+        kernel_name = "avx2";
+        return 0;
+    }
+    if ((automatic || strcmp(name, "sse") == 0) && __builtin_cpu_supports("sse2")) {
+        kernel = batch_sse;
+        kernel_name = "sse";
+        return 0;
+    }
+#endif
+    if (automatic || strcmp(name, "scalar") == 0) {
+        kernel = batch_scalar;
+        kernel_name = "scalar";
+        return 0;
+    }
+    return -1;
+}
+
+// Nombre del núcleo elegido.
+const char *calib_name(void) {
+    return kernel_name;
+}
+
+// Calibra n lecturas (n <= CALIB_BATCH no es obligatorio; accept debe tener
+// CALIB_MASK_WORDS(n) palabras) y marca en accept las que están en rango.
+void calib_batch(const float *in, float *out, size_t n, const calib_params *p, uint64_t *accept) {
+    kernel(in, out, n, p, accept);
+}
+
+// Lecturas aceptadas de un lote de n (los bits después de n están en cero).
+uint32_t calib_count(const uint64_t *accept, size_t n) {
+    uint32_t total = 0;
+    for (size_t w = 0; w < CALIB_MASK_WORDS(n); w++) {
+        total += (uint32_t)__builtin_popcountll(accept[w]);
+    }
+    return total;
+}
@@ -0,0 +1,42 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la calibración y validación de lecturas por lotes
+**************************************************************/
+
+#ifndef CALIB_H
+#define CALIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cada consumidor desencola lotes de lecturas y los pasa por un único núcleo
+// que trabaja sobre arreglos de valores:
+//   out[i] = in[i] * gain + offset           (conversión de unidades y calibración)
+//   bit i de accept = min <= out[i] <= max   (NaN nunca se acepta)
+// Las lecturas fuera de rango son los bits en cero de accept. El núcleo tiene
+// una versión escalar y, en x86-64, versiones SSE (4 valores por instrucción)
+// y AVX2 (8 valores); la mejor disponible se elige al iniciar según la CPU.
+// Todas hacen la multiplicación y la suma por separado (sin FMA), así que dan
+// exactamente los mismos resultados.
+
+#define CALIB_BATCH 256 // Lecturas que un consumidor procesa por lote
+#define CALIB_MASK_WORDS(n) (((n) + 63) / 64) // Palabras de accept para n lecturas
+
+// Calibración y rango de un canal
+typedef struct {
+    float gain;   // Factor de calibración (1 = sin cambio)
+    float offset; // Desplazamiento de calibración (0 = sin cambio)
+    float min;    // Mínimo aceptado (después de calibrar)
+    float max;    // Máximo aceptado (después de calibrar)
+} calib_params;
+
+// Prototipos de funciones
+int calib_select(const char *name); // Elige el núcleo: "auto", "scalar", "sse" o "avx2"; -1 si no hay
+const char *calib_name(void);       // Núcleo elegido
+void calib_batch(const float *in, float *out, size_t n, const calib_params *p, uint64_t *accept); // Procesa n lecturas
+uint32_t calib_count(const uint64_t *accept, size_t n); // Lecturas aceptadas del lote
+
+#endif // CALIB_H
@@ -0,0 +1,158 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la tabla de tipos de sensor y sus canales
+**************************************************************/
+
+#include "channel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tabla de canales configurados y número de entradas usadas
+channel channels[MAX_SENSOR_TYPES];
+int channel_count = 0;
+int channel_default_policy = OVERLOAD_BLOCK;
+int channel_shards = 1;
+detect_limits channel_default_detect;
+
+// Nombres de las políticas con el buffer lleno, en el orden de OVERLOAD_*
+static const char *policy_names[] = { "block", "drop-oldest", "drop-newest", "coalesce" };
+
+// Índice directo de identificador de tipo a canal, para que el recolector no tenga que buscar
+static channel *channel_by_id[MAX_SENSOR_TYPES];
+
+// Registra un tipo de sensor. Si el identificador ya existe se reemplaza su configuración.
+int channel_add(int id, const char *name, float min, float max, const char *file) {
+    if (id <= 0 || id >= MAX_SENSOR_TYPES) {
+        fprintf(stderr, "Error: Invalid sensor type id %d.\n", id);
+        return -1;
+    }
+
+    channel *ch = channel_by_id[id];
+    if (ch == NULL) {
+        ch = &channels[channel_count++];
+        channel_by_id[id] = ch;
+        ch->policy = channel_default_policy;
+        ch->detect = channel_default_detect;
+        ch->gain = 1;
+        ch->offset = 0;
+    }
+
+    ch->id = id;
+    snprintf(ch->name, sizeof(ch->name), "%s", name);
+    ch->min = min;
+    ch->max = max;
+    snprintf(ch->file, sizeof(ch->file), "%s", file);
+    return 0;
+}
+
+// Aplica una opción de calibración "gain=<factor>" u "offset=<desplazamiento>".
+// Devuelve 1 si la aplicó, 0 si la opción no es de calibración o -1 si el valor no es válido.
+static int parse_calibration(const char *option, float *gain, float *offset) {
+    float *target = strncmp(option, "gain=", 5) == 0 ? gain : strncmp(option, "offset=", 7) == 0 ? offset : NULL;
+    if (target == NULL) {
+        return 0;
+    }
+    const char *text = strchr(option, '=') + 1;
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0' || (target == gain && value == 0)) {
+        return -1;
+    }
+    *target = (float)value;
+    return 1;
+}
+
+// Carga la tabla de tipos desde un archivo con una línea por tipo:
+//   <id> <nombre> <mínimo> <máximo> <archivo> [política] [detector=umbral ...] [gain=<g>] [offset=<o>]
+// La política es opcional (block, drop-oldest, drop-newest o coalesce), los
+// detectores también (rate=, z=, cusum= y stuck=, ver detect.h) y la
+// calibración (cada lectura se guarda como valor * gain + offset y el rango se
+// aplica al valor calibrado). Las líneas vacías y las que empiezan con '#' se ignoran.
+int channels_load(const char *path) {
+    FILE *config = fopen(path, "r");
+    if (config == NULL) {
+        perror("Error opening the sensor configuration file");
+        return -1;
+    }
+
+    char line[512];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), config)) {
+        line_number++;
+
+        // Saltar espacios iniciales, comentarios y líneas vacías.
+        char *start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\0') {
+            continue;
+        }
+
+        int id;
+        float min, max;
+        char name[CHANNEL_NAME_LEN];
+        char file[CHANNEL_FILE_LEN];
+        int used = 0;
+        int fields = sscanf(start, "%d %31s %f %f %255s%n", &id, name, &min, &max, file, &used);
+        if (fields < 5 || min > max) {
+            fprintf(stderr, "Error: Invalid sensor configuration at %s:%d\n", path, line_number);
+            fclose(config);
+            return -1;
+        }
+
+        // Columnas opcionales: la política y los umbrales de los detectores.
+        int policy = channel_default_policy;
+        detect_limits detect = channel_default_detect;
+        float gain = 1, offset = 0;
+        char *save;
+        for (char *option = strtok_r(start + used, " \t\r\n", &save); option;
+             option = strtok_r(NULL, " \t\r\n", &save)) {
+            int calibration = parse_calibration(option, &gain, &offset);
+            int valid = calibration != 0 ? calibration == 1
+                        : strchr(option, '=') ? detect_parse(&detect, option) == 0
+                                              : (policy = channel_policy_parse(option)) != -1;
+            if (!valid) {
+                fprintf(stderr, "Error: Invalid sensor option '%s' at %s:%d\n", option, path, line_number);
+                fclose(config);
+                return -1;
+            }
+        }
+
+        if (channel_add(id, name, min, max, file) == -1) {
+            fclose(config);
+            return -1;
+        }
+        channel_lookup(id)->policy = policy;
+        channel_lookup(id)->detect = detect;
+        channel_lookup(id)->gain = gain;
+        channel_lookup(id)->offset = offset;
+    }
+
+    fclose(config);
+    return 0;
+}
+
+// Devuelve el canal configurado para el tipo de sensor, o NULL si el tipo no existe.
+channel *channel_lookup(int id) {
+    if (id <= 0 || id >= MAX_SENSOR_TYPES) {
+        return NULL;
+    }
+    return channel_by_id[id];
+}
+
+// Devuelve la política OVERLOAD_* con ese nombre, o -1 si no existe.
+int channel_policy_parse(const char *name) {
+    for (int i = 0; i < (int)(sizeof(policy_names) / sizeof(policy_names[0])); i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Devuelve el nombre de una política OVERLOAD_*.
+const char *channel_policy_name(int policy) {
+    return policy_names[policy];
+}
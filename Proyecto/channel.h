@@ -0,0 +1,96 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la tabla de tipos de sensor y sus canales
+**************************************************************/
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <pthread.h>
+#include "detect.h"
+#include "hist.h"
+#include "metrics.h"
+#include "ring.h"
+#include "stats.h"
+
+#define MAX_SENSOR_TYPES 256 // Identificadores de tipo válidos: 1 .. MAX_SENSOR_TYPES - 1
+#define CHANNEL_NAME_LEN 32  // Longitud máxima del nombre de un tipo de sensor
+#define CHANNEL_FILE_LEN 256 // Longitud máxima de la ruta del archivo de salida
+
+// Política de un canal cuando su buffer está lleno (el consumidor va atrasado)
+#define OVERLOAD_BLOCK 0       // Pausar las fuentes que traen muestras del canal hasta que haya espacio
+#define OVERLOAD_DROP_OLDEST 1 // Descartar la muestra más antigua del buffer
+#define OVERLOAD_DROP_NEWEST 2 // Descartar la muestra que llega
+#define OVERLOAD_COALESCE 3    // Guardar sólo la última muestra hasta que haya espacio
+
+#define MAX_SHARDS 64 // Máximo de consumidores por canal
+
+struct channel;
+
+// Parte de un canal atendida por un hilo consumidor propio. Las lecturas de
+// un mismo sensor siempre caen en la misma parte, así que conservan su orden.
+typedef struct {
+    struct channel *ch;          // Canal al que pertenece
+    int index;                   // Posición dentro del canal
+    char file[CHANNEL_FILE_LEN + 16]; // Archivo de segmento ("<archivo>.<índice>" si hay varias partes)
+    spsc_ring ring;              // Buffer entre el recolector y el consumidor
+    pthread_t thread;            // Hilo consumidor
+    channel_stats stats;         // Estadísticas móviles (sólo las usa el consumidor)
+    detector detect;             // Detección de anomalías por sensor (sólo la usa el consumidor)
+    histogram latency;           // Latencia desde el envío en el sensor hasta la escritura en el archivo
+    int64_t first_ns;            // Instante (monotónico) de la primera lectura procesada
+
+    // Métricas en vivo que escribe el consumidor
+    metric_counter received;     // Lecturas procesadas por el consumidor
+    metric_counter accepted;     // Lecturas dentro del rango escritas en el archivo
+    metric_counter out_of_range; // Lecturas fuera del rango
+    metric_gauge last_ns;        // Instante (monotónico) de la última lectura procesada
+    writer_metrics output;       // Escrituras del archivo de segmento
+    metric_counter alerts;       // Alertas emitidas
+    metric_counter alerts_suppressed; // Alertas no emitidas por el límite de frecuencia
+} channel_shard;
+
+// Canal de un tipo de sensor: su configuración y sus partes
+typedef struct channel {
+    int id;                      // Identificador del tipo de sensor en el protocolo
+    char name[CHANNEL_NAME_LEN]; // Nombre legible del tipo (para mensajes)
+    float min, max;              // Rango de valores aceptados (después de calibrar)
+    float gain, offset;          // Calibración de las lecturas: valor * gain + offset
+    char file[CHANNEL_FILE_LEN]; // Archivo donde se guardan las lecturas aceptadas
+    int policy;                  // Política con el buffer lleno (OVERLOAD_*)
+    detect_limits detect;        // Umbrales de los detectores de anomalías
+    channel_shard *shards;       // channel_shards partes, cada una con su buffer y su consumidor
+
+    // Métricas en vivo que escribe el recolector
+    metric_counter pushed;       // Lecturas encoladas en el buffer
+    metric_counter push_blocked; // Veces que el buffer lleno pausó una fuente (política block)
+    metric_hist push_wait;       // Tiempo que una fuente estuvo pausada por el buffer lleno
+    metric_counter dropped;      // Lecturas descartadas por las políticas drop-oldest y drop-newest
+    metric_counter coalesced;    // Lecturas reemplazadas por una más nueva (política coalesce)
+} channel;
+
+// Declaración de variables globales
+extern channel channels[MAX_SENSOR_TYPES]; // Tabla de canales configurados
+extern int channel_count;                  // Número de canales configurados
+extern int channel_default_policy;         // Política de los canales que no indican una
+extern detect_limits channel_default_detect; // Detectores de los canales que no indican otros
+extern int channel_shards;                 // Partes (consumidores) de cada canal
+
+// Parte del canal que atiende al sensor con ese identificador de instancia.
+// El hash multiplicativo reparte bien identificadores consecutivos (PID, conexiones).
+static inline channel_shard *channel_route(channel *ch, uint32_t instance) {
+    uint32_t hash = (uint32_t)(((uint64_t)instance * 0x9E3779B97F4A7C15ULL) >> 32);
+    return &ch->shards[hash % (uint32_t)channel_shards];
+}
+
+// Prototipos de funciones
+int channel_add(int id, const char *name, float min, float max, const char *file); // Registra un tipo
+int channels_load(const char *path);   // Carga la tabla de tipos desde un archivo de configuración
+channel *channel_lookup(int id);       // Busca el canal de un tipo; NULL si no está configurado
+int channel_policy_parse(const char *name); // Política por nombre; -1 si no existe
+const char *channel_policy_name(int policy); // Nombre de una política
+
+#endif // CHANNEL_H
@@ -0,0 +1,271 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del códec de compresión de los segmentos cerrados
+**************************************************************/
+
+#include "codec.h"
+#include <string.h>
+
+#define VARINT_MAX 10 // Bytes máximos de un entero de 64 bits en varint
+
+// Escritor de bits, del más significativo al menos significativo
+typedef struct {
+    unsigned char *out; // Destino
+    size_t bytes;       // Bytes completos escritos
+    uint64_t acc;       // Bits pendientes (los últimos `bits` bits)
+    int bits;           // Cantidad de bits pendientes (menos de 8 entre llamadas)
+} bit_writer;
+
+// Lector de bits con límite: nunca lee fuera de la columna
+typedef struct {
+    const unsigned char *in; // Origen
+    size_t size;             // Bytes de la columna
+    size_t pos;              // Próximo byte por leer
+    uint64_t acc;            // Bits leídos todavía no consumidos
+    int bits;                // Cantidad de bits no consumidos
+} bit_reader;
+
+// Escribe los n bits menos significativos de value (n <= 32).
+static void put_bits(bit_writer *w, uint32_t value, int n) {
+    w->acc = (w->acc << n) | ((uint64_t)value & ((1ULL << n) - 1));
+    w->bits += n;
+    while (w->bits >= 8) {
+        w->bits -= 8;
+        w->out[w->bytes++] = (unsigned char)(w->acc >> w->bits);
+    }
+}
+
+// Completa el último byte con ceros.
+static void flush_bits(bit_writer *w) {
+    if (w->bits > 0) {
+        w->out[w->bytes++] = (unsigned char)(w->acc << (8 - w->bits));
+        w->bits = 0;
+    }
+}
+
+// Lee n bits (n <= 32). Devuelve 0 o -1 si la columna se terminó.
+static int get_bits(bit_reader *r, int n, uint32_t *value) {
+    while (r->bits < n) {
+        if (r->pos == r->size) {
+            return -1;
+        }
+        r->acc = (r->acc << 8) | r->in[r->pos++];
+        r->bits += 8;
+    }
+    r->bits -= n;
+    *value = (uint32_t)((r->acc >> r->bits) & ((1ULL << n) - 1));
+    return 0;
+}
+
+// Zigzag: los enteros chicos (positivos o negativos) quedan como enteros chicos sin signo.
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+// Inverso de zigzag.
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Escribe v en varint (7 bits por byte, el bit alto indica que sigue otro byte).
+static size_t put_varint(unsigned char *out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
+}
+
+// Lee un varint sin pasar de end. Devuelve dónde termina o NULL si está incompleto.
+static const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, uint64_t *v) {
+    uint64_t result = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// Bits de un float como entero.
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Tamaño máximo de un bloque comprimido: un varint completo por tiempo y, por
+// valor, 2 bits de control + 5 de ceros iniciales + 5 de longitud + 32 de datos.
+size_t codec_bound(uint32_t count) {
+    return sizeof(codec_block_header) + (size_t)count * VARINT_MAX + ((size_t)count * 44 + 7) / 8 + 8;
+}
+
+// Comprime count lecturas (1..LOG_BLOCK_MAX) en out, que debe tener codec_bound(count)
+// bytes, y devuelve el tamaño del bloque.
+size_t codec_encode(const int64_t *ms, const float *values, uint32_t count, void *out) {
+    codec_block_header header = {
+        .magic = CODEC_MAGIC,
+        .count = count,
+        .first_ms = ms[0],
+        .last_ms = ms[count - 1],
+        .min = values[0],
+        .max = values[0],
+    };
+    unsigned char *columns = (unsigned char *)out + sizeof(header);
+
+    // Columna de tiempos: la primera marca va en la cabecera; después la
+    // diferencia de la segunda y, desde la tercera, la variación de la diferencia.
+    size_t time_bytes = 0;
+    int64_t prev_delta = 0;
+    for (uint32_t i = 1; i < count; i++) {
+        int64_t delta = ms[i] - ms[i - 1];
+        time_bytes += put_varint(columns + time_bytes, zigzag(delta - prev_delta));
+        prev_delta = delta;
+    }
+
+    // Columna de valores: el primero completo y luego el XOR con el anterior.
+    // Si los bits significativos caben en la ventana del XOR anterior se reusa
+    // ("10"); si no, se escribe una ventana nueva ("11" + ceros + longitud).
+    bit_writer w = { columns + time_bytes, 0, 0, 0 };
+    uint32_t prev = float_bits(values[0]);
+    put_bits(&w, prev, 32);
+    int prev_lead = -1, prev_trail = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        header.sum += values[i];
+        header.min = values[i] < header.min ? values[i] : header.min;
+        header.max = values[i] > header.max ? values[i] : header.max;
+        if (i == 0) {
+            continue;
+        }
+
+        uint32_t cur = float_bits(values[i]);
+        uint32_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            put_bits(&w, 0, 1);
+            continue;
+        }
+        int lead = __builtin_clz(x);
+        int trail = __builtin_ctz(x);
+        if (prev_lead >= 0 && lead >= prev_lead && trail >= prev_trail) {
+            put_bits(&w, 2, 2);
+            put_bits(&w, x >> prev_trail, 32 - prev_lead - prev_trail);
+        } else {
+            int len = 32 - lead - trail;
+            put_bits(&w, 3, 2);
+            put_bits(&w, (uint32_t)lead, 5);
+            put_bits(&w, (uint32_t)(len - 1), 5);
+            put_bits(&w, x >> trail, len);
+            prev_lead = lead;
+            prev_trail = trail;
+        }
+    }
+    flush_bits(&w);
+
+    header.time_bytes = (uint32_t)time_bytes;
+    header.value_bytes = (uint32_t)w.bytes;
+    memcpy(out, &header, sizeof(header));
+
+    // Relleno en ceros hasta el múltiplo de 8 para alinear la cabecera siguiente.
+    size_t size = codec_block_size(&header);
+    size_t used = sizeof(header) + time_bytes + w.bytes;
+    memset((unsigned char *)out + used, 0, size - used);
+    return size;
+}
+
+// Descomprime un bloque validado por codec_next_block en ms y values (h->count
+// posiciones cada uno). Devuelve 0 o -1 si las columnas están dañadas.
+int codec_decode(const codec_block_header *h, int64_t *ms, float *values) {
+    const unsigned char *p = (const unsigned char *)(h + 1);
+    const unsigned char *time_end = p + h->time_bytes;
+
+    ms[0] = h->first_ms;
+    int64_t delta = 0;
+    for (uint32_t i = 1; i < h->count; i++) {
+        uint64_t encoded;
+        p = get_varint(p, time_end, &encoded);
+        if (p == NULL) {
+            return -1;
+        }
+        delta += unzigzag(encoded);
+        ms[i] = ms[i - 1] + delta;
+    }
+
+    bit_reader r = { time_end, h->value_bytes, 0, 0, 0 };
+    uint32_t prev;
+    if (get_bits(&r, 32, &prev) == -1) {
+        return -1;
+    }
+    memcpy(&values[0], &prev, sizeof(prev));
+
+    int prev_lead = -1, prev_trail = 0;
+    for (uint32_t i = 1; i < h->count; i++) {
+        uint32_t control, x;
+        if (get_bits(&r, 1, &control) == -1) {
+            return -1;
+        }
+        if (control == 1) {
+            if (get_bits(&r, 1, &control) == -1) {
+                return -1;
+            }
+            if (control == 1) {
+                uint32_t lead, len;
+                if (get_bits(&r, 5, &lead) == -1 || get_bits(&r, 5, &len) == -1) {
+                    return -1;
+                }
+                len++;
+                if (lead + len > 32) {
+                    return -1;
+                }
+                prev_lead = (int)lead;
+                prev_trail = 32 - (int)lead - (int)len;
+            } else if (prev_lead < 0) {
+                return -1;
+            }
+            if (get_bits(&r, 32 - prev_lead - prev_trail, &x) == -1) {
+                return -1;
+            }
+            prev ^= x << prev_trail;
+        }
+        memcpy(&values[i], &prev, sizeof(prev));
+    }
+    return 0;
+}
+
+// Devuelve el bloque comprimido que empieza en *offset y avanza offset al
+// siguiente. Devuelve NULL al final del archivo o si el bloque está incompleto o dañado.
+const codec_block_header *codec_next_block(const log_map *map, size_t *offset) {
+    if (*offset + sizeof(codec_block_header) > map->size) {
+        return NULL;
+    }
+
+    const codec_block_header *h = (const codec_block_header *)(map->data + *offset);
+    if (h->magic != CODEC_MAGIC || h->count == 0 || h->count > LOG_BLOCK_MAX ||
+        h->time_bytes > (size_t)h->count * VARINT_MAX || h->value_bytes > ((size_t)h->count * 44 + 7) / 8 + 4) {
+        return NULL;
+    }
+    if (*offset + codec_block_size(h) > map->size) {
+        return NULL;
+    }
+
+    *offset += codec_block_size(h);
+    return h;
+}
+
+// Indica si el archivo proyectado es un segmento comprimido.
+int codec_is_compressed(const log_map *map) {
+    uint32_t magic;
+    if (map->size < sizeof(magic)) {
+        return 0;
+    }
+    memcpy(&magic, map->data, sizeof(magic));
+    return magic == CODEC_MAGIC;
+}
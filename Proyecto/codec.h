@@ -0,0 +1,51 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del códec de compresión de los segmentos cerrados
+**************************************************************/
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "logfmt.h"
+
+// Un segmento comprimido ("<segmento>.z") es una secuencia de bloques de hasta
+// LOG_BLOCK_MAX lecturas. Cada bloque tiene una cabecera con el mismo resumen
+// que los bloques binarios (para saltarlo sin descomprimirlo) y dos columnas:
+//   tiempos  diferencia entre diferencias de marcas de tiempo consecutivas, en
+//            zigzag + varint (lecturas a intervalo fijo ocupan 1 byte cada una)
+//   valores  XOR de cada float con el anterior al estilo Gorilla: 1 bit si el
+//            valor se repite y, si no, sólo los bits significativos del XOR
+// La compresión no pierde información: se recuperan exactamente las mismas lecturas.
+
+#define CODEC_MAGIC 0x5A474C53u // "SLGZ" en little endian
+
+// Cabecera de cada bloque comprimido (48 bytes; el bloque se rellena a múltiplo de 8)
+typedef struct {
+    uint32_t magic;       // CODEC_MAGIC
+    uint32_t count;       // Lecturas en el bloque
+    int64_t first_ms;     // Marca de tiempo de la primera lectura (ms desde la época)
+    int64_t last_ms;      // Marca de tiempo de la última lectura
+    double sum;           // Suma de los valores
+    float min, max;       // Valor mínimo y máximo
+    uint32_t time_bytes;  // Bytes de la columna de tiempos
+    uint32_t value_bytes; // Bytes de la columna de valores
+} codec_block_header;
+
+// Tamaño en bytes de un bloque comprimido.
+static inline size_t codec_block_size(const codec_block_header *h) {
+    return sizeof(codec_block_header) + (((size_t)h->time_bytes + h->value_bytes + 7) & ~(size_t)7);
+}
+
+// Prototipos de funciones
+size_t codec_bound(uint32_t count); // Tamaño máximo de un bloque comprimido con count lecturas
+size_t codec_encode(const int64_t *ms, const float *values, uint32_t count, void *out); // Comprime; devuelve el tamaño
+int codec_decode(const codec_block_header *h, int64_t *ms, float *values); // Descomprime; -1 si está dañado
+const codec_block_header *codec_next_block(const log_map *map, size_t *offset); // Siguiente bloque válido o NULL
+int codec_is_compressed(const log_map *map); // 1 si el archivo empieza con un bloque comprimido
+
+#endif // CODEC_H
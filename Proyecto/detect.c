@@ -0,0 +1,286 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la detección de anomalías de cada canal
+**************************************************************/
+
+#include "detect.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Configuración por defecto: alertas por salida estándar, 20 por segundo, 10 lecturas para despejar
+detect_config detect_settings = { "-", 20, 10, 30, 0.05, 0.5 };
+
+// Nombres de los detectores, en el orden de detect_kind
+static const char *kind_names[DETECT_KINDS] = DETECT_KIND_NAMES;
+
+// Aplica una lista "clave=valor[,clave=valor...]" con las claves rate, z, cusum y stuck.
+// Devuelve 0 o -1 si alguna clave o valor no es válido.
+int detect_parse(detect_limits *limits, const char *spec) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+
+    char *save;
+    for (char *item = strtok_r(copy, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *equals = strchr(item, '=');
+        if (equals == NULL) {
+            return -1;
+        }
+        *equals = '\0';
+        char *end;
+        double value = strtod(equals + 1, &end);
+        if (end == equals + 1 || *end != '\0' || value < 0) {
+            return -1;
+        }
+
+        if (strcmp(item, "rate") == 0) {
+            limits->max_rate = value;
+        } else if (strcmp(item, "z") == 0) {
+            limits->z_limit = value;
+        } else if (strcmp(item, "cusum") == 0) {
+            limits->cusum_h = value;
+        } else if (strcmp(item, "stuck") == 0) {
+            limits->stuck = (uint32_t)value;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Prepara la etapa de detección de un consumidor. La tabla de sensores se
+// reserva una sola vez; después no se reserva memoria por lectura.
+int detect_init(detector *d, const char *channel, float min, float max, const detect_limits *limits,
+                metric_counter *raised, metric_counter *dropped) {
+    memset(d, 0, sizeof(*d));
+    d->channel = channel;
+    d->min = min;
+    d->max = max;
+    d->limits = *limits;
+    d->raised = raised;
+    d->dropped = dropped;
+    d->tokens = detect_settings.max_per_s;
+
+    // La desviación mínima es una milésima del rango del canal.
+    d->floor = (max - min) * 1e-3;
+    if (d->floor <= 0) {
+        d->floor = 1e-6;
+    }
+
+    d->sensors = calloc(DETECT_SENSORS, sizeof(detect_sensor));
+    return d->sensors ? 0 : -1;
+}
+
+// Devuelve el estado del sensor. Si no está en la tabla ocupa una posición
+// libre o, si las DETECT_PROBES posiciones posibles están ocupadas, reemplaza
+// al sensor que lleva más tiempo sin enviar lecturas.
+static detect_sensor *find_sensor(detector *d, uint32_t instance, int64_t when_ns) {
+    uint32_t hash = instance * 0x85EBCA6Bu;
+    hash ^= hash >> 16;
+    detect_sensor *victim = NULL;
+
+    for (uint32_t i = 0; i < DETECT_PROBES; i++) {
+        detect_sensor *s = &d->sensors[(hash + i) & (DETECT_SENSORS - 1)];
+        if (s->used && s->instance == instance) {
+            return s;
+        }
+        if (!s->used) {
+            victim = s;
+            break;
+        }
+        if (victim == NULL || s->seen_ns < victim->seen_ns) {
+            victim = s;
+        }
+    }
+
+    memset(victim, 0, sizeof(*victim));
+    victim->used = 1;
+    victim->instance = instance;
+    victim->seen_ns = when_ns;
+    return victim;
+}
+
+// Abre el destino de las alertas la primera vez que se necesita. Con "-" se
+// escribe en una copia del descriptor de la salida estándar.
+static int open_sink(detector *d) {
+    if (d->sink_open) {
+        return d->sink_open == 1 ? 0 : -1;
+    }
+
+    int result;
+    if (strcmp(detect_settings.sink_path, "-") == 0) {
+        int fd = dup(STDOUT_FILENO);
+        result = fd == -1 ? -1 : writer_attach(&d->sink, fd, WRITER_FORMAT_TEXT);
+    } else {
+        result = writer_open_as(&d->sink, detect_settings.sink_path, WRITER_FORMAT_TEXT);
+    }
+    if (result == -1) {
+        fprintf(stderr, "Error opening the alert sink: %s\n", detect_settings.sink_path);
+        d->sink_open = -1;
+        return -1;
+    }
+    d->sink_open = 1;
+    return 0;
+}
+
+// Escribe una alerta si el límite de frecuencia lo permite (cubeta de permisos
+// que se recarga a max_per_s por segundo). Si no, sólo se cuenta.
+static void emit(detector *d, const detect_sensor *s, int kind, int raised, float value, double score,
+                 double limit, int64_t when_ns, int64_t now_ms) {
+    if (detect_settings.max_per_s > 0) {
+        if (d->refill_ns != 0) {
+            d->tokens += (when_ns - d->refill_ns) / 1e9 * detect_settings.max_per_s;
+            if (d->tokens > detect_settings.max_per_s) {
+                d->tokens = detect_settings.max_per_s;
+            }
+        }
+        d->refill_ns = when_ns;
+        if (d->tokens < 1) {
+            d->suppressed++;
+            metric_add(d->dropped, 1);
+            return;
+        }
+        d->tokens -= 1;
+    }
+    if (open_sink(d) == -1) {
+        return;
+    }
+
+    size_t stamp_len;
+    const char *stamp = writer_stamp(&d->sink, (time_t)(now_ms / 1000), &stamp_len);
+    char line[256];
+    memcpy(line, stamp, stamp_len);
+    int n = snprintf(line + stamp_len, sizeof(line) - stamp_len,
+                     " alert=%s state=%s channel=%s instance=%u value=%f score=%.3f limit=%.3f "
+                     "suppressed=%llu\n",
+                     kind_names[kind], raised ? "raised" : "cleared", d->channel, s->instance, value,
+                     score, limit, (unsigned long long)d->suppressed);
+    if (n > 0 && (size_t)n < sizeof(line) - stamp_len) {
+        writer_append(&d->sink, line, stamp_len + (size_t)n);
+        metric_add(d->raised, 1);
+        d->suppressed = 0;
+    }
+}
+
+// Histéresis: la alerta se activa con la primera lectura anómala y se despeja
+// después de clear_samples lecturas normales seguidas.
+static void check(detector *d, detect_sensor *s, int kind, int anomalous, float value, double score,
+                  double limit, int64_t when_ns, int64_t now_ms) {
+    if (anomalous) {
+        s->calm[kind] = 0;
+        if (!s->active[kind]) {
+            s->active[kind] = 1;
+            emit(d, s, kind, 1, value, score, limit, when_ns, now_ms);
+        }
+    } else if (s->active[kind] && ++s->calm[kind] >= detect_settings.clear_samples) {
+        s->active[kind] = 0;
+        s->calm[kind] = 0;
+        emit(d, s, kind, 0, value, score, limit, when_ns, now_ms);
+    }
+}
+
+// Evalúa una lectura del sensor instance con todos los detectores del canal.
+// when_ns es el instante (monotónico) de la lectura y now_ms la hora de las alertas.
+// Devuelve las alertas activas del sensor (bit i = detector i de detect_kind).
+uint32_t detect_sample(detector *d, uint32_t instance, float value, int64_t when_ns, int64_t now_ms) {
+    detect_sensor *s = find_sensor(d, instance, when_ns);
+    const detect_limits *limits = &d->limits;
+
+    // Rango del tipo de sensor.
+    int low = value < d->min;
+    check(d, s, DETECT_RANGE, low || value > d->max, value, value, low ? d->min : d->max, when_ns, now_ms);
+
+    // Velocidad de cambio respecto de la lectura anterior (al menos 1 ms entre lecturas).
+    if (limits->max_rate > 0 && s->count > 0) {
+        double seconds = (when_ns - s->last_ns) / 1e9;
+        if (seconds < 1e-3) {
+            seconds = 1e-3;
+        }
+        double rate = fabs(value - s->last) / seconds;
+        check(d, s, DETECT_RATE, rate > limits->max_rate, value, rate, limits->max_rate, when_ns, now_ms);
+    }
+
+    // Puntaje z respecto de la media y varianza móviles anteriores a esta lectura.
+    if (limits->z_limit > 0 && s->count >= (uint64_t)detect_settings.warmup) {
+        double deviation = sqrt(s->var);
+        if (deviation < d->floor) {
+            deviation = d->floor;
+        }
+        double z = (value - s->mean) / deviation;
+        check(d, s, DETECT_ZSCORE, fabs(z) > limits->z_limit, value, z, limits->z_limit, when_ns, now_ms);
+    }
+
+    // CUSUM: las primeras lecturas fijan la línea base; después se acumulan los
+    // desvíos (en desviaciones de la línea base) que superan la holgura k.
+    if (limits->cusum_h > 0) {
+        if (s->count < (uint64_t)detect_settings.warmup) {
+            double delta = value - s->base_mean;
+            s->base_mean += delta / (double)(s->count + 1);
+            s->base_m2 += delta * (value - s->base_mean);
+        } else {
+            double deviation = sqrt(s->base_m2 / (detect_settings.warmup - 1));
+            if (deviation < d->floor) {
+                deviation = d->floor;
+            }
+            double z = (value - s->base_mean) / deviation;
+            s->cusum_hi = fmax(0, s->cusum_hi + z - detect_settings.cusum_k);
+            s->cusum_lo = fmax(0, s->cusum_lo - z - detect_settings.cusum_k);
+            double score = fmax(s->cusum_hi, s->cusum_lo);
+            check(d, s, DETECT_CUSUM, score > limits->cusum_h, value, score, limits->cusum_h, when_ns, now_ms);
+        }
+    }
+
+    // Sensor trabado: el mismo valor muchas veces seguidas (varianza nula en la ventana).
+    if (limits->stuck > 0) {
+        s->run = s->count > 0 && value == s->last ? s->run + 1 : 1;
+        check(d, s, DETECT_STUCK, s->run >= limits->stuck, value, s->run, limits->stuck, when_ns, now_ms);
+    }
+
+    // Media y varianza móviles exponenciales.
+    if (s->count == 0) {
+        s->mean = value;
+        s->var = 0;
+    } else {
+        double diff = value - s->mean;
+        double increment = detect_settings.alpha * diff;
+        s->mean += increment;
+        s->var = (1 - detect_settings.alpha) * (s->var + diff * increment);
+    }
+    s->last = value;
+    s->last_ns = when_ns;
+    s->seen_ns = when_ns;
+    s->count++;
+
+    uint32_t alarms = 0;
+    for (int kind = 0; kind < DETECT_KINDS; kind++) {
+        alarms |= (uint32_t)s->active[kind] << kind;
+    }
+    return alarms;
+}
+
+// Milisegundos hasta que deban escribirse las alertas pendientes, o -1 si no hay.
+int detect_wait_ms(const detector *d) {
+    return d->sink_open == 1 ? writer_wait_ms(&d->sink) : -1;
+}
+
+// Escribe las alertas pendientes si ya se cumplió su plazo.
+void detect_flush(detector *d) {
+    if (d->sink_open == 1 && writer_wait_ms(&d->sink) == 0) {
+        writer_flush(&d->sink);
+    }
+}
+
+// Escribe las alertas pendientes, cierra el destino y libera la tabla de sensores.
+void detect_close(detector *d) {
+    if (d->sink_open == 1) {
+        writer_close(&d->sink);
+    }
+    d->sink_open = 0;
+    free(d->sensors);
+    d->sensors = NULL;
+}
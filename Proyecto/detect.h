@@ -0,0 +1,102 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la detección de anomalías de cada canal
+**************************************************************/
+
+#ifndef DETECT_H
+#define DETECT_H
+
+#include <stdint.h>
+#include "metrics.h"
+#include "writer.h"
+
+// Cada consumidor sigue a los sensores que le tocan con una tabla de tamaño
+// fijo: el estado de un sensor ocupa O(1) memoria y se actualiza en O(1) por
+// lectura, sin reservar memoria. Los detectores de un canal son:
+//   range   el valor sale del rango del tipo de sensor
+//   rate    el valor cambia más rápido que rate=<unidades por segundo>
+//   zscore  el valor se aleja más de z=<desviaciones> de la media móvil exponencial
+//   cusum   la suma acumulada de desvíos respecto de la línea base supera cusum=<h>
+//   stuck   el sensor repite el mismo valor stuck=<lecturas> veces seguidas
+// Una alerta se emite al activarse y otra al despejarse, después de
+// detect_settings.clear_samples lecturas normales seguidas (histéresis).
+// Cada consumidor emite a lo sumo detect_settings.max_per_s alertas por
+// segundo; las que no se emiten se cuentan y se informan en la siguiente.
+
+#define DETECT_SENSORS 1024 // Sensores seguidos por cada consumidor (potencia de 2)
+#define DETECT_PROBES 8     // Posiciones que se prueban en la tabla antes de reemplazar una
+
+// Detectores disponibles
+enum detect_kind { DETECT_RANGE, DETECT_RATE, DETECT_ZSCORE, DETECT_CUSUM, DETECT_STUCK, DETECT_KINDS };
+
+// Nombres de los detectores, en el orden de detect_kind
+#define DETECT_KIND_NAMES { "range", "rate", "zscore", "cusum", "stuck" }
+
+// Umbrales de los detectores de un canal (0 = detector apagado)
+typedef struct {
+    double max_rate; // Cambio máximo por segundo
+    double z_limit;  // Desviaciones máximas respecto de la media móvil
+    double cusum_h;  // Umbral de la suma acumulada (en desviaciones de la línea base)
+    uint32_t stuck;  // Lecturas idénticas seguidas que indican un sensor trabado
+} detect_limits;
+
+// Estado de un sensor dentro de un consumidor
+typedef struct {
+    uint32_t instance;  // Instancia del sensor
+    int used;           // 1 si la posición está ocupada
+    int64_t seen_ns;    // Última lectura del sensor (para elegir a quién reemplazar)
+    uint64_t count;     // Lecturas vistas
+    float last;         // Último valor
+    int64_t last_ns;    // Instante del último valor
+    double mean, var;   // Media y varianza móviles exponenciales
+    double base_mean;   // Línea base de CUSUM (media de las primeras lecturas)
+    double base_m2;     // Suma de cuadrados de la línea base (Welford)
+    double cusum_hi;    // Suma acumulada de desvíos hacia arriba
+    double cusum_lo;    // Suma acumulada de desvíos hacia abajo
+    uint32_t run;       // Lecturas seguidas con el mismo valor
+    uint8_t active[DETECT_KINDS]; // 1 si la alerta de cada detector está activa
+    uint16_t calm[DETECT_KINDS];  // Lecturas normales seguidas desde la última anómala
+} detect_sensor;
+
+// Etapa de detección de un consumidor
+typedef struct {
+    const char *channel;     // Nombre del canal (para las alertas)
+    float min, max;          // Rango del canal
+    detect_limits limits;    // Umbrales del canal
+    double floor;            // Desviación mínima (evita dividir por una varianza nula)
+    detect_sensor *sensors;  // Tabla de DETECT_SENSORS sensores
+    batch_writer sink;       // Destino de las alertas
+    int sink_open;           // 1 si el destino ya se abrió
+    double tokens;           // Alertas que todavía se pueden emitir en este momento
+    int64_t refill_ns;       // Último instante en que se recargaron los permisos
+    uint64_t suppressed;     // Alertas no emitidas desde la última emitida
+    metric_counter *raised;  // Alertas emitidas (métrica del consumidor)
+    metric_counter *dropped; // Alertas suprimidas por el límite de frecuencia
+} detector;
+
+// Parámetros comunes a la detección de todos los canales
+typedef struct {
+    const char *sink_path; // Archivo de alertas ("-" = salida estándar)
+    double max_per_s;      // Alertas por segundo de cada consumidor (por defecto 20)
+    int clear_samples;     // Lecturas normales seguidas para despejar una alerta (por defecto 10)
+    int warmup;            // Lecturas antes de activar zscore y cusum (por defecto 30)
+    double alpha;          // Peso de la lectura nueva en la media y varianza móviles (por defecto 0.05)
+    double cusum_k;        // Holgura de CUSUM en desviaciones (por defecto 0.5)
+} detect_config;
+
+// Declaración de variables globales
+extern detect_config detect_settings; // Configuración elegida en la línea de comandos
+
+// Prototipos de funciones
+int detect_parse(detect_limits *limits, const char *spec); // Aplica "clave=valor[,clave=valor...]"
+int detect_init(detector *d, const char *channel, float min, float max, const detect_limits *limits,
+                metric_counter *raised, metric_counter *dropped); // Reserva la tabla de sensores
+uint32_t detect_sample(detector *d, uint32_t instance, float value, int64_t when_ns, int64_t now_ms); // Evalúa una lectura (devuelve las alertas activas)
+int detect_wait_ms(const detector *d);   // Milisegundos hasta que deban escribirse las alertas (-1 si no hay)
+void detect_flush(detector *d);          // Escribe las alertas pendientes si vencieron
+void detect_close(detector *d);          // Escribe lo pendiente y libera la tabla
+
+#endif // DETECT_H
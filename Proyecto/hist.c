@@ -0,0 +1,80 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del histograma logarítmico de latencias
+**************************************************************/
+
+#include "hist.h"
+#include <string.h>
+
+// Cubeta que corresponde a un valor.
+static int bucket_of(uint64_t value) {
+    if (value < 2 * HIST_SUB) {
+        return (int)value;
+    }
+    int exponent = 63 - __builtin_clzll(value);    // Potencia de 2 más alta del valor
+    int shift = exponent - HIST_SUB_BITS;
+    int mantissa = (int)(value >> shift) - HIST_SUB; // Sub-cubeta dentro de la potencia
+    return 2 * HIST_SUB + (exponent - HIST_SUB_BITS - 1) * HIST_SUB + mantissa;
+}
+
+// Mayor valor que cae en una cubeta.
+static uint64_t bucket_upper(int bucket) {
+    if (bucket < 2 * HIST_SUB) {
+        return (uint64_t)bucket;
+    }
+    int index = bucket - 2 * HIST_SUB;
+    int shift = index / HIST_SUB + 1;
+    uint64_t mantissa = (uint64_t)(index % HIST_SUB + HIST_SUB);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+// Vacía el histograma.
+void hist_reset(histogram *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+// Registra un valor.
+void hist_record(histogram *h, uint64_t value) {
+    h->counts[bucket_of(value)]++;
+    h->total++;
+    h->sum += (double)value;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+// Suma los valores de from en into.
+void hist_merge(histogram *into, const histogram *from) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total += from->total;
+    into->sum += from->sum;
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+// Devuelve el valor del percentil p (0-100); 0 si el histograma está vacío.
+uint64_t hist_percentile(const histogram *h, double p) {
+    if (h->total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
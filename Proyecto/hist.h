@@ -0,0 +1,36 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del histograma logarítmico de latencias
+**************************************************************/
+
+#ifndef HIST_H
+#define HIST_H
+
+#include <stdint.h>
+
+// Histograma al estilo HDR: cada potencia de 2 se divide en 32 sub-cubetas,
+// así el error relativo de cualquier percentil es menor al 3% sin importar la
+// escala (de nanosegundos a minutos) y el tamaño es fijo.
+
+#define HIST_SUB_BITS 5                          // log2 de las sub-cubetas por potencia de 2
+#define HIST_SUB (1 << HIST_SUB_BITS)            // Sub-cubetas por potencia de 2
+#define HIST_BUCKETS (2 * HIST_SUB + (64 - HIST_SUB_BITS - 1) * HIST_SUB) // Cubetas totales
+
+// Histograma de valores enteros no negativos (por ejemplo, nanosegundos)
+typedef struct {
+    uint64_t counts[HIST_BUCKETS]; // Cantidad de valores por cubeta
+    uint64_t total;                // Cantidad total de valores
+    uint64_t max;                  // Mayor valor registrado
+    double sum;                    // Suma de los valores
+} histogram;
+
+// Prototipos de funciones
+void hist_reset(histogram *h);                        // Vacía el histograma
+void hist_record(histogram *h, uint64_t value);       // Registra un valor
+void hist_merge(histogram *into, const histogram *from); // Suma otro histograma
+uint64_t hist_percentile(const histogram *h, double p); // Valor del percentil p (0-100)
+
+#endif // HIST_H
@@ -0,0 +1,803 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la ingesta de lecturas desde múltiples sensores
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "ingest.h"
+#include "bcast.h"
+#include "channel.h"
+#include "journal.h"
+#include "protocol.h"
+#include "shmring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Tipos de fuente registradas en epoll
+enum source_kind {
+    SOURCE_STOP,     // eventfd para pedir la parada del recolector
+    SOURCE_LISTENER, // Socket Unix que acepta conexiones de sensores
+    SOURCE_STREAM,   // Pipe nominal o conexión de un sensor con datos
+    SOURCE_SPACE,    // eventfd con el que un consumidor avisa que liberó espacio en su buffer
+    SOURCE_SHM,      // eventfd con el que un sensor por memoria compartida avisa que hay muestras
+};
+
+// Fuente de datos multiplexada por el recolector
+typedef struct ingest_source {
+    enum source_kind kind; // Tipo de fuente
+    int fd;                // Descriptor no bloqueante de la fuente
+    int keepalive_fd;      // Escritor propio del pipe para que nunca llegue a EOF (-1 si no aplica)
+    int is_fifo;           // 1 si la fuente es un pipe nominal
+    frame_reader *reader;  // Reensamblado de registros (sólo fuentes con datos)
+    unsigned long oversized_seen; // Registros demasiado largos ya sumados a las métricas
+    uint32_t instance;     // Instancia asumida para los registros que no traen la suya
+    channel_shard *space_of;  // Parte cuyo aviso de espacio entrega la fuente (sólo SOURCE_SPACE)
+    channel_shard *paused_on; // Parte con el buffer lleno que pausó la fuente (NULL si no está pausada)
+    sample paused_item;    // Muestra que no cupo y se encola al reanudar
+    uint32_t paused_sender; // Emisor de paused_item (para el diario)
+    int64_t paused_ns;     // Instante en que se pausó la fuente
+    struct ingest_source *next_paused; // Siguiente fuente pausada en la misma parte (o quitada)
+    int closed;            // 1 si ya se quitó y sólo falta liberarla
+    int greeted;           // 1 si ya se recibió el primer mensaje de la conexión
+    int hangup;            // 1 si el sensor por memoria compartida cerró su socket
+    shm_consumer *shm;     // Buffer en memoria compartida del sensor (NULL si envía texto)
+    struct ingest_source *shm_event; // Fuente del eventfd del sensor (sólo con shm)
+    struct ingest_source *owner;     // Conexión a la que pertenece el eventfd (sólo SOURCE_SHM)
+} ingest_source;
+
+// Estado de desborde de una parte de un canal que sólo usa el recolector
+typedef struct {
+    ingest_source *paused_head; // Fuentes pausadas por la parte, en orden de llegada (política block)
+    ingest_source *paused_tail;
+    sample held;                // Última muestra retenida (política coalesce)
+    uint32_t held_sender;       // Emisor de held (para el diario)
+    int has_held;               // 1 si hay una muestra retenida
+} channel_backlog;
+
+static int epoll_fd = -1;         // Instancia de epoll del recolector
+static int stop_fd = -1;          // eventfd que despierta al recolector para terminar
+static int source_count = 0;      // Fuentes abiertas
+ingest_metrics ingest_counters;   // Métricas del recolector
+static channel_backlog *backlogs; // Estado de desborde de cada parte de cada canal
+static int backlogged = 0;        // Fuentes pausadas más muestras retenidas en todos los canales
+static uint32_t next_instance = 0; // Última instancia asignada a un pipe o conexión (sin INGEST_INSTANCE_BASE)
+static ingest_source *removed = NULL; // Fuentes quitadas pendientes de liberar
+
+// Registra una fuente en epoll con lectura disparada por flanco.
+static ingest_source *source_add(enum source_kind kind, int fd) {
+    if (source_count >= MAX_SOURCES) {
+        fprintf(stderr, "Error: Too many sensor sources (max %d).\n", MAX_SOURCES);
+        return NULL;
+    }
+
+    ingest_source *src = calloc(1, sizeof(ingest_source));
+    if (!src) {
+        perror("Error allocating memory for a sensor source");
+        return NULL;
+    }
+    src->kind = kind;
+    src->fd = fd;
+    src->keepalive_fd = -1;
+
+    if (kind == SOURCE_STREAM) {
+        src->instance = INGEST_INSTANCE_BASE | (++next_instance & ~INGEST_INSTANCE_BASE);
+        src->reader = malloc(sizeof(frame_reader));
+        if (!src->reader) {
+            perror("Error allocating memory for the pipe reader");
+            free(src);
+            return NULL;
+        }
+        frame_reader_init(src->reader);
+        metric_set(&ingest_counters.sources, metric_get(&ingest_counters.sources) + 1);
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLET, .data.ptr = src };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("Error registering a sensor source");
+        if (src->reader) {
+            metric_set(&ingest_counters.sources, metric_get(&ingest_counters.sources) - 1);
+        }
+        free(src->reader);
+        free(src);
+        return NULL;
+    }
+    source_count++;
+    return src;
+}
+
+// Quita una fuente de epoll y cierra sus descriptores. La memoria se libera
+// con sources_reap al terminar la tanda de eventos, porque otro evento de la
+// misma tanda (o una fuente reanudada) todavía puede apuntar a ella.
+static void source_remove(ingest_source *src) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+    close(src->fd);
+    if (src->keepalive_fd != -1) {
+        close(src->keepalive_fd);
+    }
+    if (src->reader && src->reader->oversized > 0) {
+        printf("Error: %lu oversized records discarded.\n", src->reader->oversized);
+    }
+    if (src->kind == SOURCE_STREAM) {
+        metric_set(&ingest_counters.sources, metric_get(&ingest_counters.sources) - 1);
+    }
+    if (src->shm) {
+        shm_consumer_detach(src->shm);
+        free(src->shm);
+        src->shm = NULL;
+        source_remove(src->shm_event);
+    }
+    src->closed = 1;
+    src->next_paused = removed;
+    removed = src;
+    source_count--;
+}
+
+// Libera las fuentes quitadas durante la última tanda de eventos.
+static void sources_reap(void) {
+    while (removed) {
+        ingest_source *src = removed;
+        removed = src->next_paused;
+        free(src->reader);
+        free(src);
+    }
+}
+
+// Crea la instancia de epoll y el eventfd usado para detener el recolector.
+int ingest_init(void) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        perror("Error creating the epoll instance");
+        return -1;
+    }
+
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd == -1 || source_add(SOURCE_STOP, stop_fd) == NULL) {
+        perror("Error creating the stop event");
+        return -1;
+    }
+    return 0;
+}
+
+// Agrega un pipe nominal como fuente. El monitor mantiene abierto su propio
+// extremo de escritura para que read() nunca devuelva EOF cuando los sensores
+// se desconectan; así pueden conectarse y desconectarse sin reiniciar el monitor.
+int ingest_add_fifo(const char *path) {
+    // Crear el pipe si no existe
+    if (access(path, F_OK) == -1) {
+        printf("Pipe created: '%s'\n", path);
+
+        if (mkfifo(path, 0666) == -1) {
+            perror("Error creating the pipe");
+            return -1;
+        }
+    } else {
+        printf("Pipe already exists. Should not be created.\n");
+    }
+
+    // Se abre el pipe en modo lectura sin bloquear a la espera de escritores.
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        perror("Error opening the pipe in the collector");
+        return -1;
+    }
+
+    // Escritor propio que evita el EOF cuando se cierra el último sensor.
+    int keepalive = open(path, O_WRONLY | O_CLOEXEC);
+    if (keepalive == -1) {
+        perror("Error opening the pipe keepalive writer");
+        close(fd);
+        return -1;
+    }
+
+    ingest_source *src = source_add(SOURCE_STREAM, fd);
+    if (!src) {
+        close(fd);
+        close(keepalive);
+        return -1;
+    }
+    src->keepalive_fd = keepalive;
+    src->is_fifo = 1;
+    return 0;
+}
+
+// Agrega un socket Unix en el que cada sensor abre su propia conexión.
+int ingest_add_listener(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("Error creating the sensor socket");
+        return -1;
+    }
+
+    // Un socket que quedó de una ejecución anterior impediría el bind.
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, SOMAXCONN) == -1) {
+        perror("Error listening on the sensor socket");
+        close(fd);
+        return -1;
+    }
+    printf("Listening for sensors on socket: '%s'\n", path);
+
+    if (source_add(SOURCE_LISTENER, fd) == NULL) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+// Cantidad de registros recibidos con formato o tipo inválido.
+unsigned long ingest_incorrect(void) {
+    return (unsigned long)metric_read(&ingest_counters.malformed);
+}
+
+// Pide al recolector que deje de leer y cierre los buffers.
+void ingest_stop(void) {
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) == -1) {
+        perror("Error stopping the collector");
+    }
+}
+
+// Estado de desborde de una parte.
+static channel_backlog *backlog_of(channel_shard *shard) {
+    return &backlogs[(shard->ch - channels) * channel_shards + shard->index];
+}
+
+// Encola una muestra si hay espacio y, con diario, la anota con la secuencia
+// que lleva en el buffer. Devuelve 1 si la encoló o 0 si el buffer está lleno.
+static int try_push(channel_shard *shard, const sample *item, uint32_t sender) {
+    sample staged = *item;
+    if (journal_enabled) {
+        staged.seq = journal_next_seq();
+    }
+    if (!ring_try_push(&shard->ring, &staged)) {
+        return 0;
+    }
+    if (journal_enabled) {
+        journal_append(shard, &staged, sender);
+    }
+    metric_add(&shard->ch->pushed, 1);
+    return 1;
+}
+
+// Encola una muestra si hay espacio; si no, deja armado el aviso de espacio
+// del consumidor. Devuelve 1 si la encoló o 0 si el buffer sigue lleno.
+static int push_or_arm(channel_shard *shard, const sample *item, uint32_t sender) {
+    do {
+        if (try_push(shard, item, sender)) {
+            return 1;
+        }
+    } while (ring_arm_space(&shard->ring));
+    return 0;
+}
+
+// Encola una muestra de sender (0 si no se conoce) en una parte según la
+// política de su canal. Devuelve 0 o -1 si la fuente quedó pausada porque el
+// buffer está lleno (política block).
+static int enqueue(ingest_source *src, channel_shard *shard, const sample *item, uint32_t sender) {
+    channel *ch = shard->ch;
+    channel_backlog *backlog = backlog_of(shard);
+
+    switch (ch->policy) {
+    case OVERLOAD_DROP_OLDEST: {
+        // La muestra siempre entra; la que sale del buffer ya no llegará al consumidor.
+        sample staged = *item, evicted;
+        if (journal_enabled) {
+            staged.seq = journal_next_seq();
+        }
+        int dropped = ring_push_overwrite(&shard->ring, &staged, &evicted);
+        if (journal_enabled) {
+            journal_append(shard, &staged, sender);
+            if (dropped) {
+                journal_evicted(shard, evicted.seq);
+            }
+        }
+        if (dropped) {
+            metric_add(&ch->dropped, 1);
+        }
+        metric_add(&ch->pushed, 1);
+        return 0;
+    }
+
+    case OVERLOAD_DROP_NEWEST:
+        if (!try_push(shard, item, sender)) {
+            metric_add(&ch->dropped, 1);
+        }
+        return 0;
+
+    case OVERLOAD_COALESCE:
+        // Mientras haya una muestra retenida, la nueva la reemplaza (así se conserva el orden).
+        if (backlog->has_held) {
+            backlog->held = *item;
+            backlog->held_sender = sender;
+            metric_add(&ch->coalesced, 1);
+        } else if (!push_or_arm(shard, item, sender)) {
+            backlog->held = *item;
+            backlog->held_sender = sender;
+            backlog->has_held = 1;
+            backlogged++;
+        }
+        return 0;
+
+    default: // OVERLOAD_BLOCK
+        // Las muestras de otras fuentes pausadas en la parte van primero.
+        if (backlog->paused_head == NULL && push_or_arm(shard, item, sender)) {
+            return 0;
+        }
+
+        // La fuente deja de leerse hasta que el consumidor libere espacio; las
+        // demás fuentes, partes y canales siguen atendiéndose.
+        src->paused_on = shard;
+        src->paused_item = *item;
+        src->paused_sender = sender;
+        src->paused_ns = proto_now_ns();
+        src->next_paused = NULL;
+        if (backlog->paused_tail) {
+            backlog->paused_tail->next_paused = src;
+        } else {
+            backlog->paused_head = src;
+        }
+        backlog->paused_tail = src;
+        backlogged++;
+        metric_add(&ch->push_blocked, 1);
+        return -1;
+    }
+}
+
+// Decodifica un registro completo y lo encola en el canal de su tipo, en la
+// parte que corresponde a su instancia. Devuelve 0 o -1 si la fuente quedó pausada.
+static int dispatch_record(ingest_source *src, char *line) {
+    proto_record rec;
+
+    // Se verifica el formato del registro y que el tipo de sensor esté configurado.
+    channel *ch = NULL;
+    if (proto_parse(line, &rec) == 0) {
+        ch = channel_lookup(rec.sensor_type);
+    }
+    if (ch == NULL) {
+        // Si se recibe una lectura incorrecta, se imprime un mensaje de error.
+        metric_add(&ingest_counters.malformed, 1);
+        printf("Error: Incorrect measurement received.\n");
+        return 0;
+    }
+
+    // Los registros sin instancia (por ejemplo los de un pipe compartido) usan la de su fuente.
+    uint32_t instance = rec.instance >= 0 ? (uint32_t)rec.instance : src->instance;
+
+    // Una lectura que el sensor reenvió al reconectarse y que ya está en el diario se descarta.
+    if (journal_enabled && journal_duplicate(rec.sender, rec.sent_ns)) {
+        return 0;
+    }
+
+    // Difundir la lectura a los suscriptores (una sola copia para todos).
+    if (bcast_enabled) {
+        bcast_publish(rec.sensor_type, instance, rec.value, rec.sent_ns);
+    }
+
+    // Construir la muestra tipada y encolarla en el buffer de su parte del canal
+    // (con diario se anota al entrar al buffer).
+    channel_shard *shard = channel_route(ch, instance);
+    sample item = { instance, rec.value, rec.sent_ns, 0, 0 };
+    return enqueue(src, shard, &item, rec.sender);
+}
+
+// Acepta todas las conexiones pendientes del socket de escucha.
+static void accept_sensors(ingest_source *listener) {
+    while (1) {
+        int fd = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Error accepting a sensor connection");
+            }
+            return;
+        }
+        if (source_add(SOURCE_STREAM, fd) == NULL) {
+            close(fd);
+            continue;
+        }
+        printf("Sensor connected (%lld sources open)\n", (long long)metric_get(&ingest_counters.sources));
+    }
+}
+
+// Conecta una fuente con el buffer en memoria compartida que creó el sensor.
+static int attach_shm(ingest_source *src, int shm_fd, int event_fd) {
+    shm_consumer *shm = malloc(sizeof(shm_consumer));
+    if (!shm || shm_consumer_attach(shm, shm_fd) == -1) {
+        free(shm);
+        return -1;
+    }
+
+    fcntl(event_fd, F_SETFL, fcntl(event_fd, F_GETFL) | O_NONBLOCK);
+    ingest_source *event = source_add(SOURCE_SHM, event_fd);
+    if (!event) {
+        shm_consumer_detach(shm);
+        free(shm);
+        return -1;
+    }
+    event->owner = src;
+    src->shm = shm;
+    src->shm_event = event;
+    printf("Sensor attached over shared memory (%llu samples)\n",
+           (unsigned long long)shm->mask + 1);
+    return 0;
+}
+
+// Primer read() de una conexión: se hace con recvmsg para recibir los
+// descriptores del saludo por memoria compartida (SHM_HANDSHAKE). Si la
+// conexión trae texto, los bytes quedan en el lector como con cualquier read().
+static ssize_t receive_greeting(ingest_source *src) {
+    frame_reader *reader = src->reader;
+    struct iovec iov = { reader->data + reader->len, sizeof(reader->data) - reader->len };
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    ssize_t n;
+    do {
+        n = recvmsg(src->fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) {
+        return n;
+    }
+    src->greeted = 1;
+    reader->len += (size_t)n;
+
+    // Descriptores recibidos junto con el mensaje
+    int fds[2];
+    int nfds = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            for (int i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (nfds < 2) {
+                    fds[nfds++] = fd;
+                } else {
+                    close(fd);
+                }
+            }
+        }
+    }
+    if (nfds == 0) {
+        return n;
+    }
+
+    // Sólo se aceptan descriptores con el saludo exacto: segmento y eventfd.
+    size_t hello = strlen(SHM_HANDSHAKE);
+    int ok = nfds == 2 && reader->len == hello && memcmp(reader->data, SHM_HANDSHAKE, hello) == 0 &&
+             attach_shm(src, fds[0], fds[1]) == 0;
+    close(fds[0]);
+    if (!ok) {
+        if (nfds == 2) {
+            close(fds[1]);
+        }
+        fprintf(stderr, "Error: Invalid shared memory handshake from a sensor.\n");
+        errno = EPROTO;
+        return -1;
+    }
+    frame_reader_init(reader);
+    return n;
+}
+
+// Lee todas las muestras del buffer en memoria compartida de un sensor.
+// Devuelve 0 si la fuente sigue abierta (o quedó pausada) o -1 si el sensor
+// se desconectó y ya no quedan muestras, o si el buffer está dañado.
+static int drain_shm(ingest_source *src) {
+    shm_sample in;
+    unsigned popped = 0;
+
+    while (1) {
+        int got;
+        while ((got = shm_consumer_pop(src->shm, &in)) == 1) {
+            // El sensor duerme si llenó el buffer: se le avisa cada tanto que hay espacio.
+            if ((++popped & 1023) == 0) {
+                shm_consumer_wake_producer(src->shm);
+            }
+
+            channel *ch = channel_lookup(in.sensor_type);
+            if (ch == NULL) {
+                metric_add(&ingest_counters.malformed, 1);
+                printf("Error: Incorrect measurement received.\n");
+                continue;
+            }
+            // Una conexión por memoria compartida es un único sensor salvo que
+            // la muestra traiga su propia instancia (varios sensores virtuales).
+            uint32_t instance = in.instance ? in.instance : src->instance;
+            if (journal_enabled && journal_duplicate(in.sender, in.sent_ns)) {
+                continue;
+            }
+            if (bcast_enabled) {
+                bcast_publish(in.sensor_type, instance, in.value, in.sent_ns);
+            }
+            channel_shard *shard = channel_route(ch, instance);
+            sample item = { instance, in.value, in.sent_ns, 0, 0 };
+            if (enqueue(src, shard, &item, in.sender) == -1) {
+                shm_consumer_wake_producer(src->shm);
+                return 0;
+            }
+        }
+        shm_consumer_wake_producer(src->shm);
+
+        if (got == -1) {
+            fprintf(stderr, "Error: Corrupted shared memory buffer from a sensor.\n");
+            return -1;
+        }
+        if (src->hangup) {
+            return -1;
+        }
+
+        // Anunciar que se espera el eventfd; si llegó algo entre medio se sigue leyendo.
+        if (shm_consumer_idle(src->shm)) {
+            return 0;
+        }
+    }
+}
+
+// El socket de un sensor por memoria compartida sólo indica la desconexión.
+static void note_hangup(ingest_source *src) {
+    char discard[64];
+    while (!src->hangup) {
+        ssize_t n = read(src->fd, discard, sizeof(discard));
+        if (n == 0 || (n == -1 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            src->hangup = 1;
+        } else if (n == -1 && errno != EINTR) {
+            return;
+        }
+    }
+}
+
+// Lee todo lo disponible en una fuente (epoll por flanco exige vaciarla).
+// Primero se procesan los registros que ya estaban en el buffer de lectura.
+// Devuelve 0 si la fuente sigue abierta (o quedó pausada) o -1 si se cerró.
+static int drain_source(ingest_source *src) {
+    while (1) {
+        char *line;
+
+        // Se procesan todos los registros completos recibidos hasta el momento.
+        while ((line = frame_reader_next(src->reader)) != NULL) {
+            if (dispatch_record(src, line) == -1) {
+                return 0;
+            }
+        }
+        if (src->reader->oversized != src->oversized_seen) {
+            metric_add(&ingest_counters.oversized, src->reader->oversized - src->oversized_seen);
+            src->oversized_seen = src->reader->oversized;
+        }
+
+        ssize_t n = !src->is_fifo && !src->greeted ? receive_greeting(src)
+                                                   : frame_reader_fill(src->reader, src->fd);
+        if (src->shm) {
+            // La conexión pasó a memoria compartida.
+            return drain_shm(src);
+        }
+        if (n > 0) {
+            metric_add(&ingest_counters.bytes, (uint64_t)n);
+            continue;
+        }
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n == -1) {
+            perror("Error reading from a sensor source");
+        }
+        return -1;
+    }
+}
+
+// Vacía una fuente y la quita si se cerró.
+static void serve_stream(ingest_source *src) {
+    if ((src->shm ? drain_shm(src) : drain_source(src)) == -1) {
+        if (!src->is_fifo) {
+            printf("Sensor disconnected (%lld sources open)\n", (long long)metric_get(&ingest_counters.sources) - 1);
+        }
+        source_remove(src);
+    }
+}
+
+// El consumidor de una parte liberó espacio: se encola la muestra retenida y
+// se reanudan, en orden, las fuentes pausadas mientras siga habiendo espacio.
+static void resume_shard(channel_shard *shard) {
+    channel_backlog *backlog = backlog_of(shard);
+
+    if (backlog->has_held) {
+        if (!push_or_arm(shard, &backlog->held, backlog->held_sender)) {
+            return;
+        }
+        backlog->has_held = 0;
+        backlogged--;
+    }
+
+    while (backlog->paused_head) {
+        ingest_source *src = backlog->paused_head;
+        if (!push_or_arm(shard, &src->paused_item, src->paused_sender)) {
+            return;
+        }
+
+        backlog->paused_head = src->next_paused;
+        if (backlog->paused_head == NULL) {
+            backlog->paused_tail = NULL;
+        }
+        backlogged--;
+        metric_observe(&shard->ch->push_wait, (uint64_t)(proto_now_ns() - src->paused_ns));
+        src->paused_on = NULL;
+
+        // La fuente continúa con los registros pendientes y lo que llegó mientras estaba pausada.
+        serve_stream(src);
+    }
+}
+
+// Prepara los buffers de las partes de los canales según su política con el
+// buffer lleno. Se llama después de inicializar los buffers y antes de iniciar los hilos.
+int ingest_attach_channels(void) {
+    backlogs = calloc((size_t)(channel_count * channel_shards), sizeof(channel_backlog));
+    if (backlogs == NULL) {
+        perror("Error allocating memory for the channel backlogs");
+        return -1;
+    }
+
+    for (int i = 0; i < channel_count; i++) {
+        channel *ch = &channels[i];
+        for (int k = 0; k < channel_shards; k++) {
+            channel_shard *shard = &ch->shards[k];
+
+            if (ch->policy == OVERLOAD_DROP_OLDEST) {
+                if (ring_enable_overwrite(&shard->ring) == -1) {
+                    perror("Error allocating memory for the buffers");
+                    return -1;
+                }
+                continue;
+            }
+            if (ch->policy == OVERLOAD_DROP_NEWEST) {
+                continue;
+            }
+
+            // block y coalesce esperan el aviso del consumidor en el mismo epoll.
+            int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            ingest_source *src = fd == -1 ? NULL : source_add(SOURCE_SPACE, fd);
+            if (src == NULL) {
+                perror("Error creating the buffer space event");
+                if (fd != -1) {
+                    close(fd);
+                }
+                return -1;
+            }
+            src->space_of = shard;
+            shard->ring.wake_fd = fd;
+        }
+    }
+    return 0;
+}
+
+// Función de hilo para recolectar datos de todos los sensores conectados.
+void *recolector(void *param) {
+    (void)param;
+    struct epoll_event events[64];
+    int running = 1;
+
+    // Se atienden las fuentes listas hasta que se pida la parada. Después de
+    // la parada se vacía lo que quede en las fuentes (sin esperar) antes de
+    // cerrar; si hay fuentes pausadas o muestras retenidas se espera a que
+    // los consumidores liberen espacio.
+    while (1) {
+        int ready = epoll_wait(epoll_fd, events, 64, running || backlogged > 0 ? -1 : 0);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error waiting for sensor data");
+            break;
+        }
+        if (ready > 0) {
+            metric_add(&ingest_counters.wakeups, 1);
+        }
+
+        // Terminar cuando ya se pidió la parada y no queda nada por leer.
+        int pending = 0;
+        for (int i = 0; i < ready; i++) {
+            ingest_source *src = events[i].data.ptr;
+            uint64_t count;
+            if (src->closed) {
+                continue;
+            }
+
+            switch (src->kind) {
+            case SOURCE_STOP:
+                running = 0;
+                break;
+            case SOURCE_LISTENER:
+                if (running) {
+                    accept_sensors(src);
+                }
+                break;
+            case SOURCE_SPACE:
+                pending = 1;
+                if (read(src->fd, &count, sizeof(count)) > 0) {
+                    resume_shard(src->space_of);
+                }
+                break;
+            case SOURCE_SHM:
+                // Un sensor por memoria compartida publicó muestras.
+                if (read(src->fd, &count, sizeof(count)) > 0 && !src->owner->closed &&
+                    !src->owner->paused_on) {
+                    pending = 1;
+                    serve_stream(src->owner);
+                }
+                break;
+            case SOURCE_STREAM:
+                if (src->shm) {
+                    note_hangup(src);
+                }
+                // Una fuente pausada no se lee hasta que su parte del canal tenga espacio.
+                if (!src->paused_on) {
+                    pending = 1;
+                    serve_stream(src);
+                }
+                break;
+            }
+        }
+        sources_reap();
+
+        // Commit agrupado: las lecturas de la tanda van al diario con una sola escritura.
+        if (journal_enabled) {
+            journal_commit();
+        }
+
+        // Despertar a los suscriptores con las lecturas de la tanda.
+        if (bcast_enabled) {
+            bcast_flush();
+        }
+        if (!running && !pending && backlogged == 0) {
+            break;
+        }
+    }
+
+    if (journal_enabled) {
+        journal_commit();
+    }
+    if (ingest_incorrect() > 0) {
+        printf("Incorrect measurements received: %lu\n", ingest_incorrect());
+    }
+
+    // Avisar a los consumidores que no llegarán más muestras para que terminen de vaciar los buffers.
+    for (int i = 0; i < channel_count; i++) {
+        for (int k = 0; k < channel_shards; k++) {
+            ring_close(&channels[i].shards[k].ring);
+        }
+    }
+
+    // Terminar la ejecución del hilo.
+    return NULL;
+}
@@ -0,0 +1,42 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la ingesta de lecturas desde múltiples sensores
+**************************************************************/
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "metrics.h"
+
+#define MAX_SOURCES 1024 // Máximo de fuentes abiertas a la vez (pipes, conexiones y escuchas)
+
+// Los pipes y conexiones cuyos registros no traen instancia usan una propia
+// con el bit más alto encendido, fuera de las que se eligen a mano con -i y
+// de los bloques por PID del sensor (salvo PID mayores que 2^21).
+#define INGEST_INSTANCE_BASE 0x80000000u
+
+// Métricas en vivo del recolector (sólo él las escribe)
+typedef struct {
+    metric_counter malformed; // Registros con formato o tipo inválido
+    metric_counter oversized; // Registros descartados por superar PROTO_MAX_RECORD
+    metric_counter bytes;     // Bytes leídos de todas las fuentes
+    metric_counter wakeups;   // Retornos de epoll_wait con fuentes listas
+    metric_gauge sources;     // Pipes y conexiones de sensores abiertos
+} ingest_metrics;
+
+// Declaración de variables globales
+extern ingest_metrics ingest_counters; // Métricas del recolector
+
+// Prototipos de funciones
+int ingest_init(void);                 // Crea la instancia de epoll y el aviso de parada
+int ingest_add_fifo(const char *path); // Agrega un pipe nominal que nunca llega a EOF
+int ingest_add_listener(const char *path); // Agrega un socket Unix que acepta sensores
+int ingest_attach_channels(void);      // Prepara los buffers según la política de cada canal
+void ingest_stop(void);                // Pide al recolector que termine
+unsigned long ingest_incorrect(void);  // Registros recibidos con formato o tipo inválido
+void *recolector(void *param);         // Hilo que multiplexa todas las fuentes con epoll
+
+#endif // INGEST_H
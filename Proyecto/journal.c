@@ -0,0 +1,848 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del diario de ingesta y de la recuperación después de un fallo
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "journal.h"
+#include "logfmt.h"
+#include "manifest.h"
+#include "protocol.h"
+#include "writer.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define JOURNAL_PENDING 2048      // Registros acumulados antes de escribir aunque la tanda no termine (64 KiB)
+#define JOURNAL_SENDERS 4096      // Emisores que recuerda la tabla de duplicados
+#define JOURNAL_WAIT_MS 1000      // Espera máxima de un consumidor a que el diario alcance su punto de control
+#define CHECKPOINT_MAGIC 0x54504b43u // "CKPT"
+#define SENDERS_MAGIC 0x52444e53u    // "SNDR"
+#define JOURNAL_PATH_LEN 512      // Longitud máxima de la ruta de un archivo del diario
+
+// Punto de control de una parte. Cada parte tiene dos copias seguidas en
+// "checkpoints" y se escriben alternadas: si una queda cortada vale la otra.
+typedef struct {
+    uint32_t magic;      // CHECKPOINT_MAGIC
+    uint32_t check;      // Suma de verificación (calculada con check = 0)
+    uint64_t generation; // Crece con cada escritura; vale la copia válida más nueva
+    uint64_t seq;        // Lecturas de la parte con secuencia <= seq ya están en el archivo
+    uint64_t size;       // Tamaño del archivo en ese punto
+    char shard[CHANNEL_FILE_LEN + 16]; // Archivo de la parte (identifica el punto de control)
+    char file[SEGMENT_PATH_LEN];       // Archivo o segmento en el que se escribía ("" si ninguno)
+} journal_checkpoint;
+
+// Estado de una parte en el diario
+typedef struct {
+    channel_shard *shard;    // Parte
+    uint64_t start;          // Punto de control recuperado: se reinyecta lo posterior
+    uint64_t generation;     // Generación del último punto de control escrito
+    atomic_uint_least64_t saved; // Secuencia del último punto de control (la escribe el consumidor)
+    atomic_uint_least64_t evicted; // Última lectura que drop-oldest sacó del buffer (la escribe el recolector)
+    uint64_t routed;         // Última secuencia encaminada a la parte (sólo el recolector)
+} journal_shard;
+
+// Último envío anotado de un emisor (también es el formato de "senders")
+typedef struct {
+    uint32_t sender;   // PID del sensor; 0 = libre
+    uint32_t reserved; // 0
+    int64_t sent_ns;   // Mayor instante de envío anotado
+} journal_sender;
+
+// Encabezado de "senders", seguido de count emisores
+typedef struct {
+    uint32_t magic; // SENDERS_MAGIC
+    uint32_t count; // Emisores guardados
+    uint32_t check; // Suma de verificación de los emisores
+    uint32_t reserved; // 0
+} senders_header;
+
+// Métricas del diario
+journal_metrics journal_counters;
+
+// 1 si el monitor lleva el diario
+int journal_enabled = 0;
+
+static char journal_dir[JOURNAL_PATH_LEN];   // Directorio del diario
+static int journal_fd = -1;                  // Archivo del diario abierto
+static uint64_t journal_bytes;               // Bytes del archivo abierto
+static journal_record pending[JOURNAL_PENDING]; // Registros anotados aún sin escribir
+static size_t pending_count;                 // Cantidad de registros anotados
+static uint64_t next_seq = 1;                // Secuencia del próximo registro
+static atomic_uint_least64_t durable;        // Última secuencia ya escrita en el diario
+static uint64_t *files;                      // Primera secuencia de cada archivo del diario, en orden
+static size_t file_count, file_capacity;     // Archivos del diario
+static size_t replay_files;                  // Archivos que había al abrir (los que se reinyectan)
+static int checkpoint_fd = -1;               // Archivo "checkpoints"
+static journal_shard *shards;                // Estado de cada parte de cada canal
+static int shard_count;                      // channel_count * channel_shards
+static journal_sender *senders;              // Tabla de duplicados (direccionamiento abierto)
+static size_t sender_count;                  // Emisores en la tabla
+static int senders_full;                     // 1 si ya se avisó que la tabla se llenó
+static int64_t stamp_ms;                     // Hora de llegada de la tanda (0 = leerla de nuevo)
+static int64_t opened_ns;                    // Inicio de la recuperación (para medir el reinicio)
+
+// Suma de verificación FNV-1a de 32 bits.
+static uint32_t checksum(const void *data, size_t len) {
+    const unsigned char *p = data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Suma de verificación de un registro (todos los campos salvo check).
+static uint32_t record_check(const journal_record *r) {
+    return checksum(r, offsetof(journal_record, check));
+}
+
+// Estado de una parte (mismo orden que los buffers del recolector).
+static journal_shard *state_of(const channel_shard *shard) {
+    return &shards[(shard->ch - channels) * channel_shards + shard->index];
+}
+
+// Ruta del archivo del diario que empieza en la secuencia first.
+static void file_path(uint64_t first, char *out, size_t size) {
+    snprintf(out, size, "%s/journal-%016llx", journal_dir, (unsigned long long)first);
+}
+
+// Agrega un archivo a la lista del diario.
+static int file_add(uint64_t first) {
+    if (file_count == file_capacity) {
+        size_t capacity = file_capacity ? file_capacity * 2 : 16;
+        uint64_t *grown = realloc(files, capacity * sizeof(uint64_t));
+        if (!grown) {
+            return -1;
+        }
+        files = grown;
+        file_capacity = capacity;
+    }
+    files[file_count++] = first;
+    return 0;
+}
+
+// Orden de qsort para las secuencias iniciales de los archivos.
+static int compare_seq(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Escribe len bytes completos, repitiendo write() si la escritura es parcial.
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Posición del emisor en la tabla de duplicados. Con create la ocupa si no
+// estaba; devuelve NULL si no está (o si la tabla está llena).
+static journal_sender *sender_slot(uint32_t sender, int create) {
+    uint32_t hash = (uint32_t)(((uint64_t)sender * 0x9E3779B97F4A7C15ULL) >> 32);
+    for (uint32_t i = 0; i < JOURNAL_SENDERS; i++) {
+        journal_sender *e = &senders[(hash + i) & (JOURNAL_SENDERS - 1)];
+        if (e->sender == sender) {
+            return e;
+        }
+        if (e->sender == 0) {
+            if (!create) {
+                return NULL;
+            }
+            e->sender = sender;
+            sender_count++;
+            return e;
+        }
+    }
+    if (create && !senders_full) {
+        senders_full = 1;
+        fprintf(stderr, "Error: Journal sender table full (%d); resent samples of new senders are kept.\n",
+                JOURNAL_SENDERS);
+    }
+    return NULL;
+}
+
+// Registra el instante de envío de una lectura anotada del emisor.
+static void sender_note(uint32_t sender, int64_t sent_ns) {
+    if (sender == 0 || sent_ns == 0) {
+        return;
+    }
+    journal_sender *e = sender_slot(sender, 1);
+    if (e && sent_ns > e->sent_ns) {
+        e->sent_ns = sent_ns;
+    }
+}
+
+// Devuelve 1 (y lo cuenta) si la lectura ya estaba en el diario: su instante
+// de envío no es posterior al último anotado del mismo emisor. Cada sensor
+// marca sus lecturas con instantes estrictamente crecientes, así que dos
+// sensores distintos nunca se confunden aunque compartan tipo e instancia.
+// Las lecturas sin emisor (sensores sin -b, que no reenvían) nunca lo son.
+int journal_duplicate(uint32_t sender, int64_t sent_ns) {
+    if (sender == 0 || sent_ns == 0) {
+        return 0;
+    }
+    journal_sender *e = sender_slot(sender, 0);
+    if (!e || sent_ns > e->sent_ns) {
+        return 0;
+    }
+    metric_add(&journal_counters.duplicates, 1);
+    return 1;
+}
+
+// Orden de qsort para guardar primero los emisores más recientes.
+static int compare_recent(const void *a, const void *b) {
+    int64_t x = ((const journal_sender *)a)->sent_ns, y = ((const journal_sender *)b)->sent_ns;
+    return x > y ? -1 : x < y;
+}
+
+// Guarda la tabla de duplicados en "senders" (archivo temporal y rename, así
+// que siempre queda una versión completa). Sólo tiene lecturas ya escritas en
+// el diario: se llama después de journal_commit.
+static void senders_save(void) {
+    journal_sender *list = malloc((sender_count ? sender_count : 1) * sizeof(journal_sender));
+    if (!list) {
+        perror("Error saving the journal senders");
+        return;
+    }
+    senders_header h = { SENDERS_MAGIC, 0, 0, 0 };
+    for (size_t i = 0; i < JOURNAL_SENDERS && h.count < sender_count; i++) {
+        if (senders[i].sender != 0) {
+            list[h.count++] = senders[i];
+        }
+    }
+    h.check = checksum(list, h.count * sizeof(journal_sender));
+
+    char path[JOURNAL_PATH_LEN + 16], temp[JOURNAL_PATH_LEN + 16];
+    snprintf(path, sizeof(path), "%s/senders", journal_dir);
+    snprintf(temp, sizeof(temp), "%s/senders.tmp", journal_dir);
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    int ok = fd != -1 && write_all(fd, &h, sizeof(h)) == 0 &&
+             write_all(fd, list, h.count * sizeof(journal_sender)) == 0 &&
+             (writer_settings.durability != WRITER_SYNC_DATA || fdatasync(fd) == 0);
+    if (fd != -1) {
+        close(fd);
+    }
+    if (!ok || rename(temp, path) == -1) {
+        fprintf(stderr, "Error saving the journal senders %s: %s\n", path, strerror(errno));
+        unlink(temp);
+    }
+    free(list);
+}
+
+// Carga "senders" en la tabla de duplicados. Los instantes posteriores a
+// "ahora" son de antes de reiniciar la máquina y no cuentan. Si hay muchos
+// emisores sólo se cargan los más recientes, para dejar lugar a los nuevos.
+static void senders_load(int64_t now_ns) {
+    char path[JOURNAL_PATH_LEN + 16];
+    snprintf(path, sizeof(path), "%s/senders", journal_dir);
+    log_map map;
+    if (log_map_open(path, &map) == -1) {
+        return;
+    }
+    senders_header h;
+    size_t count = 0;
+    journal_sender *list = NULL;
+    if (map.size >= sizeof(h)) {
+        memcpy(&h, map.data, sizeof(h));
+        if (h.magic == SENDERS_MAGIC && map.size == sizeof(h) + (size_t)h.count * sizeof(journal_sender) &&
+            checksum(map.data + sizeof(h), (size_t)h.count * sizeof(journal_sender)) == h.check) {
+            count = h.count;
+            list = malloc((count ? count : 1) * sizeof(journal_sender));
+        }
+    }
+    if (list) {
+        memcpy(list, map.data + sizeof(h), count * sizeof(journal_sender));
+        qsort(list, count, sizeof(journal_sender), compare_recent);
+        for (size_t i = 0; i < count && sender_count < JOURNAL_SENDERS / 2; i++) {
+            if (list[i].sent_ns <= now_ns) {
+                sender_note(list[i].sender, list[i].sent_ns);
+            }
+        }
+        free(list);
+    } else if (count > 0 || map.size > 0) {
+        fprintf(stderr, "Error: Invalid journal senders %s; resent samples may be duplicated.\n", path);
+    }
+    log_map_close(&map);
+}
+
+// Escribe el punto de control de una parte en la copia que no tiene el más reciente.
+static void checkpoint_write(journal_shard *st, uint64_t seq, const char *file, uint64_t size) {
+    journal_checkpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.magic = CHECKPOINT_MAGIC;
+    cp.generation = ++st->generation;
+    cp.seq = seq;
+    cp.size = size;
+    snprintf(cp.shard, sizeof(cp.shard), "%s", st->shard->file);
+    snprintf(cp.file, sizeof(cp.file), "%s", file);
+    cp.check = checksum(&cp, sizeof(cp));
+
+    off_t slot = (off_t)(st - shards) * 2 + (off_t)(cp.generation & 1);
+    if (pwrite(checkpoint_fd, &cp, sizeof(cp), slot * (off_t)sizeof(cp)) != (ssize_t)sizeof(cp)) {
+        perror("Error writing a journal checkpoint");
+        return;
+    }
+    if (writer_settings.durability == WRITER_SYNC_DATA) {
+        fdatasync(checkpoint_fd);
+    }
+    atomic_store_explicit(&st->saved, seq, memory_order_release);
+    // Este contador lo escriben los consumidores de todas las partes.
+    atomic_fetch_add_explicit(&journal_counters.checkpoints, 1, memory_order_relaxed);
+}
+
+// Lee "checkpoints" y deja en found[i] el punto de control válido más nuevo
+// de la parte i (se buscan por el nombre de su archivo, así que sobreviven a
+// un cambio en el orden de los canales). Devuelve cuántas partes tienen uno.
+static int checkpoints_load(journal_checkpoint *found) {
+    int count = 0;
+    journal_checkpoint cp;
+    off_t offset = 0;
+    while (pread(checkpoint_fd, &cp, sizeof(cp), offset) == (ssize_t)sizeof(cp)) {
+        offset += (off_t)sizeof(cp);
+        uint32_t check = cp.check;
+        cp.check = 0;
+        if (cp.magic != CHECKPOINT_MAGIC || checksum(&cp, sizeof(cp)) != check) {
+            continue;
+        }
+        cp.shard[sizeof(cp.shard) - 1] = '\0';
+        cp.file[sizeof(cp.file) - 1] = '\0';
+        for (int i = 0; i < shard_count; i++) {
+            if (strcmp(shards[i].shard->file, cp.shard) == 0 && cp.generation > found[i].generation) {
+                count += found[i].generation == 0;
+                found[i] = cp;
+            }
+        }
+    }
+    return count;
+}
+
+// Corta el archivo path en size bytes si es más largo (lo que sigue se vuelve
+// a generar desde el diario). El índice de consultas del archivo queda viejo y se borra.
+static void cut_output(const char *path, uint64_t size) {
+    struct stat st;
+    if (stat(path, &st) == -1 || (uint64_t)st.st_size <= size) {
+        return;
+    }
+    if (truncate(path, (off_t)size) == -1) {
+        fprintf(stderr, "Error truncating %s: %s\n", path, strerror(errno));
+        return;
+    }
+    char idx[SEGMENT_PATH_LEN + 8];
+    snprintf(idx, sizeof(idx), "%s.idx", path);
+    unlink(idx);
+    printf("Journal: %s cut from %lld to %llu bytes\n", path, (long long)st.st_size, (unsigned long long)size);
+}
+
+// Deja la salida de una parte como estaba en su punto de control. Con
+// rotación, el segmento del punto de control se corta en su tamaño y los
+// segmentos abiertos después (sólo tienen lecturas posteriores) quedan vacíos.
+static void recover_output(const journal_shard *st, const journal_checkpoint *cp) {
+    if (segment_settings.rotate_ms == 0 && segment_settings.rotate_bytes == 0) {
+        cut_output(st->shard->file, cp->size);
+        return;
+    }
+
+    char manifest_path[SEGMENT_PATH_LEN];
+    manifest m;
+    snprintf(manifest_path, sizeof(manifest_path), "%s.manifest", st->shard->file);
+    if (manifest_load(manifest_path, &m) == -1) {
+        fprintf(stderr, "Error reading the manifest %s\n", manifest_path);
+        return;
+    }
+    for (size_t i = 0; i < m.count; i++) {
+        char path[SEGMENT_PATH_LEN];
+        if (strcmp(m.entries[i].state, "open") == 0 &&
+            manifest_file(manifest_path, &m.entries[i], path, sizeof(path)) == 0) {
+            cut_output(path, strcmp(path, cp->file) == 0 ? cp->size : 0);
+        }
+    }
+    manifest_free(&m);
+}
+
+// 1 si el archivo del diario empieza con un encabezado de este formato.
+static int header_valid(const log_map *map) {
+    journal_header h;
+    if (map->size < sizeof(h)) {
+        return 0;
+    }
+    memcpy(&h, map->data, sizeof(h));
+    return h.magic == JOURNAL_MAGIC && h.version == JOURNAL_VERSION && h.record_size == sizeof(journal_record);
+}
+
+// Recorre los registros válidos de un archivo del diario (consecutivos desde
+// first, después del encabezado) y devuelve la cantidad. Un registro cortado
+// o dañado termina el archivo.
+static size_t scan_file(const log_map *map, uint64_t first, void (*visit)(const journal_record *r, void *ctx),
+                        void *ctx) {
+    size_t count = 0;
+    for (size_t offset = sizeof(journal_header); offset + sizeof(journal_record) <= map->size; offset += sizeof(journal_record)) {
+        journal_record r;
+        memcpy(&r, map->data + offset, sizeof(r));
+        if (r.seq != first + count || r.check != record_check(&r)) {
+            break;
+        }
+        if (visit) {
+            visit(&r, ctx);
+        }
+        count++;
+    }
+    return count;
+}
+
+// Visita de la recuperación: recuerda el último envío de cada emisor (el de
+// "senders" puede ser anterior si se cortó antes de guardarlo). Los instantes
+// posteriores a "ahora" son de antes de reiniciar la máquina y no cuentan.
+static void seed_visit(const journal_record *r, void *ctx) {
+    int64_t now_ns = *(const int64_t *)ctx;
+    if (r->sent_ns <= now_ns) {
+        sender_note(r->sender, r->sent_ns);
+    }
+}
+
+// Busca los archivos del diario, corta el final dañado del último y borra los
+// vacíos. Los de otro formato se dejan como están y no se reinyectan. Devuelve la última secuencia escrita (0 si el diario está vacío).
+static uint64_t load_files(void) {
+    DIR *dir = opendir(journal_dir);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *d;
+    while ((d = readdir(dir)) != NULL) {
+        unsigned long long first;
+        char extra;
+        if (sscanf(d->d_name, "journal-%16llx%c", &first, &extra) == 1 && first > 0) {
+            file_add(first);
+        }
+    }
+    closedir(dir);
+    qsort(files, file_count, sizeof(uint64_t), compare_seq);
+
+    int64_t now_ns = proto_now_ns();
+    uint64_t last = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < file_count; i++) {
+        char path[JOURNAL_PATH_LEN];
+        log_map map;
+        file_path(files[i], path, sizeof(path));
+        if (log_map_open(path, &map) == -1) {
+            continue;
+        }
+        if (map.size >= sizeof(journal_header) && !header_valid(&map)) {
+            printf("Journal: %s has an unknown format, ignored\n", path);
+            log_map_close(&map);
+            continue;
+        }
+        size_t count = scan_file(&map, files[i], seed_visit, &now_ns);
+        size_t size = map.size;
+        log_map_close(&map);
+
+        if (count == 0) {
+            unlink(path);
+            continue;
+        }
+        size_t used = sizeof(journal_header) + count * sizeof(journal_record);
+        if (used < size && truncate(path, (off_t)used) == 0) {
+            printf("Journal: %s had a torn tail, cut at %zu records\n", path, count);
+        }
+        files[kept++] = files[i];
+        last = files[i] + count - 1;
+    }
+    file_count = kept;
+    return last;
+}
+
+// Abre un archivo nuevo del diario que empieza en la secuencia first y le
+// escribe el encabezado.
+static int start_file(uint64_t first) {
+    char path[JOURNAL_PATH_LEN];
+    journal_header h = { JOURNAL_MAGIC, JOURNAL_VERSION, sizeof(journal_record), 0 };
+    file_path(first, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1 || write_all(fd, &h, sizeof(h)) == -1 || file_add(first) == -1) {
+        fprintf(stderr, "Error creating the journal file %s: %s\n", path, strerror(errno));
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (journal_fd != -1) {
+        close(journal_fd);
+    }
+    journal_fd = fd;
+    journal_bytes = sizeof(h);
+    return 0;
+}
+
+// Prepara el diario en dir: recupera los puntos de control, corta cada salida
+// en el suyo, recorre el diario (y recuerda el último envío de cada emisor) y
+// abre un archivo nuevo. Se llama después de ini_buffers y antes de iniciar
+// los consumidores, que todavía no abrieron sus archivos. Devuelve 0 o -1.
+int journal_open(const char *dir) {
+    opened_ns = proto_now_ns();
+    int n = snprintf(journal_dir, sizeof(journal_dir), "%s", dir);
+    if (n < 0 || (size_t)n >= sizeof(journal_dir) - 32) {
+        fprintf(stderr, "Error: Journal directory path too long: %s\n", dir);
+        return -1;
+    }
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        fprintf(stderr, "Error creating the journal directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    shard_count = channel_count * channel_shards;
+    shards = calloc((size_t)shard_count, sizeof(journal_shard));
+    senders = calloc(JOURNAL_SENDERS, sizeof(journal_sender));
+    journal_checkpoint *found = calloc((size_t)shard_count, sizeof(journal_checkpoint));
+    if (!shards || !senders || !found) {
+        perror("Error allocating memory for the journal");
+        free(found);
+        return -1;
+    }
+    for (int i = 0; i < channel_count; i++) {
+        for (int k = 0; k < channel_shards; k++) {
+            shards[i * channel_shards + k].shard = &channels[i].shards[k];
+        }
+    }
+
+    char path[JOURNAL_PATH_LEN + 16];
+    snprintf(path, sizeof(path), "%s/checkpoints", journal_dir);
+    checkpoint_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (checkpoint_fd == -1) {
+        fprintf(stderr, "Error opening the journal checkpoints %s: %s\n", path, strerror(errno));
+        free(found);
+        return -1;
+    }
+    checkpoints_load(found);
+    senders_load(opened_ns);
+    uint64_t last = load_files();
+
+    // Cada salida vuelve a su punto de control. Si el diario no tiene lecturas
+    // (primera vez o después de terminar bien) las salidas ya están completas
+    // tal como están; una parte sin punto de control reinyecta todo el diario.
+    uint64_t newest = last;
+    for (int i = 0; i < shard_count; i++) {
+        journal_shard *st = &shards[i];
+        journal_checkpoint *cp = &found[i];
+        if (cp->generation > 0) {
+            st->start = cp->seq;
+            st->generation = cp->generation;
+            if (cp->seq > newest) {
+                newest = cp->seq;
+            }
+        }
+        if (cp->generation > 0 && last > 0) {
+            recover_output(st, cp);
+        } else {
+            struct stat sb;
+            int rotated = segment_settings.rotate_ms > 0 || segment_settings.rotate_bytes > 0;
+            snprintf(cp->file, sizeof(cp->file), "%s", rotated ? "" : st->shard->file);
+            cp->size = !rotated && stat(st->shard->file, &sb) == 0 ? (uint64_t)sb.st_size : 0;
+            if (cp->generation == 0 && last > 0) {
+                printf("Journal: no checkpoint for %s, replaying the whole journal\n", st->shard->file);
+            }
+        }
+        atomic_init(&st->saved, st->start);
+        atomic_init(&st->evicted, 0);
+    }
+
+    // Los puntos de control se reescriben en el orden actual de las partes.
+    if (ftruncate(checkpoint_fd, 0) == -1) {
+        perror("Error resetting the journal checkpoints");
+    }
+    for (int i = 0; i < shard_count; i++) {
+        checkpoint_write(&shards[i], shards[i].start, found[i].file, found[i].size);
+    }
+    free(found);
+
+    next_seq = newest + 1;
+    atomic_init(&durable, newest);
+    replay_files = file_count;
+    if (start_file(next_seq) == -1) {
+        return -1;
+    }
+    journal_enabled = 1;
+    printf("Journal: %s (%zu files to replay, next sequence %llu)\n", journal_dir, replay_files,
+           (unsigned long long)next_seq);
+    return 0;
+}
+
+// Encola una muestra reinyectada esperando a que el consumidor libere espacio
+// (por el aviso de espacio del buffer si la política lo usa).
+static void replay_push(channel_shard *shard, const sample *item) {
+    if (shard->ring.wake_fd == -1) {
+        ring_push(&shard->ring, item);
+        return;
+    }
+    while (!ring_try_push(&shard->ring, item)) {
+        if (!ring_arm_space(&shard->ring)) {
+            struct pollfd pfd = { shard->ring.wake_fd, POLLIN, 0 };
+            uint64_t count;
+            poll(&pfd, 1, -1);
+            if (read(shard->ring.wake_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                perror("Error waiting for buffer space");
+            }
+        }
+    }
+}
+
+// Visita de la reinyección: encola las lecturas posteriores al punto de control de su parte.
+static void replay_visit(const journal_record *r, void *ctx) {
+    long *replayed = ctx;
+    channel *ch = channel_lookup(r->sensor_type);
+    if (ch == NULL) {
+        return;
+    }
+    channel_shard *shard = channel_route(ch, r->instance);
+    journal_shard *st = state_of(shard);
+    if (r->seq <= st->start) {
+        return;
+    }
+    sample item = { r->instance, r->value, r->sent_ns, r->seq, r->when_ms };
+    replay_push(shard, &item);
+    metric_add(&shard->ch->pushed, 1);
+    st->routed = r->seq;
+    (*replayed)++;
+}
+
+// Reinyecta a los consumidores las lecturas del diario que sus salidas
+// todavía no tenían. Se llama con los consumidores ya iniciados y antes de
+// iniciar el recolector (hace de productor de los buffers mientras tanto).
+long journal_replay(void) {
+    long replayed = 0;
+    for (size_t i = 0; i < replay_files; i++) {
+        char path[JOURNAL_PATH_LEN];
+        log_map map;
+        file_path(files[i], path, sizeof(path));
+        if (log_map_open(path, &map) == -1) {
+            continue;
+        }
+        scan_file(&map, files[i], replay_visit, &replayed);
+        log_map_close(&map);
+    }
+    metric_add(&journal_counters.replayed, (uint64_t)replayed);
+    printf("Journal recovered in %.3f ms: %ld samples replayed\n", (proto_now_ns() - opened_ns) / 1e6, replayed);
+    return replayed;
+}
+
+// Borra los archivos del diario (salvo el abierto) cuyas lecturas ya están
+// todas en las salidas. Una parte sin lecturas encaminadas después de su
+// punto de control no retiene nada.
+static void compact(void) {
+    uint64_t limit = atomic_load_explicit(&durable, memory_order_relaxed);
+    for (int i = 0; i < shard_count; i++) {
+        uint64_t saved = atomic_load_explicit(&shards[i].saved, memory_order_acquire);
+        if (saved < shards[i].routed && saved < limit) {
+            limit = saved;
+        }
+    }
+
+    size_t removed = 0;
+    while (removed + 1 < file_count && files[removed + 1] - 1 <= limit) {
+        char path[JOURNAL_PATH_LEN];
+        file_path(files[removed], path, sizeof(path));
+        unlink(path);
+        removed++;
+    }
+    if (removed > 0) {
+        memmove(files, files + removed, (file_count - removed) * sizeof(uint64_t));
+        file_count -= removed;
+        replay_files = replay_files > removed ? replay_files - removed : 0;
+    }
+}
+
+// Secuencia que llevará la próxima lectura anotada. El recolector la pone en
+// la muestra antes de encolarla y sólo la anota si de verdad entró al buffer.
+uint64_t journal_next_seq(void) {
+    return next_seq;
+}
+
+// Anota una lectura de sender que ya entró al buffer de la parte shard con
+// la secuencia de journal_next_seq, junto con su hora de llegada (una sola
+// lectura del reloj por tanda), que es la que lleva si se reinyecta. Sólo la
+// llama el recolector; el registro se escribe con journal_commit.
+void journal_append(channel_shard *shard, const sample *item, uint32_t sender) {
+    if (pending_count == JOURNAL_PENDING) {
+        journal_commit();
+    }
+    if (stamp_ms == 0) {
+        stamp_ms = writer_epoch_ms();
+    }
+    journal_record *r = &pending[pending_count++];
+    r->seq = next_seq++;
+    r->sent_ns = item->sent_ns;
+    r->when_ms = stamp_ms;
+    r->instance = item->instance;
+    r->value = item->value;
+    r->sensor_type = shard->ch->id;
+    r->sender = sender;
+    r->reserved = 0;
+    r->check = record_check(r);
+    state_of(shard)->routed = r->seq;
+    sender_note(sender, item->sent_ns);
+}
+
+// drop-oldest sacó del buffer de la parte shard la lectura seq. Todas las
+// anteriores de la parte ya las tomó el consumidor o también se descartaron,
+// así que su avance puede pasar de ella aunque nunca la procese.
+void journal_evicted(channel_shard *shard, uint64_t seq) {
+    atomic_store_explicit(&state_of(shard)->evicted, seq, memory_order_release);
+}
+
+// Commit agrupado: escribe con un solo write() las lecturas anotadas en la
+// tanda (y con -d fdatasync las sincroniza). Si el archivo abierto se llenó
+// se empieza otro; ya escrita la tanda se guarda "senders" (que queda al día
+// con todo lo escrito) y se borran los archivos que ya no hacen falta.
+void journal_commit(void) {
+    stamp_ms = 0;
+    if (pending_count == 0) {
+        return;
+    }
+    size_t bytes = pending_count * sizeof(journal_record);
+    int rolled = 0;
+    if (journal_bytes > sizeof(journal_header) && journal_bytes + bytes > JOURNAL_SEGMENT_BYTES) {
+        rolled = start_file(pending[0].seq) == 0;
+    }
+
+    if (write_all(journal_fd, pending, bytes) == -1) {
+        perror("Error writing the journal");
+        pending_count = 0;
+        return;
+    }
+    if (writer_settings.durability == WRITER_SYNC_DATA) {
+        fdatasync(journal_fd);
+    }
+    journal_bytes += bytes;
+    metric_add(&journal_counters.records, pending_count);
+    metric_add(&journal_counters.commits, 1);
+    atomic_store_explicit(&durable, pending[pending_count - 1].seq, memory_order_release);
+    pending_count = 0;
+    if (rolled) {
+        senders_save();
+        compact();
+    }
+}
+
+// Aviso del escritor al cerrar un segmento: todo lo procesado está en él, así
+// que el punto de control pasa a su tamaño final antes de que se registre
+// como cerrado (y pueda comprimirse). Antes se espera a que el diario tenga
+// esas lecturas, para que un reenvío del sensor no las repita.
+static void segment_finished(void *ctx, const char *path, uint64_t size) {
+    journal_cursor *c = ctx;
+    if (c->processed <= c->saved) {
+        return;
+    }
+    for (int waited = 0; atomic_load_explicit(&durable, memory_order_acquire) < c->processed; waited++) {
+        if (waited == JOURNAL_WAIT_MS) {
+            fprintf(stderr, "Error: The journal did not reach the checkpoint of %s\n", path);
+            return;
+        }
+        usleep(1000);
+    }
+    checkpoint_write(state_of(c->shard), c->processed, path, size);
+    c->saved = c->processed;
+}
+
+// Prepara el avance de la parte shard en el diario sobre su escritor.
+void journal_track(journal_cursor *c, channel_shard *shard, segment_writer *output) {
+    c->shard = shard;
+    c->processed = 0;
+    c->saved = state_of(shard)->start;
+    output->on_finish = segment_finished;
+    output->hook_ctx = c;
+}
+
+// Guarda el punto de control si la salida avanzó: todas las lecturas
+// procesadas antes de la más antigua que sigue en el lote ya están en el
+// archivo (si no queda nada pendiente, todas las procesadas). Nunca pasa de
+// lo que ya está escrito en el diario; si todavía no llegó, se intenta en la
+// próxima vuelta del consumidor.
+void journal_progress(journal_cursor *c, const segment_writer *output) {
+    // Se llama con el lote ya procesado: las lecturas anteriores a la última
+    // descartada se procesaron antes o también se descartaron. El avance por
+    // descarte se limita a lo que ya está en el diario (el archivo no tiene
+    // nada posterior, así que el punto de control sigue siendo exacto).
+    uint64_t limit = atomic_load_explicit(&durable, memory_order_acquire);
+    uint64_t evicted = atomic_load_explicit(&state_of(c->shard)->evicted, memory_order_acquire);
+    if (evicted > limit) {
+        evicted = limit;
+    }
+    if (evicted > c->processed) {
+        c->processed = evicted;
+    }
+    if (c->processed <= c->saved) {
+        return;
+    }
+    uint64_t mark = segment_pending_mark(output);
+    uint64_t done = mark ? mark - 1 : c->processed;
+    if (done <= c->saved || done > limit) {
+        return;
+    }
+    uint64_t size;
+    const char *path = segment_position(output, &size);
+    checkpoint_write(state_of(c->shard), done, path, size);
+    c->saved = done;
+}
+
+// Al terminar (consumidores ya detenidos) todas las salidas tienen todo lo del
+// diario: se borran sus archivos y sólo quedan los puntos de control y
+// "senders", que sigue descartando los reenvíos al volver a abrir.
+void journal_close(void) {
+    if (!journal_enabled) {
+        return;
+    }
+    journal_commit();
+    senders_save();
+    compact();
+    uint64_t limit = atomic_load(&durable);
+    int clean = 1;
+    for (int i = 0; i < shard_count; i++) {
+        uint64_t saved = atomic_load(&shards[i].saved);
+        clean &= saved >= shards[i].routed || saved >= limit;
+    }
+    close(journal_fd);
+    journal_fd = -1;
+    if (clean) {
+        for (size_t i = 0; i < file_count; i++) {
+            char path[JOURNAL_PATH_LEN];
+            file_path(files[i], path, sizeof(path));
+            unlink(path);
+        }
+        file_count = 0;
+    }
+    printf("Journal: %llu records in %llu commits, %llu duplicates dropped\n",
+           (unsigned long long)metric_read(&journal_counters.records),
+           (unsigned long long)metric_read(&journal_counters.commits),
+           (unsigned long long)metric_read(&journal_counters.duplicates));
+
+    close(checkpoint_fd);
+    checkpoint_fd = -1;
+    free(files);
+    free(shards);
+    free(senders);
+    files = NULL;
+    shards = NULL;
+    senders = NULL;
+    sender_count = 0;
+    journal_enabled = 0;
+}
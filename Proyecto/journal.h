@@ -0,0 +1,105 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del diario de ingesta y de la recuperación después de un fallo
+**************************************************************/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include "channel.h"
+#include "metrics.h"
+#include "segment.h"
+
+// Con "-J <directorio>" el recolector anota en un diario de sólo agregar cada
+// lectura que entra al buffer de su parte, antes de que los consumidores la
+// escriban (las que descartan drop-newest o coalesce nunca se anotan):
+//   - Cada registro lleva una secuencia global creciente. El recolector los
+//     acumula en memoria y los escribe con un solo write() al final de cada
+//     tanda de epoll (commit agrupado; con -d fdatasync además se sincroniza).
+//   - El diario se reparte en archivos "journal-<primera secuencia en hex>" de
+//     hasta JOURNAL_SEGMENT_BYTES, cada uno con un encabezado que indica la
+//     versión del formato. Al pasar al siguiente se borran los que ya no
+//     tienen lecturas sin escribir.
+//   - Cada parte guarda en "checkpoints" hasta qué secuencia está completo su
+//     archivo de salida y qué tamaño tenía en ese punto. Se actualiza después
+//     de cada escritura del lote y al cerrar cada segmento, y nunca pasa de lo
+//     que ya está en el diario. Las lecturas que drop-oldest saca del buffer
+//     cuentan como completas, así que no reviven al reinyectar.
+// Al reiniciar después de un fallo, cada salida se corta en el tamaño de su
+// punto de control y se reinyectan sólo las lecturas del diario posteriores a
+// él, así que no se pierden ni se repiten líneas. Cada lectura conserva la
+// hora en que llegó al recolector, así que cae en la misma partición y en las
+// mismas ventanas de agregados que antes del fallo. Las estadísticas y
+// alertas de la parte se recalculan con esas mismas lecturas.
+// El diario además recuerda el último instante de envío de cada emisor (el
+// PID de un sensor con -b; sus instantes son estrictamente crecientes): una
+// lectura que el sensor reenvía al reconectarse y que ya estaba en el diario
+// se descarta. Esa tabla se guarda en "senders" al pasar a otro archivo y al
+// terminar, así que sobrevive a los archivos del diario que se borran.
+
+#define JOURNAL_SEGMENT_BYTES (8u << 20) // Tamaño máximo de cada archivo del diario
+#define JOURNAL_MAGIC 0x4c4e524au         // "JRNL"
+#define JOURNAL_VERSION 2                 // Versión del formato de los archivos del diario
+
+// Encabezado de cada archivo del diario, seguido de los registros
+typedef struct {
+    uint32_t magic;       // JOURNAL_MAGIC
+    uint32_t version;     // JOURNAL_VERSION
+    uint32_t record_size; // sizeof(journal_record)
+    uint32_t reserved;    // 0
+} journal_header;
+
+// Registro del diario (48 bytes, en el orden de la máquina)
+typedef struct {
+    uint64_t seq;        // Secuencia global (consecutiva dentro de cada archivo)
+    int64_t sent_ns;     // Instante de envío en el sensor (0 si no se conoce)
+    int64_t when_ms;     // Hora de llegada al recolector (ms desde la época)
+    uint32_t instance;   // Instancia del sensor
+    float value;         // Valor medido (sin calibrar)
+    int32_t sensor_type; // Tipo de sensor
+    uint32_t sender;     // Emisor (PID del sensor con -b, 0 si no se conoce)
+    uint32_t reserved;   // 0
+    uint32_t check;      // Suma de verificación de los campos anteriores (detecta un final cortado)
+} journal_record;
+
+// Avance de una parte en el diario (sólo lo usa su consumidor)
+typedef struct {
+    channel_shard *shard; // Parte
+    uint64_t processed;   // Secuencia de la última lectura procesada
+    uint64_t saved;       // Secuencia del último punto de control guardado
+} journal_cursor;
+
+// Métricas del diario (las escribe el recolector, salvo checkpoints)
+typedef struct {
+    metric_counter records;     // Registros escritos
+    metric_counter commits;     // Escrituras agrupadas
+    metric_counter duplicates;  // Lecturas reenviadas que ya estaban en el diario
+    metric_counter replayed;    // Lecturas reinyectadas al reiniciar
+    metric_counter checkpoints; // Puntos de control guardados por los consumidores (suma atómica)
+} journal_metrics;
+
+// Declaración de variables globales
+extern journal_metrics journal_counters; // Métricas del diario
+extern int journal_enabled;              // 1 si el monitor lleva el diario
+
+// Prototipos de funciones (hilo principal)
+int journal_open(const char *dir); // Corta las salidas y prepara el diario (antes de iniciar los consumidores)
+long journal_replay(void);         // Reinyecta las lecturas sin confirmar (consumidores ya iniciados, recolector no)
+void journal_close(void);          // Después de los consumidores: borra lo que ya está en las salidas
+
+// Prototipos de funciones (recolector)
+int journal_duplicate(uint32_t sender, int64_t sent_ns); // 1 si ya estaba en el diario
+uint64_t journal_next_seq(void); // Secuencia que llevará la próxima lectura anotada
+void journal_append(channel_shard *shard, const sample *item, uint32_t sender); // Anota una lectura que ya entró al buffer
+void journal_evicted(channel_shard *shard, uint64_t seq);      // drop-oldest sacó esa lectura del buffer
+void journal_commit(void); // Escribe las lecturas anotadas (fin de cada tanda)
+
+// Prototipos de funciones (consumidores)
+void journal_track(journal_cursor *c, channel_shard *shard, segment_writer *output); // Prepara el avance
+void journal_progress(journal_cursor *c, const segment_writer *output); // Guarda el punto de control si avanzó
+
+#endif // JOURNAL_H
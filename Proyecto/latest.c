@@ -0,0 +1,181 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Manejo de latest.c (consulta del último valor de cada sensor del monitor)
+**************************************************************/
+
+#include "snapshot.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Instante monotónico en nanosegundos (para medir las consultas).
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Consulta directa sobre el segmento de memoria compartida (-L).
+static int query_shared(const char *name, int type, long instance, long repeat) {
+  size_t size;
+  snapshot_table *t = snapshot_attach(name, &size);
+  if (t == NULL) {
+    fprintf(stderr, "Error opening the snapshot segment '%s': %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  snapshot_value v;
+  char line[256];
+  if (repeat > 0) {
+    // Medición: la búsqueda y la copia coherente de un sensor, repetidas.
+    int64_t start = now_ns();
+    int found = 0;
+    for (long i = 0; i < repeat; i++) {
+      const snapshot_slot *s = snapshot_find(t, type, (uint32_t)instance);
+      found += s && snapshot_read(s, &v) == 0;
+    }
+    double elapsed = (double)(now_ns() - start);
+    printf("reads=%ld found=%d ns_per_read=%.1f\n", repeat, found, elapsed / repeat);
+  } else if (instance >= 0) {
+    const snapshot_slot *s = snapshot_find(t, type, (uint32_t)instance);
+    if (s && snapshot_read(s, &v) == 0 && snapshot_format(t, &v, line, sizeof(line)) != -1) {
+      printf("%s\n", line);
+    }
+  } else {
+    for (uint32_t i = 0; i < t->capacity; i++) {
+      if (snapshot_read(&t->slots[i], &v) == 0 && (type == 0 || v.type == type) &&
+          snapshot_format(t, &v, line, sizeof(line)) != -1) {
+        printf("%s\n", line);
+      }
+    }
+  }
+  munmap(t, size);
+  return 0;
+}
+
+// Consulta por el socket del monitor (-Q). Imprime la respuesta sin la línea
+// "end"; devuelve 0, o 1 si el monitor respondió un error o se cortó la conexión.
+static int read_response(FILE *in, int print) {
+  char line[512];
+  while (fgets(line, sizeof(line), in) != NULL) {
+    if (strcmp(line, "end\n") == 0) {
+      return 0;
+    }
+    if (strncmp(line, "error", 5) == 0) {
+      fprintf(stderr, "%s", line);
+    } else if (print) {
+      fputs(line, stdout);
+    }
+  }
+  fprintf(stderr, "Error: Connection closed by the monitor\n");
+  return 1;
+}
+
+// Consulta por el socket Unix del monitor (-Q); con repeat mide las peticiones
+// seguidas sobre la misma conexión.
+static int query_socket(const char *path, int type, long instance, long repeat) {
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: Socket path too long: %s\n", path);
+    return 1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+    perror("Error connecting to the snapshot socket");
+    return 1;
+  }
+  FILE *in = fdopen(fd, "r");
+  if (in == NULL) {
+    perror("Error reading the snapshot socket");
+    close(fd);
+    return 1;
+  }
+
+  char request[64];
+  int len;
+  if (instance >= 0) {
+    len = snprintf(request, sizeof(request), "get %d %ld\n", type, instance);
+  } else if (type > 0) {
+    len = snprintf(request, sizeof(request), "type %d\n", type);
+  } else {
+    len = snprintf(request, sizeof(request), "all\n");
+  }
+
+  int result = 0;
+  int64_t start = now_ns();
+  long count = repeat > 0 ? repeat : 1;
+  for (long i = 0; i < count && result == 0; i++) {
+    if (write(fd, request, (size_t)len) != len) {
+      perror("Error writing the snapshot request");
+      result = 1;
+      break;
+    }
+    result = read_response(in, repeat == 0);
+  }
+  if (repeat > 0 && result == 0) {
+    double elapsed = (double)(now_ns() - start);
+    printf("requests=%ld us_per_request=%.2f\n", repeat, elapsed / repeat / 1e3);
+  }
+  fclose(in);
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  int flags;                 // Almacena las flags de los argumentos de línea de comandos
+  char *shm_name = NULL;     // Segmento de memoria compartida del monitor (-L)
+  char *socket_path = NULL;  // Socket Unix de consultas del monitor (-Q)
+  int type = 0;              // Tipo de sensor (0 = todos)
+  long instance = -1;        // Instancia del sensor (-1 = todas)
+  long repeat = 0;           // Consultas repetidas para medir su duración (0 = una sola)
+
+  while ((flags = getopt(argc, argv, "L:Q:t:i:b:")) != -1) {
+    switch (flags) {
+    case 'L': // Bandera del segmento de memoria compartida del monitor
+      shm_name = optarg;
+      break;
+    case 'Q': // Bandera del socket Unix de consultas del monitor
+      socket_path = optarg;
+      break;
+    case 't': // Bandera del tipo de sensor
+      type = atoi(optarg);
+      break;
+    case 'i': // Bandera de la instancia del sensor
+      instance = atol(optarg);
+      break;
+    case 'b': // Bandera de consultas repetidas para medir su duración
+      repeat = atol(optarg);
+      break;
+    default: // Mensaje de uso en caso de argumentos incorrectos
+      fprintf(stderr, "Usage: %s (-L <snapshot-shm> | -Q <snapshot-socket>) [-t <type> [-i <instance>]] "
+                      "[-b <repetitions>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if ((shm_name == NULL) == (socket_path == NULL)) {
+    fprintf(stderr, "Usage: %s (-L <snapshot-shm> | -Q <snapshot-socket>) [-t <type> [-i <instance>]] "
+                    "[-b <repetitions>]\n", argv[0]);
+    return 1;
+  }
+  if (type < 0 || (instance >= 0 && type == 0) || instance > UINT32_MAX || repeat < 0) {
+    fprintf(stderr, "Error: Invalid sensor (an instance needs its type with -t).\n");
+    return 1;
+  }
+  if (repeat > 0 && shm_name && instance < 0) {
+    fprintf(stderr, "Error: Measuring shared-memory reads needs one sensor (-t and -i).\n");
+    return 1;
+  }
+
+  return shm_name ? query_shared(shm_name, type, instance, repeat) : query_socket(socket_path, type, instance, repeat);
+}
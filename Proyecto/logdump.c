@@ -0,0 +1,141 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Manejo de logdump.c (lectura de archivos binarios del monitor)
+**************************************************************/
+
+#include "codec.h"
+#include "logfmt.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Columnas de un bloque comprimido descomprimido
+static int64_t block_ms[LOG_BLOCK_MAX];
+static float block_values[LOG_BLOCK_MAX];
+
+// Muestra un segmento comprimido ("<segmento>.z") con el mismo formato que un archivo binario.
+static size_t dump_compressed(const log_map *map, int64_t start_ms, int64_t end_ms, int blocks_only) {
+  size_t offset = 0;
+  const codec_block_header *block;
+  char first[32], last[32];
+  while ((block = codec_next_block(map, &offset)) != NULL) {
+    if (block->last_ms < start_ms || block->first_ms > end_ms) {
+      continue;
+    }
+
+    if (blocks_only) {
+      log_format_time(block->first_ms, first, sizeof(first));
+      log_format_time(block->last_ms, last, sizeof(last));
+      printf("[%s .. %s] count=%u min=%f max=%f avg=%f compressed=%zu\n", first, last, block->count,
+             block->min, block->max, block->sum / block->count, codec_block_size(block));
+      continue;
+    }
+
+    if (codec_decode(block, block_ms, block_values) == -1) {
+      fprintf(stderr, "Warning: damaged compressed block\n");
+      break;
+    }
+    for (uint32_t i = 0; i < block->count; i++) {
+      if (block_ms[i] < start_ms || block_ms[i] > end_ms) {
+        continue;
+      }
+      log_format_time(block_ms[i], first, sizeof(first));
+      printf("{%s} %f\n", first, block_values[i]);
+    }
+  }
+  return offset;
+}
+
+int main(int argc, char *argv[]) {
+  int flags;                    // Almacena las flags de los argumentos de línea de comandos
+  int64_t start_ms = INT64_MIN; // Inicio del rango de tiempo (incluido)
+  int64_t end_ms = INT64_MAX;   // Fin del rango de tiempo (incluido)
+  int blocks_only = 0;          // 1 para mostrar sólo el resumen de cada bloque
+
+  while ((flags = getopt(argc, argv, "s:e:b")) != -1) {
+    switch (flags) {
+    case 's': // Bandera del inicio del rango
+      if (log_parse_time(optarg, &start_ms) == -1) {
+        fprintf(stderr, "Error: Invalid start time '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case 'e': // Bandera del fin del rango
+      if (log_parse_time(optarg, &end_ms) == -1) {
+        fprintf(stderr, "Error: Invalid end time '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case 'b': // Bandera para mostrar sólo las cabeceras de bloque
+      blocks_only = 1;
+      break;
+    default: // Mensaje de uso en caso de argumentos incorrectos
+      fprintf(stderr, "Usage: %s [-s <start>] [-e <end>] [-b] <binary-or-compressed-file>\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    fprintf(stderr, "Usage: %s [-s <start>] [-e <end>] [-b] <binary-or-compressed-file>\n", argv[0]);
+    return 1;
+  }
+
+  // Proyección del archivo en memoria; los bloques se recorren sin copiar ni convertir texto
+  log_map map;
+  if (log_map_open(argv[optind], &map) == -1) {
+    perror("Error opening the binary file");
+    return 1;
+  }
+  int compressed = codec_is_compressed(&map);
+  if (map.size > 0 && !log_is_binary(&map) && !compressed) {
+    fprintf(stderr, "Error: %s is not a binary monitor file\n", argv[optind]);
+    log_map_close(&map);
+    return 1;
+  }
+
+  size_t offset = 0;
+  const log_block_header *block;
+  char first[32], last[32];
+  if (compressed) {
+    // Los segmentos comprimidos por el monitor (-z) se leen igual, bloque por bloque
+    offset = dump_compressed(&map, start_ms, end_ms, blocks_only);
+  }
+  while (!compressed && (block = log_next_block(&map, &offset)) != NULL) {
+    // Los bloques fuera del rango se saltan usando sólo la cabecera
+    if (block->last_ms < start_ms || block->first_ms > end_ms) {
+      continue;
+    }
+
+    if (blocks_only) {
+      log_format_time(block->first_ms, first, sizeof(first));
+      log_format_time(block->last_ms, last, sizeof(last));
+      printf("[%s .. %s] count=%u min=%f max=%f avg=%f\n", first, last, block->count,
+             block->min, block->max, block->sum / block->count);
+      continue;
+    }
+
+    // Reconstrucción de las marcas de tiempo a partir de las diferencias
+    const uint32_t *deltas = log_block_deltas(block);
+    const float *values = log_block_values(block);
+    int64_t ms = block->first_ms;
+    for (uint32_t i = 0; i < block->count; i++) {
+      ms += deltas[i];
+      if (ms < start_ms || ms > end_ms) {
+        continue;
+      }
+      log_format_time(ms, first, sizeof(first));
+      printf("{%s} %f\n", first, values[i]);
+    }
+  }
+
+  if (offset < map.size) {
+    fprintf(stderr, "Warning: %zu trailing bytes are not a complete block\n", map.size - offset);
+  }
+
+  log_map_close(&map);
+  return 0;
+}
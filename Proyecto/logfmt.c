@@ -0,0 +1,355 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del formato binario por columnas de los archivos de salida
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "logfmt.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Vacía el bloque en construcción.
+void log_block_reset(log_block_builder *b) {
+    b->count = 0;
+    b->sum = 0;
+}
+
+// Agrega una lectura al bloque. Devuelve 1 si el bloque quedó lleno.
+int log_block_add(log_block_builder *b, int64_t ms, float value) {
+    if (b->count == 0) {
+        b->first_ms = ms;
+        b->last_ms = ms;
+        b->min = value;
+        b->max = value;
+    }
+
+    // Si el reloj retrocede se guarda diferencia 0 para mantener el orden.
+    int64_t delta = ms - b->last_ms;
+    if (delta < 0) {
+        delta = 0;
+    }
+    if (delta > UINT32_MAX) {
+        delta = UINT32_MAX;
+    }
+
+    b->deltas[b->count] = (uint32_t)delta;
+    b->values[b->count] = value;
+    b->last_ms += delta;
+    b->sum += value;
+    if (value < b->min) {
+        b->min = value;
+    }
+    if (value > b->max) {
+        b->max = value;
+    }
+    b->count++;
+    return b->count == LOG_BLOCK_MAX;
+}
+
+// Serializa el bloque en out (que debe tener log_block_size(count) bytes) y devuelve su tamaño.
+size_t log_block_encode(const log_block_builder *b, void *out) {
+    log_block_header header = {
+        .magic = LOG_MAGIC,
+        .count = b->count,
+        .first_ms = b->first_ms,
+        .last_ms = b->last_ms,
+        .sum = b->sum,
+        .min = b->min,
+        .max = b->max,
+    };
+
+    unsigned char *p = out;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, b->deltas, b->count * sizeof(uint32_t));
+    p += b->count * sizeof(uint32_t);
+    memcpy(p, b->values, b->count * sizeof(float));
+    return log_block_size(b->count);
+}
+
+// Proyecta un archivo en memoria de sólo lectura. Devuelve 0 o -1 si falla.
+int log_map_open(const char *path, log_map *map) {
+    map->data = NULL;
+    map->size = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    // Un archivo vacío es válido y simplemente no tiene bloques.
+    if (st.st_size > 0) {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+        map->data = data;
+        map->size = (size_t)st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+// Libera la proyección del archivo.
+void log_map_close(log_map *map) {
+    if (map->data) {
+        munmap((void *)map->data, map->size);
+    }
+    map->data = NULL;
+    map->size = 0;
+}
+
+// Devuelve el bloque que empieza en *offset y avanza offset al siguiente.
+// Devuelve NULL al final del archivo o si el bloque está incompleto o dañado.
+const log_block_header *log_next_block(const log_map *map, size_t *offset) {
+    if (*offset + sizeof(log_block_header) > map->size) {
+        return NULL;
+    }
+
+    const log_block_header *h = (const log_block_header *)(map->data + *offset);
+    if (h->magic != LOG_MAGIC || h->count == 0 || h->count > LOG_BLOCK_MAX) {
+        return NULL;
+    }
+    if (*offset + log_block_size(h->count) > map->size) {
+        return NULL;
+    }
+
+    *offset += log_block_size(h->count);
+    return h;
+}
+
+// Indica si el archivo proyectado está en formato binario.
+int log_is_binary(const log_map *map) {
+    uint32_t magic;
+    if (map->size < sizeof(magic)) {
+        return 0;
+    }
+    memcpy(&magic, map->data, sizeof(magic));
+    return magic == LOG_MAGIC;
+}
+
+// Convierte "YYYY-mm-dd HH:MM:SS" (hora local) o un número de segundos desde la época a milisegundos.
+int log_parse_time(const char *text, int64_t *ms) {
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+
+    const char *end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm_info);
+    if (end != NULL && *end == '\0') {
+        tm_info.tm_isdst = -1;
+        *ms = (int64_t)mktime(&tm_info) * 1000;
+        return 0;
+    }
+
+    char *num_end;
+    double seconds = strtod(text, &num_end);
+    if (num_end != text && *num_end == '\0') {
+        *ms = (int64_t)(seconds * 1000);
+        return 0;
+    }
+    return -1;
+}
+
+// Escribe una marca de tiempo en milisegundos como "YYYY-mm-dd HH:MM:SS.mmm" (hora local).
+void log_format_time(int64_t ms, char *out, size_t size) {
+    time_t seconds = (time_t)(ms / 1000);
+    struct tm tm_info;
+    localtime_r(&seconds, &tm_info);
+
+    size_t n = strftime(out, size, "%Y-%m-%d %H:%M:%S", &tm_info);
+    snprintf(out + n, size - n, ".%03d", (int)(ms % 1000));
+}
+
+// Convierte dos dígitos consecutivos en un número (o -1 si no son dígitos).
+static int two_digits(const char *p) {
+    if (p[0] < '0' || p[0] > '9' || p[1] < '0' || p[1] > '9') {
+        return -1;
+    }
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+// Potencias de 10 exactas en double (hasta 10^22 no pierden precisión).
+static const double exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Convierte el número decimal que empieza en p (sin pasar de end) y devuelve
+// dónde termina, o NULL si no hay un número. A diferencia de strtof no depende
+// del locale ni necesita un '\0' al final: acumula los dígitos en un entero y
+// aplica la potencia de 10 con una sola operación. Los casos que no caben en
+// ese camino (más de 19 dígitos o exponentes grandes) se resuelven con strtod.
+const char *log_parse_float(const char *p, const char *end, float *value) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    const char *start = p;
+
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;   // Dígitos significativos acumulados en mantissa
+    int exponent = 0; // Potencia de 10 que falta aplicar
+    int seen = 0;     // Dígitos leídos (incluidos los ceros iniciales)
+    for (; p < end && (unsigned)(*p - '0') < 10; p++, seen++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++, seen++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (seen == 0) {
+        return NULL;
+    }
+
+    // Exponente opcional; si "e" no va seguida de dígitos no forma parte del número.
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int exp_negative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            q++;
+        }
+        if (q < end && (unsigned)(*q - '0') < 10) {
+            int e = 0;
+            for (; q < end && (unsigned)(*q - '0') < 10; q++) {
+                if (e < 10000) {
+                    e = e * 10 + (*q - '0');
+                }
+            }
+            exponent += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    double result;
+    if (mantissa == 0) {
+        result = 0;
+    } else if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        result = exponent < 0 ? (double)mantissa / exact_pow10[-exponent]
+                              : (double)mantissa * exact_pow10[exponent];
+    } else {
+        // Camino lento: copiar el número para strtod, que necesita el '\0' final.
+        char text[64];
+        size_t len = (size_t)(p - start);
+        if (len >= sizeof(text)) {
+            return NULL;
+        }
+        memcpy(text, start, len);
+        text[len] = '\0';
+        *value = (float)strtod(text, NULL);
+        return p;
+    }
+    *value = (float)(negative ? -result : result);
+    return p;
+}
+
+// Decodifica una línea de texto "{YYYY-mm-dd HH:MM:SS} valor" comprendida entre line y end.
+// mktime() sólo se llama cuando cambia la hora; minutos y segundos se suman directamente.
+int log_parse_line(const char *line, const char *end, int64_t *ms, float *value) {
+    static __thread char cached_hour[13];
+    static __thread int64_t cached_hour_ms;
+
+    if (end - line < 23 || line[0] != '{' || line[20] != '}') {
+        return -1;
+    }
+
+    const char *stamp = line + 1;
+    int minutes = two_digits(stamp + 14);
+    int seconds = two_digits(stamp + 17);
+    if (minutes < 0 || seconds < 0) {
+        return -1;
+    }
+
+    // Recalcular el inicio de la hora sólo si cambió "YYYY-mm-dd HH".
+    if (memcmp(cached_hour, stamp, sizeof(cached_hour)) != 0) {
+        struct tm tm_info;
+        memset(&tm_info, 0, sizeof(tm_info));
+        char hour[20];
+        memcpy(hour, stamp, 13);
+        memcpy(hour + 13, ":00:00", 7);
+        if (strptime(hour, "%Y-%m-%d %H:%M:%S", &tm_info) == NULL) {
+            return -1;
+        }
+        tm_info.tm_isdst = -1;
+        cached_hour_ms = (int64_t)mktime(&tm_info) * 1000;
+        memcpy(cached_hour, stamp, sizeof(cached_hour));
+    }
+
+    if (log_parse_float(line + 21, end, value) == NULL) {
+        return -1;
+    }
+    *ms = cached_hour_ms + (int64_t)(minutes * 60 + seconds) * 1000;
+    return 0;
+}
+
+// Recorre las lecturas completas entre los bytes from y to del archivo y llama a visit con cada una.
+// Devuelve la posición donde termina la última lectura completa recorrida.
+size_t log_scan(const log_map *map, int binary, size_t from, size_t to, log_visit visit, void *ctx) {
+    if (to > map->size) {
+        to = map->size;
+    }
+
+    if (binary) {
+        const log_map window = { map->data, to };
+        size_t offset = from;
+        const log_block_header *block;
+        while ((block = log_next_block(&window, &offset)) != NULL) {
+            const uint32_t *deltas = log_block_deltas(block);
+            const float *values = log_block_values(block);
+            int64_t ms = block->first_ms;
+            for (uint32_t i = 0; i < block->count; i++) {
+                ms += deltas[i];
+                visit(ms, values[i], ctx);
+            }
+        }
+        return offset;
+    }
+
+    const char *p = (const char *)map->data + from;
+    const char *limit = (const char *)map->data + to;
+    while (p < limit) {
+        const char *newline = memchr(p, '\n', (size_t)(limit - p));
+        if (newline == NULL) {
+            break;
+        }
+
+        int64_t ms;
+        float value;
+        if (log_parse_line(p, newline, &ms, &value) == 0) {
+            visit(ms, value, ctx);
+        }
+        p = newline + 1;
+    }
+    return (size_t)(p - (const char *)map->data);
+}
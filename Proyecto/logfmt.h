@@ -0,0 +1,83 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del formato binario por columnas de los archivos de salida
+**************************************************************/
+
+#ifndef LOGFMT_H
+#define LOGFMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Un archivo binario es una secuencia de bloques. Cada bloque tiene una
+// cabecera fija seguida de dos columnas:
+//   uint32_t delta_ms[count]  milisegundos desde la lectura anterior (la primera es 0)
+//   float    value[count]     valores medidos
+// La cabecera guarda el resumen del bloque para poder saltarlo sin leer sus datos.
+
+#define LOG_MAGIC 0x474F4C53u // "SLOG" en little endian
+#define LOG_BLOCK_MAX 4096    // Máximo de lecturas por bloque
+
+// Cabecera de cada bloque (40 bytes, múltiplo de 8 para alinear el siguiente)
+typedef struct {
+    uint32_t magic;    // LOG_MAGIC
+    uint32_t count;    // Lecturas en el bloque
+    int64_t first_ms;  // Marca de tiempo de la primera lectura (ms desde la época)
+    int64_t last_ms;   // Marca de tiempo de la última lectura
+    double sum;        // Suma de los valores
+    float min, max;    // Valor mínimo y máximo
+} log_block_header;
+
+// Bloque en construcción dentro del escritor
+typedef struct {
+    int64_t first_ms;                // Marca de tiempo de la primera lectura
+    int64_t last_ms;                 // Marca de tiempo de la última lectura
+    uint32_t count;                  // Lecturas acumuladas
+    float min, max;                  // Extremos acumulados
+    double sum;                      // Suma acumulada
+    uint32_t deltas[LOG_BLOCK_MAX];  // Columna de diferencias de tiempo
+    float values[LOG_BLOCK_MAX];     // Columna de valores
+} log_block_builder;
+
+// Archivo binario proyectado en memoria para lectura
+typedef struct {
+    const unsigned char *data; // Inicio de la proyección
+    size_t size;               // Tamaño del archivo
+} log_map;
+
+// Función que recibe cada lectura recorrida por log_scan
+typedef void (*log_visit)(int64_t ms, float value, void *ctx);
+
+// Tamaño en bytes de un bloque con count lecturas.
+static inline size_t log_block_size(uint32_t count) {
+    return sizeof(log_block_header) + (size_t)count * (sizeof(uint32_t) + sizeof(float));
+}
+
+// Columna de diferencias de tiempo de un bloque proyectado.
+static inline const uint32_t *log_block_deltas(const log_block_header *h) {
+    return (const uint32_t *)(h + 1);
+}
+
+// Columna de valores de un bloque proyectado.
+static inline const float *log_block_values(const log_block_header *h) {
+    return (const float *)(log_block_deltas(h) + h->count);
+}
+
+// Prototipos de funciones
+void log_block_reset(log_block_builder *b);                  // Vacía el bloque en construcción
+int log_block_add(log_block_builder *b, int64_t ms, float value); // Agrega una lectura; 1 si quedó lleno
+size_t log_block_encode(const log_block_builder *b, void *out); // Serializa el bloque; devuelve su tamaño
+int log_map_open(const char *path, log_map *map);            // Proyecta un archivo binario en memoria
+void log_map_close(log_map *map);                            // Libera la proyección
+const log_block_header *log_next_block(const log_map *map, size_t *offset); // Siguiente bloque válido o NULL
+int log_is_binary(const log_map *map);                       // 1 si el archivo empieza con un bloque binario
+int log_parse_time(const char *text, int64_t *ms);           // Convierte "YYYY-mm-dd HH:MM:SS" o segundos a ms
+void log_format_time(int64_t ms, char *out, size_t size);    // Escribe "YYYY-mm-dd HH:MM:SS.mmm"
+const char *log_parse_float(const char *p, const char *end, float *value); // Convierte un número decimal; NULL si no hay
+int log_parse_line(const char *line, const char *end, int64_t *ms, float *value); // Decodifica "{fecha} valor"
+size_t log_scan(const log_map *map, int binary, size_t from, size_t to, log_visit visit, void *ctx); // Recorre lecturas
+
+#endif // LOGFMT_H
@@ -0,0 +1,195 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del índice disperso de los archivos de salida
+**************************************************************/
+
+#include "logindex.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Agrega una entrada al índice en memoria, ampliando el arreglo si hace falta.
+static int append_entry(log_index *index, size_t *capacity, const log_index_entry *entry) {
+    if (index->header.entries == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        log_index_entry *entries = realloc(index->entries, grown * sizeof(log_index_entry));
+        if (!entries) {
+            return -1;
+        }
+        index->entries = entries;
+        *capacity = grown;
+    }
+    index->entries[index->header.entries++] = *entry;
+    return 0;
+}
+
+// Carga el índice guardado. Devuelve 0 si es utilizable para el archivo actual o -1 si hay que rehacerlo.
+static int load_index(const char *idx_path, const log_map *map, int binary, uint32_t per_entry,
+                      log_index *index, size_t *capacity) {
+    int fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    log_index_header header;
+    if (read(fd, &header, sizeof(header)) != sizeof(header) || header.magic != LOG_INDEX_MAGIC ||
+        header.version != LOG_INDEX_VERSION || header.binary != (uint32_t)binary ||
+        header.per_entry != per_entry || header.indexed_bytes > map->size) {
+        // Índice de otro formato o de un archivo que fue truncado o reemplazado.
+        close(fd);
+        return -1;
+    }
+
+    size_t bytes = header.entries * sizeof(log_index_entry);
+    log_index_entry *entries = malloc(bytes ? bytes : 1);
+    if (!entries || read(fd, entries, bytes) != (ssize_t)bytes) {
+        free(entries);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    index->header = header;
+    index->entries = entries;
+    *capacity = header.entries;
+    return 0;
+}
+
+// Indexa los bloques binarios nuevos (un bloque por entrada).
+static int index_binary(const log_map *map, log_index *index, size_t *capacity) {
+    size_t offset = index->header.indexed_bytes;
+    size_t start = offset;
+    const log_block_header *block;
+
+    while ((block = log_next_block(map, &offset)) != NULL) {
+        log_index_entry entry = {
+            .first_ms = block->first_ms,
+            .last_ms = block->last_ms,
+            .offset = start,
+            .length = offset - start,
+            .count = block->count,
+            .min = block->min,
+            .max = block->max,
+            .sum = block->sum,
+        };
+        if (append_entry(index, capacity, &entry) == -1) {
+            return -1;
+        }
+        start = offset;
+    }
+    index->header.indexed_bytes = start;
+    return 0;
+}
+
+// Indexa las líneas de texto nuevas en grupos completos de per_entry lecturas.
+// El grupo final incompleto no se indexa; las consultas lo recorren directamente.
+static int index_text(const log_map *map, log_index *index, size_t *capacity) {
+    const char *base = (const char *)map->data;
+    const char *p = base + index->header.indexed_bytes;
+    const char *limit = base + map->size;
+    const char *group_start = p;
+    log_index_entry entry = { 0 };
+
+    while (p < limit) {
+        const char *newline = memchr(p, '\n', (size_t)(limit - p));
+        if (newline == NULL) {
+            break;
+        }
+
+        int64_t ms;
+        float value;
+        if (log_parse_line(p, newline, &ms, &value) == 0) {
+            if (entry.count == 0) {
+                entry.first_ms = ms;
+                entry.min = value;
+                entry.max = value;
+            }
+            entry.last_ms = ms > entry.last_ms ? ms : entry.last_ms;
+            entry.min = value < entry.min ? value : entry.min;
+            entry.max = value > entry.max ? value : entry.max;
+            entry.sum += value;
+            entry.count++;
+        }
+        p = newline + 1;
+
+        if (entry.count == index->header.per_entry) {
+            entry.offset = (uint64_t)(group_start - base);
+            entry.length = (uint64_t)(p - group_start);
+            if (append_entry(index, capacity, &entry) == -1) {
+                return -1;
+            }
+            index->header.indexed_bytes = (uint64_t)(p - base);
+            memset(&entry, 0, sizeof(entry));
+            group_start = p;
+        }
+    }
+    return 0;
+}
+
+// Guarda el índice. Si sólo se agregaron entradas se escriben las nuevas y la cabecera.
+static int save_index(const char *idx_path, const log_index *index, uint64_t saved_entries) {
+    int fd = open(idx_path, O_WRONLY | O_CREAT | O_CLOEXEC | (saved_entries == 0 ? O_TRUNC : 0), 0644);
+    if (fd == -1) {
+        return -1;
+    }
+
+    size_t new_bytes = (index->header.entries - saved_entries) * sizeof(log_index_entry);
+    off_t position = (off_t)(sizeof(log_index_header) + saved_entries * sizeof(log_index_entry));
+    int result = 0;
+    if (pwrite(fd, index->entries + saved_entries, new_bytes, position) != (ssize_t)new_bytes ||
+        pwrite(fd, &index->header, sizeof(index->header), 0) != sizeof(index->header)) {
+        result = -1;
+    }
+    close(fd);
+    return result;
+}
+
+// Carga el índice de path (creándolo si no existe) y le agrega las lecturas
+// escritas desde la última vez, sin volver a recorrer lo ya indexado.
+int log_index_update(const char *path, const log_map *map, uint32_t per_entry, log_index *index) {
+    char idx_path[4096];
+    snprintf(idx_path, sizeof(idx_path), "%s.idx", path);
+
+    int binary = log_is_binary(map);
+    if (binary) {
+        per_entry = 0;
+    }
+
+    size_t capacity = 0;
+    memset(index, 0, sizeof(*index));
+    if (load_index(idx_path, map, binary, per_entry, index, &capacity) == -1) {
+        index->header.magic = LOG_INDEX_MAGIC;
+        index->header.version = LOG_INDEX_VERSION;
+        index->header.binary = (uint32_t)binary;
+        index->header.per_entry = per_entry;
+    }
+
+    uint64_t saved_entries = index->header.entries;
+    uint64_t saved_bytes = index->header.indexed_bytes;
+    int result = binary ? index_binary(map, index, &capacity) : index_text(map, index, &capacity);
+    if (result == -1) {
+        log_index_free(index);
+        return -1;
+    }
+
+    // Guardar sólo si se indexó algo nuevo (o el índice no existía).
+    if (index->header.indexed_bytes != saved_bytes || saved_entries == 0) {
+        if (save_index(idx_path, index, saved_entries) == -1) {
+            perror("Warning: could not save the index");
+        }
+    }
+    return 0;
+}
+
+// Libera las entradas del índice.
+void log_index_free(log_index *index) {
+    free(index->entries);
+    index->entries = NULL;
+    index->header.entries = 0;
+}
@@ -0,0 +1,56 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del índice disperso de los archivos de salida
+**************************************************************/
+
+#ifndef LOGINDEX_H
+#define LOGINDEX_H
+
+#include <stdint.h>
+#include "logfmt.h"
+
+// El índice de "<archivo>" se guarda en "<archivo>.idx": una cabecera y una
+// entrada por cada grupo de lecturas consecutivas (un bloque en formato
+// binario, per_entry líneas en formato texto). Cada entrada resume su grupo
+// para que las consultas salten los grupos que no pueden coincidir.
+
+#define LOG_INDEX_MAGIC 0x58444953u // "SIDX" en little endian
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_PER_ENTRY 1024    // Líneas de texto por entrada por defecto
+
+// Cabecera del archivo de índice
+typedef struct {
+    uint32_t magic;          // LOG_INDEX_MAGIC
+    uint32_t version;        // LOG_INDEX_VERSION
+    uint32_t binary;         // 1 si el archivo indexado está en formato binario
+    uint32_t per_entry;      // Líneas de texto por entrada
+    uint64_t indexed_bytes;  // Bytes del archivo ya cubiertos por las entradas
+    uint64_t entries;        // Cantidad de entradas
+} log_index_header;
+
+// Resumen de un grupo de lecturas
+typedef struct {
+    int64_t first_ms;  // Primera marca de tiempo del grupo
+    int64_t last_ms;   // Última marca de tiempo del grupo
+    uint64_t offset;   // Posición del grupo en el archivo
+    uint64_t length;   // Bytes que ocupa el grupo
+    uint32_t count;    // Lecturas del grupo
+    float min, max;    // Extremos de los valores
+    uint32_t reserved; // Relleno para alinear sum
+    double sum;        // Suma de los valores
+} log_index_entry;
+
+// Índice cargado en memoria
+typedef struct {
+    log_index_header header;  // Cabecera
+    log_index_entry *entries; // Entradas (header.entries elementos)
+} log_index;
+
+// Prototipos de funciones
+int log_index_update(const char *path, const log_map *map, uint32_t per_entry, log_index *index); // Carga y pone al día
+void log_index_free(log_index *index); // Libera las entradas
+
+#endif // LOGINDEX_H
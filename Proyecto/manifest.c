@@ -0,0 +1,102 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del manifiesto de los segmentos de un archivo de salida
+**************************************************************/
+
+#include "manifest.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Lee el manifiesto y deja una entrada por segmento con su última línea.
+// Un manifiesto que no existe es válido y no tiene segmentos.
+int manifest_load(const char *path, manifest *m) {
+    memset(m, 0, sizeof(*m));
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    size_t capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        manifest_entry e;
+        long long first, last;
+        unsigned long long count, bytes;
+        if (sscanf(line, "state=%15s segment=%255s first_ms=%lld last_ms=%lld count=%llu bytes=%llu",
+                   e.state, e.segment, &first, &last, &count, &bytes) != 6) {
+            continue; // Línea incompleta (por ejemplo, la última de un monitor interrumpido)
+        }
+        e.first_ms = first;
+        e.last_ms = last;
+        e.count = count;
+        e.bytes = bytes;
+
+        // Las líneas de un mismo segmento están cerca del final: se busca desde atrás.
+        size_t i = m->count;
+        while (i > 0 && strcmp(m->entries[i - 1].segment, e.segment) != 0) {
+            i--;
+        }
+        if (i > 0) {
+            m->entries[i - 1] = e;
+            continue;
+        }
+
+        if (m->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            manifest_entry *entries = realloc(m->entries, capacity * sizeof(manifest_entry));
+            if (!entries) {
+                fclose(f);
+                manifest_free(m);
+                return -1;
+            }
+            m->entries = entries;
+        }
+        m->entries[m->count++] = e;
+    }
+    fclose(f);
+    return 0;
+}
+
+// Libera las entradas del manifiesto.
+void manifest_free(manifest *m) {
+    free(m->entries);
+    m->entries = NULL;
+    m->count = 0;
+}
+
+// Agrega una línea con un solo write() en modo añadir, así las líneas del
+// consumidor y del hilo compresor nunca se mezclan.
+int manifest_append(const char *path, const manifest_entry *e) {
+    char line[512];
+    int n = snprintf(line, sizeof(line), "state=%s segment=%s first_ms=%lld last_ms=%lld count=%llu bytes=%llu\n",
+                     e->state, e->segment, (long long)e->first_ms, (long long)e->last_ms,
+                     (unsigned long long)e->count, (unsigned long long)e->bytes);
+    if (n < 0 || (size_t)n >= sizeof(line)) {
+        return -1;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    int result = write(fd, line, (size_t)n) == n ? 0 : -1;
+    close(fd);
+    return result;
+}
+
+// Escribe en out la ruta del archivo del segmento: su nombre en el directorio
+// del manifiesto, con ".z" si está comprimido. Devuelve 0 o -1 si no cabe.
+int manifest_file(const char *path, const manifest_entry *e, char *out, size_t size) {
+    const char *slash = strrchr(path, '/');
+    int dir_len = slash ? (int)(slash - path) + 1 : 0;
+    int n = snprintf(out, size, "%.*s%s%s", dir_len, path, e->segment,
+                     strcmp(e->state, "compressed") == 0 ? ".z" : "");
+    return n < 0 || (size_t)n >= size ? -1 : 0;
+}
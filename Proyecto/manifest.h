@@ -0,0 +1,47 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del manifiesto de los segmentos de un archivo de salida
+**************************************************************/
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Con rotación, las lecturas de "<archivo>" se guardan en segmentos
+// "<archivo>.<YYYYmmdd-HHMMSS>" y "<archivo>.manifest" registra cada cambio de
+// estado de un segmento con una línea (sólo se agregan líneas al final):
+//   state=<estado> segment=<nombre> first_ms=<ms> last_ms=<ms> count=<n> bytes=<n>
+// Estados: open (recibiendo lecturas; last_ms = -1), closed (rotado, en
+// texto o binario) y compressed (el archivo es "<nombre>.z"). La última línea
+// de cada segmento es la vigente. Los nombres son relativos al directorio del manifiesto.
+
+#define MANIFEST_NAME_LEN 256 // Longitud máxima del nombre de un segmento
+
+// Estado vigente de un segmento
+typedef struct {
+    char state[16];                  // "open", "closed" o "compressed"
+    char segment[MANIFEST_NAME_LEN]; // Nombre del segmento (sin ".z")
+    int64_t first_ms;                // Primera lectura
+    int64_t last_ms;                 // Última lectura (-1 si el segmento sigue abierto)
+    uint64_t count;                  // Lecturas
+    uint64_t bytes;                  // Tamaño del archivo
+} manifest_entry;
+
+// Manifiesto cargado en memoria
+typedef struct {
+    manifest_entry *entries; // Un elemento por segmento, en orden de creación
+    size_t count;            // Cantidad de segmentos
+} manifest;
+
+// Prototipos de funciones
+int manifest_load(const char *path, manifest *m);   // Lee el estado vigente de cada segmento
+void manifest_free(manifest *m);                    // Libera las entradas
+int manifest_append(const char *path, const manifest_entry *e); // Agrega una línea al final
+int manifest_file(const char *path, const manifest_entry *e, char *out, size_t size); // Ruta del archivo del segmento
+
+#endif // MANIFEST_H
@@ -0,0 +1,442 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de las métricas en vivo del monitor
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "metrics.h"
+#include "bcast.h"
+#include "channel.h"
+#include "ingest.h"
+#include "journal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define METRICS_FILE_MS 1000   // Periodo de reescritura del archivo de métricas
+#define METRICS_REQUEST_MS 100 // Espera máxima de la petición de un cliente del socket
+
+static pthread_t metrics_thread;   // Hilo que atiende el socket y reescribe el archivo
+static int metrics_running = 0;    // 1 si el hilo está activo
+static int listen_fd = -1;         // Socket Unix de consulta (-1 si no hay)
+static int stop_fd = -1;           // eventfd que despierta al hilo para terminar
+static const char *metrics_file;   // Archivo de métricas (NULL si no hay)
+
+// Registra una duración en nanosegundos.
+void metric_observe(metric_hist *h, uint64_t ns) {
+    // Cubeta i: hasta 2^i microsegundos (redondeando hacia arriba).
+    uint64_t us = (ns + 999) / 1000;
+    int bucket = us <= 1 ? 0 : 64 - __builtin_clzll(us - 1);
+    if (bucket > METRIC_BUCKETS) {
+        bucket = METRIC_BUCKETS;
+    }
+    metric_add(&h->buckets[bucket], 1);
+    metric_add(&h->count, 1);
+    metric_add(&h->sum_ns, ns);
+}
+
+// Escribe las etiquetas de una muestra: el canal (escapando \ y ") y, si se da,
+// una segunda etiqueta key (la cubeta "le" o la parte "shard").
+static void write_label(FILE *out, const char *name, const char *key, const char *value) {
+    fputs("{channel=\"", out);
+    for (const char *c = name; *c; c++) {
+        if (*c == '\\' || *c == '"') {
+            fputc('\\', out);
+        }
+        fputc(*c, out);
+    }
+    if (key) {
+        fprintf(out, "\",%s=\"%s", key, value);
+    }
+    fputs("\"}", out);
+}
+
+// Encabezado de una familia de métricas.
+static void write_header(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Contador en offset dentro del canal o, si in_shard es 1, suma del contador en offset de cada parte.
+static uint64_t read_counter(channel *ch, size_t offset, int in_shard) {
+    if (!in_shard) {
+        return metric_read((metric_counter *)((char *)ch + offset));
+    }
+    uint64_t total = 0;
+    for (int k = 0; k < channel_shards; k++) {
+        total += metric_read((metric_counter *)((char *)&ch->shards[k] + offset));
+    }
+    return total;
+}
+
+// Métrica de un valor por canal (del canal o sumada entre sus partes).
+static void write_per_channel(FILE *out, const char *name, const char *type, const char *help,
+                              size_t offset, int in_shard) {
+    write_header(out, name, type, help);
+    for (int i = 0; i < channel_count; i++) {
+        fputs(name, out);
+        write_label(out, channels[i].name, NULL, NULL);
+        fprintf(out, " %llu\n", (unsigned long long)read_counter(&channels[i], offset, in_shard));
+    }
+}
+
+// Histograma por canal (cubetas acumuladas en segundos). Con in_shard offset
+// apunta a un histograma de cada parte y se suman sus cubetas.
+static void write_hist(FILE *out, const char *name, const char *help, size_t offset, int in_shard) {
+    write_header(out, name, "histogram", help);
+    for (int i = 0; i < channel_count; i++) {
+        channel *ch = &channels[i];
+        const char *label = ch->name;
+        uint64_t cumulative = 0;
+
+        for (int b = 0; b <= METRIC_BUCKETS; b++) {
+            char le[32];
+            if (b < METRIC_BUCKETS) {
+                snprintf(le, sizeof(le), "%g", (double)(1ULL << b) / 1e6);
+            } else {
+                strcpy(le, "+Inf");
+            }
+            cumulative += read_counter(ch, offset + offsetof(metric_hist, buckets[b]), in_shard);
+            fprintf(out, "%s_bucket", name);
+            write_label(out, label, "le", le);
+            fprintf(out, " %llu\n", (unsigned long long)cumulative);
+        }
+        fprintf(out, "%s_sum", name);
+        write_label(out, label, NULL, NULL);
+        fprintf(out, " %.9f\n", read_counter(ch, offset + offsetof(metric_hist, sum_ns), in_shard) / 1e9);
+        fprintf(out, "%s_count", name);
+        write_label(out, label, NULL, NULL);
+        fprintf(out, " %llu\n",
+                (unsigned long long)read_counter(ch, offset + offsetof(metric_hist, count), in_shard));
+    }
+}
+
+// Escribe todas las métricas en formato de texto de Prometheus.
+void metrics_write(FILE *out) {
+    // Recolector
+    write_header(out, "monitor_ingest_malformed_total", "counter",
+                 "Records with an invalid format or sensor type.");
+    fprintf(out, "monitor_ingest_malformed_total %llu\n",
+            (unsigned long long)metric_read(&ingest_counters.malformed));
+    write_header(out, "monitor_ingest_oversized_total", "counter",
+                 "Records discarded for exceeding the maximum record length.");
+    fprintf(out, "monitor_ingest_oversized_total %llu\n",
+            (unsigned long long)metric_read(&ingest_counters.oversized));
+    write_header(out, "monitor_ingest_bytes_total", "counter", "Bytes read from all sensor sources.");
+    fprintf(out, "monitor_ingest_bytes_total %llu\n",
+            (unsigned long long)metric_read(&ingest_counters.bytes));
+    write_header(out, "monitor_ingest_wakeups_total", "counter",
+                 "Collector wakeups with ready sources.");
+    fprintf(out, "monitor_ingest_wakeups_total %llu\n",
+            (unsigned long long)metric_read(&ingest_counters.wakeups));
+    write_header(out, "monitor_ingest_sources", "gauge", "Open sensor pipes and connections.");
+    fprintf(out, "monitor_ingest_sources %lld\n",
+            (long long)metric_get(&ingest_counters.sources));
+
+    // Difusión a los suscriptores
+    if (bcast_enabled) {
+        write_header(out, "monitor_broadcast_published_total", "counter",
+                     "Samples published to the broadcast buffer.");
+        fprintf(out, "monitor_broadcast_published_total %llu\n",
+                (unsigned long long)metric_read(&bcast_counters.published));
+        write_header(out, "monitor_broadcast_wakeups_total", "counter",
+                     "Wakeups of the waiting subscribers (one per collector batch).");
+        fprintf(out, "monitor_broadcast_wakeups_total %llu\n",
+                (unsigned long long)metric_read(&bcast_counters.wakeups));
+        write_header(out, "monitor_broadcast_subscribers", "gauge", "Connected subscribers.");
+        fprintf(out, "monitor_broadcast_subscribers %lld\n",
+                (long long)metric_get(&bcast_counters.subscribers));
+    }
+
+    // Diario de ingesta
+    if (journal_enabled) {
+        write_header(out, "monitor_journal_records_total", "counter", "Samples written to the ingestion journal.");
+        fprintf(out, "monitor_journal_records_total %llu\n",
+                (unsigned long long)metric_read(&journal_counters.records));
+        write_header(out, "monitor_journal_commits_total", "counter",
+                     "Group commits of the journal (one write per collector batch).");
+        fprintf(out, "monitor_journal_commits_total %llu\n",
+                (unsigned long long)metric_read(&journal_counters.commits));
+        write_header(out, "monitor_journal_duplicates_total", "counter",
+                     "Samples resent by sensors that were already in the journal.");
+        fprintf(out, "monitor_journal_duplicates_total %llu\n",
+                (unsigned long long)metric_read(&journal_counters.duplicates));
+        write_header(out, "monitor_journal_replayed_total", "counter", "Samples replayed from the journal at startup.");
+        fprintf(out, "monitor_journal_replayed_total %llu\n",
+                (unsigned long long)metric_read(&journal_counters.replayed));
+        write_header(out, "monitor_journal_checkpoints_total", "counter", "Output checkpoints saved by the consumers.");
+        fprintf(out, "monitor_journal_checkpoints_total %llu\n",
+                (unsigned long long)metric_read(&journal_counters.checkpoints));
+    }
+
+    // Buffers de los canales
+    write_per_channel(out, "monitor_channel_pushed_total", "counter",
+                      "Samples queued by the collector.", offsetof(channel, pushed), 0);
+    write_per_channel(out, "monitor_channel_push_blocked_total", "counter",
+                      "Times a full buffer paused a sensor source (block policy).",
+                      offsetof(channel, push_blocked), 0);
+    write_hist(out, "monitor_channel_push_wait_seconds",
+               "Time a sensor source stayed paused by a full buffer.", offsetof(channel, push_wait), 0);
+    write_per_channel(out, "monitor_channel_dropped_total", "counter",
+                      "Samples discarded by the drop-oldest and drop-newest policies.",
+                      offsetof(channel, dropped), 0);
+    write_per_channel(out, "monitor_channel_coalesced_total", "counter",
+                      "Samples replaced by a newer one (coalesce policy).", offsetof(channel, coalesced), 0);
+
+    // Profundidad y capacidad de los buffers: total del canal y por parte (para ver si el reparto está desbalanceado).
+    write_header(out, "monitor_channel_queue_depth", "gauge", "Samples waiting in the channel buffers.");
+    for (int i = 0; i < channel_count; i++) {
+        size_t depth = 0;
+        for (int k = 0; k < channel_shards; k++) {
+            depth += ring_depth(&channels[i].shards[k].ring);
+        }
+        fputs("monitor_channel_queue_depth", out);
+        write_label(out, channels[i].name, NULL, NULL);
+        fprintf(out, " %zu\n", depth);
+    }
+    write_header(out, "monitor_channel_queue_capacity", "gauge", "Capacity of the channel buffers.");
+    for (int i = 0; i < channel_count; i++) {
+        fputs("monitor_channel_queue_capacity", out);
+        write_label(out, channels[i].name, NULL, NULL);
+        fprintf(out, " %zu\n", channels[i].shards[0].ring.capacity * (size_t)channel_shards);
+    }
+    write_header(out, "monitor_shard_queue_depth", "gauge", "Samples waiting in the buffer of each channel consumer.");
+    for (int i = 0; i < channel_count; i++) {
+        for (int k = 0; k < channel_shards; k++) {
+            char shard[16];
+            snprintf(shard, sizeof(shard), "%d", k);
+            fputs("monitor_shard_queue_depth", out);
+            write_label(out, channels[i].name, "shard", shard);
+            fprintf(out, " %zu\n", ring_depth(&channels[i].shards[k].ring));
+        }
+    }
+
+    // Consumidores
+    write_per_channel(out, "monitor_channel_received_total", "counter",
+                      "Samples processed by the channel consumer.", offsetof(channel_shard, received), 1);
+    write_per_channel(out, "monitor_channel_accepted_total", "counter",
+                      "Samples within range written to the channel file.", offsetof(channel_shard, accepted), 1);
+    write_per_channel(out, "monitor_channel_out_of_range_total", "counter",
+                      "Samples outside the channel range.", offsetof(channel_shard, out_of_range), 1);
+    write_per_channel(out, "monitor_channel_alerts_total", "counter",
+                      "Anomaly alerts (raised and cleared) written to the alert sink.",
+                      offsetof(channel_shard, alerts), 1);
+    write_per_channel(out, "monitor_channel_alerts_suppressed_total", "counter",
+                      "Anomaly alerts not written because of the alert rate limit.",
+                      offsetof(channel_shard, alerts_suppressed), 1);
+
+    // Antigüedad de la última lectura procesada: crece si el canal se atrasa o el sensor calla.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    write_header(out, "monitor_channel_last_sample_age_seconds", "gauge",
+                 "Seconds since the channel consumer processed its last sample.");
+    for (int i = 0; i < channel_count; i++) {
+        int64_t last = 0;
+        for (int k = 0; k < channel_shards; k++) {
+            if (metric_get(&channels[i].shards[k].last_ns) > last) {
+                last = metric_get(&channels[i].shards[k].last_ns);
+            }
+        }
+        if (last > 0) {
+            fputs("monitor_channel_last_sample_age_seconds", out);
+            write_label(out, channels[i].name, NULL, NULL);
+            fprintf(out, " %.3f\n", (now_ns - last) / 1e9);
+        }
+    }
+
+    // Archivos de salida
+    write_per_channel(out, "monitor_channel_writes_total", "counter",
+                      "Batched writes to the channel file.", offsetof(channel_shard, output.writes), 1);
+    write_per_channel(out, "monitor_channel_written_bytes_total", "counter",
+                      "Bytes written to the channel file.", offsetof(channel_shard, output.bytes), 1);
+    write_hist(out, "monitor_channel_write_seconds", "Duration of each batched write (and fdatasync).",
+               offsetof(channel_shard, output.write_time), 1);
+    write_hist(out, "monitor_channel_latency_seconds",
+               "End-to-end latency from the sensor send time to the file write.",
+               offsetof(channel_shard, output.latency), 1);
+}
+
+// Escribe len bytes completos en un descriptor.
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Reescribe el archivo de métricas de forma atómica (archivo temporal + rename).
+static void write_metrics_file(void) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", metrics_file);
+    FILE *out = fopen(tmp, "w");
+    if (out == NULL) {
+        perror("Error writing the metrics file");
+        return;
+    }
+    metrics_write(out);
+    if (fclose(out) != 0 || rename(tmp, metrics_file) == -1) {
+        perror("Error writing the metrics file");
+    }
+}
+
+// Atiende a un cliente del socket: responde las métricas y cierra la conexión.
+// Si el cliente envía una petición HTTP (por ejemplo curl --unix-socket) se
+// responde con encabezados HTTP; si no envía nada, sólo con el texto.
+static void serve_client(int fd) {
+    char request[256];
+    ssize_t n = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    if (poll(&pfd, 1, METRICS_REQUEST_MS) > 0) {
+        n = read(fd, request, sizeof(request));
+    }
+
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    if (out == NULL) {
+        close(fd);
+        return;
+    }
+    metrics_write(out);
+    fclose(out);
+
+    if (n >= 4 && memcmp(request, "GET ", 4) == 0) {
+        char header[160];
+        int header_len = snprintf(header, sizeof(header),
+                                  "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\n\r\n", len);
+        write_all(fd, header, (size_t)header_len);
+    }
+    write_all(fd, text, len);
+    free(text);
+    close(fd);
+}
+
+// Hilo de exportación: atiende el socket y reescribe el archivo periódicamente.
+static void *metrics_loop(void *param) {
+    (void)param;
+    struct pollfd fds[2] = { { .fd = stop_fd, .events = POLLIN }, { .fd = listen_fd, .events = POLLIN } };
+    int nfds = listen_fd != -1 ? 2 : 1;
+
+    while (1) {
+        if (metrics_file) {
+            write_metrics_file();
+        }
+
+        int ready = poll(fds, nfds, metrics_file ? METRICS_FILE_MS : -1);
+        if (ready == -1 && errno != EINTR) {
+            perror("Error waiting for metrics clients");
+            break;
+        }
+        if (ready > 0 && fds[0].revents) {
+            break;
+        }
+        if (ready > 0 && nfds == 2 && fds[1].revents) {
+            int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client != -1) {
+                // Un cliente que no lee no debe detener la exportación.
+                struct timeval limit = { 1, 0 };
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+                serve_client(client);
+            }
+        }
+    }
+
+    // Última foto con los totales finales
+    if (metrics_file) {
+        write_metrics_file();
+    }
+    return NULL;
+}
+
+// Abre el socket Unix de consulta de métricas.
+static int open_listener(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("Error creating the metrics socket");
+        return -1;
+    }
+
+    // Un socket que quedó de una ejecución anterior impediría el bind.
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 16) == -1) {
+        perror("Error listening on the metrics socket");
+        close(fd);
+        return -1;
+    }
+    printf("Serving metrics on socket: '%s'\n", path);
+    return fd;
+}
+
+// Inicia el hilo que expone las métricas por socket y/o archivo (ambos opcionales).
+int metrics_start(const char *socket_path, const char *file_path) {
+    if (!socket_path && !file_path) {
+        return 0;
+    }
+
+    if (socket_path && (listen_fd = open_listener(socket_path)) == -1) {
+        return -1;
+    }
+    metrics_file = file_path;
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd == -1 || pthread_create(&metrics_thread, NULL, metrics_loop, NULL) != 0) {
+        perror("Error starting the metrics thread");
+        return -1;
+    }
+    metrics_running = 1;
+    return 0;
+}
+
+// Detiene el hilo de exportación (escribe una última vez el archivo).
+void metrics_stop(void) {
+    if (!metrics_running) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) == -1) {
+        perror("Error stopping the metrics thread");
+    }
+    pthread_join(metrics_thread, NULL);
+    metrics_running = 0;
+
+    close(stop_fd);
+    if (listen_fd != -1) {
+        close(listen_fd);
+    }
+}
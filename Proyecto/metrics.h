@@ -0,0 +1,67 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de las métricas en vivo del monitor
+**************************************************************/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Cada contador tiene un único hilo que lo escribe (el recolector o el
+// consumidor de su canal), así que se actualiza con una lectura y una
+// escritura relajadas, sin instrucciones atómicas de lectura-modificación.
+// Los lectores (la exportación de métricas) sólo necesitan ver valores enteros.
+
+#define METRIC_BUCKETS 24 // Cubetas de tiempo: <= 1 µs, 2 µs, 4 µs ... 2^23 µs (~8 s), más +Inf
+
+typedef _Atomic uint64_t metric_counter; // Contador monótono
+typedef _Atomic int64_t metric_gauge;    // Valor instantáneo
+
+// Histograma de tiempos con cubetas de potencias de 2 en microsegundos
+typedef struct {
+    metric_counter buckets[METRIC_BUCKETS + 1]; // Observaciones por cubeta (la última es +Inf)
+    metric_counter count;                       // Observaciones totales
+    metric_counter sum_ns;                      // Suma de las observaciones en nanosegundos
+} metric_hist;
+
+// Métricas de escritura de un archivo de salida (las actualiza el escritor por lotes)
+typedef struct {
+    metric_counter writes;   // Lotes escritos
+    metric_counter bytes;    // Bytes escritos
+    metric_hist write_time;  // Duración de cada write() (y fdatasync) de un lote
+    metric_hist latency;     // Latencia desde el envío en el sensor hasta la escritura
+} writer_metrics;
+
+// Suma n a un contador (un solo escritor).
+static inline void metric_add(metric_counter *c, uint64_t n) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// Lee un contador.
+static inline uint64_t metric_read(metric_counter *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+// Fija el valor de un indicador.
+static inline void metric_set(metric_gauge *g, int64_t value) {
+    atomic_store_explicit(g, value, memory_order_relaxed);
+}
+
+// Lee un indicador.
+static inline int64_t metric_get(metric_gauge *g) {
+    return atomic_load_explicit(g, memory_order_relaxed);
+}
+
+// Prototipos de funciones
+void metric_observe(metric_hist *h, uint64_t ns);        // Registra una duración en nanosegundos
+void metrics_write(FILE *out);                           // Escribe todas las métricas en formato de texto de Prometheus
+int metrics_start(const char *socket_path, const char *file_path); // Inicia el hilo que las expone
+void metrics_stop(void);                                 // Detiene el hilo de exportación
+
+#endif // METRICS_H
@@ -6,22 +6,112 @@ Tema: Proyecto
 Archivo: Manejo de monitor.c
 **************************************************************/
 
+#include "bcast.h"
 #include "buffer.h"
+#include "calib.h"
+#include "channel.h"
+#include "detect.h"
+#include "hist.h"
+#include "ingest.h"
+#include "journal.h"
+#include "metrics.h"
+#include "segment.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "writer.h"
 #include <fcntl.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+// Escribe el informe de rendimiento (una clave=valor por línea) en path.
+static void write_report(const char *path) {
+  FILE *report = fopen(path, "w");
+  if (report == NULL) {
+    perror("Error opening the report file");
+    return;
+  }
+
+  unsigned long long received = 0;
+  int64_t first_ns = 0, last_ns = 0;
+  histogram all;
+  hist_reset(&all);
+
+  // Una línea por canal (sumando sus partes) y el total combinado
+  for (int i = 0; i < channel_count; i++) {
+    channel *ch = &channels[i];
+    unsigned long long count = 0, accepted = 0, out_of_range = 0;
+    histogram latency;
+    hist_reset(&latency);
+    for (int k = 0; k < channel_shards; k++) {
+      channel_shard *shard = &ch->shards[k];
+      if (metric_read(&shard->received) == 0) {
+        continue;
+      }
+      count += metric_read(&shard->received);
+      accepted += metric_read(&shard->accepted);
+      out_of_range += metric_read(&shard->out_of_range);
+      hist_merge(&latency, &shard->latency);
+      if (first_ns == 0 || shard->first_ns < first_ns) {
+        first_ns = shard->first_ns;
+      }
+      if (metric_get(&shard->last_ns) > last_ns) {
+        last_ns = metric_get(&shard->last_ns);
+      }
+    }
+    if (count == 0) {
+      continue;
+    }
+    fprintf(report,
+            "channel=%s policy=%s received=%llu accepted=%llu out_of_range=%llu dropped=%llu "
+            "coalesced=%llu paused=%llu latency_samples=%llu "
+            "p50_us=%.1f p99_us=%.1f p999_us=%.1f max_us=%.1f\n",
+            ch->name, channel_policy_name(ch->policy), count, accepted, out_of_range,
+            (unsigned long long)metric_read(&ch->dropped),
+            (unsigned long long)metric_read(&ch->coalesced),
+            (unsigned long long)metric_read(&ch->push_blocked),
+            (unsigned long long)latency.total, hist_percentile(&latency, 50) / 1e3,
+            hist_percentile(&latency, 99) / 1e3, hist_percentile(&latency, 99.9) / 1e3,
+            latency.max / 1e3);
+
+    received += count;
+    hist_merge(&all, &latency);
+  }
+
+  double elapsed = (last_ns - first_ns) / 1e9;
+  fprintf(report, "shards=%d\n", channel_shards);
+  fprintf(report, "received=%llu\n", received);
+  fprintf(report, "malformed=%lu\n", ingest_incorrect());
+  fprintf(report, "elapsed_s=%.6f\n", elapsed);
+  fprintf(report, "samples_per_s=%.0f\n", elapsed > 0 ? received / elapsed : 0.0);
+  fprintf(report, "latency_p50_us=%.1f\n", hist_percentile(&all, 50) / 1e3);
+  fprintf(report, "latency_p99_us=%.1f\n", hist_percentile(&all, 99) / 1e3);
+  fprintf(report, "latency_p999_us=%.1f\n", hist_percentile(&all, 99.9) / 1e3);
+  fprintf(report, "latency_max_us=%.1f\n", all.max / 1e3);
+  fclose(report);
+}
+
 int main(int argc, char *argv[]) {
   int flags; // Almacena las flags de los argumentos de línea de comandos
-  char *pipe_name = NULL;   // Puntero al nombre del pipe nominal
+  char *pipe_names[MAX_SOURCES]; // Nombres de los pipes nominales (uno o varios -p)
+  int pipe_count = 0;             // Cantidad de pipes nominales
+  char *socket_name = NULL;       // Ruta del socket Unix para sensores
+  char *config_file = NULL; // Puntero al archivo de configuración de tipos de sensor
+  char *file_temp = NULL, *file_ph = NULL; // Archivos de temperatura y pH
+  char *report_file = NULL;       // Archivo del informe de rendimiento al terminar
+  char *metrics_socket = NULL;    // Socket Unix donde se consultan las métricas en vivo
+  char *metrics_path = NULL;      // Archivo de métricas en vivo que se reescribe cada segundo
+  char *snapshot_name = NULL;     // Segmento de memoria compartida con el último valor de cada sensor
+  char *snapshot_socket = NULL;   // Socket Unix de consulta del último valor de cada sensor
+  char *bcast_socket = NULL;      // Socket Unix donde se suscriben los consumidores de la difusión
+  char *kernel = "auto";          // Núcleo de calibración y validación por lotes
+  char *journal_dir = NULL;       // Directorio del diario de ingesta (recuperación después de un fallo)
 
-  while ((flags = getopt(argc, argv, "b:t:h:p:")) != -1) {
+  while ((flags = getopt(argc, argv, "b:t:h:p:c:u:d:i:k:f:g:w:e:rR:s:S:o:j:a:A:D:T:M:zL:Q:B:V:J:")) != -1) {
     switch (flags) {
       case 'b': // Bandera del tamaño del Buffer 
         BUFFER_SIZE = atoi(optarg);
@@ -32,77 +122,302 @@ int main(int argc, char *argv[]) {
       case 'h': // Bandera del archivo de pH 
         file_ph = optarg;
         break;
-      case 'p': // Bandera del nombre del Pipe
-        pipe_name = optarg;
+      case 'p': // Bandera del nombre del Pipe (puede repetirse, un pipe por sensor)
+        if (pipe_count < MAX_SOURCES) {
+          pipe_names[pipe_count++] = optarg;
+        }
+        break;
+      case 'u': // Bandera del socket Unix donde se conectan los sensores
+        socket_name = optarg;
+        break;
+      case 'd': // Bandera del modo de durabilidad de los archivos (none | fdatasync)
+        if (strcmp(optarg, "fdatasync") == 0) {
+          writer_settings.durability = WRITER_SYNC_DATA;
+        } else if (strcmp(optarg, "none") == 0) {
+          writer_settings.durability = WRITER_SYNC_NONE;
+        } else {
+          fprintf(stderr, "Error: Unknown durability mode '%s' (none | fdatasync).\n", optarg);
+          return 1;
+        }
+        break;
+      case 'i': // Bandera del tiempo máximo en milisegundos antes de escribir un lote
+        writer_settings.flush_ms = atoi(optarg);
+        break;
+      case 'k': // Bandera del tamaño del lote de escritura en KiB
+        writer_settings.batch_bytes = (size_t)atoi(optarg) * 1024;
+        break;
+      case 'f': // Bandera del formato de los archivos de salida (text | binary)
+        if (strcmp(optarg, "binary") == 0) {
+          writer_settings.format = WRITER_FORMAT_BINARY;
+        } else if (strcmp(optarg, "text") == 0) {
+          writer_settings.format = WRITER_FORMAT_TEXT;
+        } else {
+          fprintf(stderr, "Error: Unknown output format '%s' (text | binary).\n", optarg);
+          return 1;
+        }
+        break;
+      case 'g': // Bandera de los segundos que un bloque binario permanece abierto
+        writer_settings.block_ms = atoi(optarg) * 1000;
+        break;
+      case 'w': // Bandera de lecturas de la ventana deslizante de mínimo y máximo
+        stats_settings.window = (size_t)atoi(optarg);
+        break;
+      case 'e': // Bandera del peso de la lectura nueva en la media exponencial
+        stats_settings.ewma_alpha = atof(optarg);
+        break;
+      case 'r': // Bandera para escribir los agregados de 1 s, 1 min y 1 h
+        stats_settings.rollups = 1;
+        break;
+      case 'R': // Bandera del archivo del informe de rendimiento
+        report_file = optarg;
+        break;
+      case 's': // Bandera del socket Unix de consulta de métricas (formato de Prometheus)
+        metrics_socket = optarg;
+        break;
+      case 'S': // Bandera del archivo de métricas en vivo (formato de Prometheus)
+        metrics_path = optarg;
+        break;
+      case 'o': // Bandera de la política con el buffer lleno (block | drop-oldest | drop-newest | coalesce)
+        channel_default_policy = channel_policy_parse(optarg);
+        if (channel_default_policy == -1) {
+          fprintf(stderr, "Error: Unknown overload policy '%s' "
+                          "(block | drop-oldest | drop-newest | coalesce).\n", optarg);
+          return 1;
+        }
+        break;
+      case 'j': // Bandera de consumidores (partes) por canal, repartidos por instancia de sensor
+        channel_shards = atoi(optarg);
+        if (channel_shards < 1 || channel_shards > MAX_SHARDS) {
+          fprintf(stderr, "Error: Invalid number of consumers per channel (1-%d).\n", MAX_SHARDS);
+          return 1;
+        }
+        break;
+      case 'a': // Bandera del archivo de alertas ("-" = salida estándar)
+        detect_settings.sink_path = optarg;
+        break;
+      case 'A': // Bandera de alertas por segundo de cada consumidor (0 = sin límite)
+        detect_settings.max_per_s = atof(optarg);
+        break;
+      case 'D': // Bandera de los detectores de todos los canales ("rate=..,z=..,cusum=..,stuck=..")
+        if (detect_parse(&channel_default_detect, optarg) == -1) {
+          fprintf(stderr, "Error: Invalid detector list '%s' (rate=, z=, cusum=, stuck=).\n", optarg);
+          return 1;
+        }
+        break;
+      case 'T': // Bandera de los segundos de cada partición de los archivos (p. ej. 3600 = una por hora)
+        segment_settings.rotate_ms = (int64_t)atol(optarg) * 1000;
+        break;
+      case 'M': // Bandera del tamaño en MiB que provoca la rotación de un archivo
+        segment_settings.rotate_bytes = (uint64_t)atol(optarg) * 1024 * 1024;
+        break;
+      case 'z': // Bandera para comprimir en segundo plano los segmentos cerrados
+        segment_settings.compress = 1;
+        break;
+      case 'L': // Bandera del segmento de memoria compartida con el último valor de cada sensor
+        snapshot_name = optarg;
+        break;
+      case 'Q': // Bandera del socket Unix de consulta del último valor de cada sensor
+        snapshot_socket = optarg;
+        break;
+      case 'B': // Bandera del socket Unix de suscripción a la difusión de las lecturas
+        bcast_socket = optarg;
+        break;
+      case 'V': // Bandera del núcleo de calibración y validación (auto | scalar | sse | avx2)
+        kernel = optarg;
+        break;
+      case 'J': // Bandera del directorio del diario de ingesta y los puntos de control
+        journal_dir = optarg;
+        break;
+      case 'c': // Bandera del archivo de configuración de tipos de sensor
+        config_file = optarg;
         break;
       default: // Mensaje de uso en caso de argumentos incorrectos
         fprintf(stderr,
-                "Usage: %s -b <buffer_size> -t <file-temp> -h <file-ph> -p "
-                "<pipe-name>\n",
+                "Usage: %s -b <buffer_size> [-c <sensor-config>] [-t <file-temp>] "
+                "[-h <file-ph>] -p <pipe-name> [-p <pipe-name> ...] [-u <socket>] "
+                "[-d none|fdatasync] [-i <flush-ms>] [-k <batch-KiB>] "
+                "[-f text|binary] [-g <block-seconds>] [-w <window>] [-e <ewma-alpha>] [-r] "
+                "[-R <report-file>] [-s <metrics-socket>] [-S <metrics-file>] "
+                "[-o block|drop-oldest|drop-newest|coalesce] [-j <consumers-per-channel>] "
+                "[-a <alert-file>] [-A <alerts-per-second>] [-D rate=..,z=..,cusum=..,stuck=..] "
+                "[-T <rotate-seconds>] [-M <rotate-MiB>] [-z] [-L <snapshot-shm>] [-Q <snapshot-socket>] "
+                "[-B <broadcast-socket>] [-V auto|scalar|sse|avx2] [-J <journal-dir>]\n",
                 argv[0]);
         return 1;
     }
   }
 
-  // Verificar la validez de los nombres de archivo
-  if (!file_temp || !file_ph) {
+  // Cargar la tabla de tipos de sensor desde el archivo de configuración
+  if (config_file && channels_load(config_file) == -1) {
+    exit(1);
+  }
+
+  // Los archivos -t y -h definen (o reemplazan) los tipos de temperatura y pH
+  if (file_temp && channel_add(1, "Temperature", 20.0, 31.6, file_temp) == -1) {
+    exit(1);
+  }
+  if (file_ph && channel_add(2, "pH", 6, 8, file_ph) == -1) {
+    exit(1);
+  }
+
+  // Verificar que exista al menos un tipo de sensor configurado
+  if (channel_count == 0) {
     fprintf(stderr, "Error opening file.\n");
     exit(1);
   }
 
-  // Crear el pipe si no existe
-  if (access(pipe_name, F_OK) == -1) {
-    printf("Pipe created: '%s'\n", pipe_name);
+  // Verificar los parámetros del escritor por lotes
+  if (writer_settings.batch_bytes < 1024 || writer_settings.flush_ms < 0 || writer_settings.block_ms < 0) {
+    fprintf(stderr, "Error: Invalid batch size or flush interval.\n");
+    exit(1);
+  }
+
+  // Verificar los parámetros de las estadísticas móviles
+  if (stats_settings.window == 0 || stats_settings.ewma_alpha <= 0 || stats_settings.ewma_alpha > 1) {
+    fprintf(stderr, "Error: Invalid statistics window or EWMA alpha.\n");
+    exit(1);
+  }
+
+  // Verificar el límite de frecuencia de las alertas
+  if (detect_settings.max_per_s < 0) {
+    fprintf(stderr, "Error: Invalid alert rate limit.\n");
+    exit(1);
+  }
+
+  // Verificar la rotación: la compresión sólo se aplica a segmentos cerrados
+  if (segment_settings.rotate_ms < 0 || (segment_settings.compress && segment_settings.rotate_ms == 0 &&
+                                          segment_settings.rotate_bytes == 0)) {
+    fprintf(stderr, "Error: Compression needs rotation (-T or -M).\n");
+    exit(1);
+  }
+
+  // Elegir el núcleo de calibración y validación por lotes según la CPU
+  if (calib_select(kernel) == -1) {
+    fprintf(stderr, "Error: Batch kernel '%s' unknown or not supported by this CPU (auto | scalar | sse | avx2).\n",
+            kernel);
+    exit(1);
+  }
+
+  // Verificar que exista al menos una fuente de datos
+  if (pipe_count == 0 && !socket_name) {
+    fprintf(stderr, "Error: No pipe or socket given.\n");
+    exit(1);
+  }
+
+  // Registrar los pipes y el socket en el recolector
+  if (ingest_init() == -1) {
+    exit(1);
+  }
+  for (int i = 0; i < pipe_count; i++) {
+    if (ingest_add_fifo(pipe_names[i]) == -1) {
+      exit(1);
+    }
+  }
+  if (socket_name && ingest_add_listener(socket_name) == -1) {
+    exit(1);
+  }
+
+  // Bloquear SIGINT, SIGTERM y SIGUSR1 en todos los hilos; el hilo principal los atiende con sigwait
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  sigaddset(&stop_signals, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
 
-    if (mkfifo(pipe_name, 0666) == -1) {
-      perror("Error creating the pipe");
+  // Iniciar el hilo que comprime los segmentos cerrados
+  if (segment_start() == -1) {
+    exit(1);
+  }
+
+  // Tabla del último valor de cada sensor, publicada en memoria compartida y/o por socket
+  if (snapshot_name || snapshot_socket) {
+    if (snapshot_create(snapshot_name) == -1) {
+      exit(1);
+    }
+    for (int i = 0; i < channel_count; i++) {
+      snapshot_set_name(channels[i].id, channels[i].name);
+    }
+    if (snapshot_socket && snapshot_serve_start(snapshot_socket) == -1) {
       exit(1);
     }
-  } else {
-    printf("Pipe already exists. Should not be created.\n");
-  }
-
-  // Inicializar semáforos para la sincronización de acceso a los buffers
-  printf("Initializing semaphores...\n");
-  // Inicializar semáforo de espacios vacíos en el buffer de temperatura con el tamaño del buffer
-  sem_init(&empty_temp, 0, BUFFER_SIZE);
-  // Inicializar semáforo de espacios llenos en el buffer de temperatura como 0 (inicialmente vacío)
-  sem_init(&full_temp, 0, 0);
-  // Inicializar semáforo de espacios vacíos en el buffer de pH con el tamaño del buffer
-  sem_init(&empty_ph, 0, BUFFER_SIZE);
-  // Inicializar semáforo de espacios llenos en el buffer de pH como 0 (inicialmente vacío)
-  sem_init(&full_ph, 0, 0);
-  // Inicializar mutex para el buffer de temperatura
-  pthread_mutex_init(&mutex_temp, NULL);
-  // Inicializar mutex para el buffer de pH
-  pthread_mutex_init(&mutex_ph, NULL);
-
-  
+  }
+
+  // Difusión de las lecturas a los suscriptores locales
+  if (bcast_socket && bcast_start(bcast_socket) == -1) {
+    exit(1);
+  }
+
   // Inicializar buffers
   ini_buffers();
-  printf("Buffers initialized: 2\n");
+  if (ingest_attach_channels() == -1) {
+    exit(1);
+  }
+  printf("Buffers initialized: %d (batch kernel: %s)\n", channel_count * channel_shards, calib_name());
+
+  // Diario de ingesta: después de un fallo cada salida vuelve a su punto de control
+  if (journal_dir && journal_open(journal_dir) == -1) {
+    exit(1);
+  }
   printf("──────────────────────────────────────────\n");
 
-  // Crear hilo para recolectar datos, hilo para recolectar datos de pH e hilo para recolectar datos de temperatura
-  pthread_t recolector_thread, ph_thread, temperatura_thread;
+  // Crear hilo para recolectar datos
+  pthread_t recolector_thread;
 
   // Crear hilos para ejecutar las funciones correspondientes
-  pthread_create(&recolector_thread, NULL, recolector, pipe_name); // Hilo para recolectar datos del pipe
-  pthread_create(&ph_thread, NULL, ph_thread_collec, NULL); // Hilo para recolectar datos de pH
-  pthread_create(&temperatura_thread, NULL, temper_thread_collec, NULL); // Hilo para recolectar datos de temperatura
+  for (int i = 0; i < channel_count; i++) {
+    for (int k = 0; k < channel_shards; k++) {
+      channel_shard *shard = &channels[i].shards[k];
+      pthread_create(&shard->thread, NULL, channel_thread, shard); // Hilo consumidor de cada parte de cada canal
+    }
+  }
+
+  // Reinyectar las lecturas del diario que las salidas no alcanzaron a escribir, antes de leer sensores
+  if (journal_dir) {
+    journal_replay();
+  }
+  pthread_create(&recolector_thread, NULL, recolector, NULL); // Hilo para recolectar datos de todos los sensores
+
+  // Exportar las métricas en vivo por socket y/o archivo
+  if (metrics_start(metrics_socket, metrics_path) == -1) {
+    exit(1);
+  }
+
+  // Esperar una señal de terminación y detener el recolector; SIGUSR1 sólo vuelca las métricas
+  int signal_number;
+  while (sigwait(&stop_signals, &signal_number) == 0 && signal_number == SIGUSR1) {
+    metrics_write(stdout);
+    fflush(stdout);
+  }
+  printf("Signal %d received, stopping monitor...\n", signal_number);
+  ingest_stop();
 
   // Esperar a que los hilos terminen su ejecución antes de continuar
   pthread_join(recolector_thread, NULL); // Esperar a que termine el hilo de recolección
-  pthread_join(ph_thread, NULL); // Esperar a que termine el hilo de recolección de datos de pH
-  pthread_join(temperatura_thread, NULL); // Esperar a que termine el hilo de recolección de datos de temperatura
-
-  // Destruir semáforos y mutex para liberar los recursos
-  sem_destroy(&empty_temp); // Liberar semáforo de espacio vacío en buffer de temperatura
-  sem_destroy(&full_temp); // Liberar semáforo de espacio lleno en buffer de temperatura
-  sem_destroy(&empty_ph); // Liberar semáforo de espacio vacío en buffer de pH
-  sem_destroy(&full_ph); // Liberar semáforo de espacio lleno en buffer de pH
-  pthread_mutex_destroy(&mutex_temp); // Liberar mutex para acceso al buffer de temperatura
-  pthread_mutex_destroy(&mutex_ph); // Liberar mutex para acceso al buffer de pH
+  bcast_stop();                          // Los suscriptores leen lo que quede y terminan
+  for (int i = 0; i < channel_count; i++) {
+    for (int k = 0; k < channel_shards; k++) {
+      pthread_join(channels[i].shards[k].thread, NULL); // Esperar a que termine cada consumidor
+    }
+  }
+
+  // Borrar el diario: todas sus lecturas ya están en las salidas
+  journal_close();
+
+  // Comprimir los segmentos que cerraron los consumidores al terminar
+  segment_stop();
+
+  // Última foto de las métricas con los totales finales
+  metrics_stop();
+
+  // Cerrar las consultas del último valor y borrar su segmento
+  snapshot_serve_stop();
+  snapshot_destroy();
+
+  // Informe de rendimiento de la ejecución
+  if (report_file) {
+    write_report(report_file);
+  }
 
   // Liberar memoria asignada para los buffers
   free_memory_from_buffers();
@@ -0,0 +1,205 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del protocolo de registros entre sensor y monitor
+**************************************************************/
+
+#include "protocol.h"
+#include "logfmt.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+// Inicializa el lector de registros sin datos pendientes.
+void frame_reader_init(frame_reader *reader) {
+    reader->start = 0;
+    reader->len = 0;
+    reader->skipping = 0;
+    reader->oversized = 0;
+}
+
+// Realiza una lectura del descriptor y agrega los bytes al final del buffer.
+// Devuelve lo mismo que read(): bytes leídos, 0 en EOF o -1 en error.
+ssize_t frame_reader_fill(frame_reader *reader, int fd) {
+    // Mover el registro parcial al inicio para dejar espacio libre al final.
+    if (reader->start > 0) {
+        memmove(reader->data, reader->data + reader->start, reader->len - reader->start);
+        reader->len -= reader->start;
+        reader->start = 0;
+    }
+
+    // Si el buffer está lleno sin ningún '\n' el registro es inválido y se descarta.
+    if (reader->len == sizeof(reader->data)) {
+        reader->len = 0;
+        reader->skipping = 1;
+        reader->oversized++;
+    }
+
+    ssize_t n;
+    do {
+        n = read(fd, reader->data + reader->len, sizeof(reader->data) - reader->len);
+    } while (n == -1 && errno == EINTR);
+
+    if (n > 0) {
+        reader->len += (size_t)n;
+    }
+    return n;
+}
+
+// Devuelve el siguiente registro completo terminado en NUL (sin el '\n'),
+// o NULL si sólo queda un registro parcial que se completará en la próxima lectura.
+char *frame_reader_next(frame_reader *reader) {
+    while (reader->start < reader->len) {
+        char *begin = reader->data + reader->start;
+        char *newline = memchr(begin, '\n', reader->len - reader->start);
+        if (newline == NULL) {
+            return NULL;
+        }
+
+        size_t length = (size_t)(newline - begin);
+        *newline = '\0';
+        reader->start += length + 1;
+
+        // Terminar de descartar el resto de un registro demasiado largo.
+        if (reader->skipping) {
+            reader->skipping = 0;
+            continue;
+        }
+        if (length + 1 > PROTO_MAX_RECORD) {
+            reader->oversized++;
+            continue;
+        }
+        return begin;
+    }
+    return NULL;
+}
+
+// Serializa una lectura en el formato del protocolo. Devuelve la longitud escrita.
+int proto_format(char *out, size_t size, int sensor_type, float value) {
+    return snprintf(out, size, "%d:%.2f\n", sensor_type, value);
+}
+
+// Serializa una lectura incluyendo el instante de envío, la instancia del
+// sensor y, si no es 0, el emisor. Devuelve la longitud escrita.
+int proto_format_timed(char *out, size_t size, int sensor_type, float value, int64_t sent_ns,
+                       uint32_t instance, uint32_t sender) {
+    if (sender == 0) {
+        return snprintf(out, size, "%d:%.2f:%lld:%u\n", sensor_type, value, (long long)sent_ns, instance);
+    }
+    return snprintf(out, size, "%d:%.2f:%lld:%u:%u\n", sensor_type, value, (long long)sent_ns, instance, sender);
+}
+
+// Reloj monotónico en nanosegundos. Es común a todos los procesos del equipo,
+// por eso sirve para medir la latencia entre el sensor y el monitor.
+int64_t proto_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Lee un entero decimal con signo opcional de hasta 18 dígitos (no hay
+// desborde posible). Devuelve dónde termina o NULL si no hay dígitos.
+static const char *parse_integer(const char *p, long long *value) {
+    int negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    const char *digits = p;
+    long long result = 0;
+    for (; (unsigned)(*p - '0') < 10; p++) {
+        if (p - digits == 18) {
+            return NULL;
+        }
+        result = result * 10 + (*p - '0');
+    }
+    if (p == digits) {
+        return NULL;
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+// Decodifica un registro "<tipo>:<valor>[:<enviado_ns>[:<instancia>[:<emisor>]]]". Devuelve 0 si es válido o -1 si no.
+// Los números se leen con un recorrido de los dígitos (sin strtol ni strtof,
+// que consultan el locale); el valor usa el mismo lector que los archivos de texto.
+int proto_parse(const char *line, proto_record *rec) {
+    long long type;
+    const char *end = parse_integer(line, &type);
+    if (end == NULL || *end != ':' || type < INT32_MIN || type > INT32_MAX) {
+        return -1;
+    }
+
+    float data;
+    end = log_parse_float(end + 1, end + 1 + strlen(end + 1), &data);
+    if (end == NULL) {
+        return -1;
+    }
+
+    long long sent = 0;
+    long long instance = -1;
+    long long sender = 0;
+    if (*end == ':') {
+        end = parse_integer(end + 1, &sent);
+        if (end == NULL) {
+            return -1;
+        }
+        if (*end == ':') {
+            end = parse_integer(end + 1, &instance);
+            if (end == NULL || instance < 0 || instance > UINT32_MAX) {
+                return -1;
+            }
+            if (*end == ':') {
+                end = parse_integer(end + 1, &sender);
+                if (end == NULL || sender < 0 || sender > UINT32_MAX) {
+                    return -1;
+                }
+            }
+        }
+    }
+    if (*end != '\0' && *end != '\r') {
+        return -1;
+    }
+
+    rec->sensor_type = (int)type;
+    rec->value = data;
+    rec->sent_ns = sent;
+    rec->instance = instance;
+    rec->sender = (uint32_t)sender;
+    return 0;
+}
+
+// Abre el canal de escritura hacia el monitor. Si la ruta es un socket Unix
+// se conecta a él; en otro caso la abre como pipe nominal. Devuelve el descriptor o -1.
+int proto_connect(const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        struct sockaddr_un addr = { .sun_family = AF_UNIX };
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(addr.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            return -1;
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+            int saved = errno;
+            close(fd);
+            errno = saved;
+            return -1;
+        }
+        return fd;
+    }
+    return open(path, O_WRONLY);
+}
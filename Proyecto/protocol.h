@@ -0,0 +1,62 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del protocolo de registros entre sensor y monitor
+**************************************************************/
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Cada lectura viaja como un registro de texto terminado en '\n':
+//   "<tipo>:<valor>\n"   por ejemplo "1:27.00\n"
+// Opcionalmente el sensor agrega el instante de envío (CLOCK_MONOTONIC en ns)
+// para medir la latencia de extremo a extremo:
+//   "<tipo>:<valor>:<enviado_ns>\n"
+// y el identificador de su instancia, para que el monitor reparta los sensores
+// entre los consumidores de un canal sin mezclar el orden de cada uno:
+//   "<tipo>:<valor>:<enviado_ns>:<instancia>\n"
+// Los sensores que reenvían sus lecturas al reconectarse (-b) agregan además
+// su PID como emisor; con él el monitor con diario reconoce las repetidas:
+//   "<tipo>:<valor>:<enviado_ns>:<instancia>:<emisor>\n"
+// El kernel puede juntar varios registros en un solo read() o partir uno
+// entre dos lecturas, por eso el lector reensambla los registros parciales.
+
+#define PROTO_MAX_RECORD 128    // Longitud máxima de un registro (incluye '\n')
+#define PROTO_READER_SIZE 65536 // Capacidad del buffer de reensamblado
+
+// Lectura ya decodificada de un registro
+typedef struct {
+    int sensor_type; // Tipo de sensor (1 = temperatura, 2 = pH)
+    float value;     // Valor medido
+    int64_t sent_ns; // Instante de envío en el sensor (0 si el registro no lo trae)
+    int64_t instance; // Identificador de la instancia del sensor (-1 si el registro no lo trae)
+    uint32_t sender;  // Proceso que envió el registro (0 si no lo trae)
+} proto_record;
+
+// Buffer de reensamblado asociado a un descriptor de lectura
+typedef struct {
+    char data[PROTO_READER_SIZE]; // Bytes recibidos aún no consumidos
+    size_t start;                 // Inicio del siguiente registro sin consumir
+    size_t len;                   // Fin de los bytes válidos en data
+    int skipping;                 // 1 si se está descartando un registro demasiado largo
+    unsigned long oversized;      // Registros descartados por exceder el tamaño máximo
+} frame_reader;
+
+// Prototipos de funciones
+void frame_reader_init(frame_reader *reader);         // Inicializa el lector vacío
+ssize_t frame_reader_fill(frame_reader *reader, int fd); // Hace un read() y agrega los bytes leídos
+char *frame_reader_next(frame_reader *reader);        // Devuelve el siguiente registro completo o NULL
+int proto_format(char *out, size_t size, int sensor_type, float value); // Serializa un registro
+int proto_format_timed(char *out, size_t size, int sensor_type, float value, int64_t sent_ns,
+                       uint32_t instance, uint32_t sender); // Con instante de envío, instancia y emisor (0 = sin él)
+int64_t proto_now_ns(void);           // Reloj monotónico compartido por sensor y monitor
+int proto_parse(const char *line, proto_record *rec); // Decodifica un registro sin '\n'
+int proto_connect(const char *path);  // Abre el pipe nominal o se conecta al socket Unix del monitor
+
+#endif // PROTOCOL_H
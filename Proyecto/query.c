@@ -0,0 +1,550 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Manejo de query.c (consultas por rango de tiempo sobre las salidas del monitor)
+**************************************************************/
+
+#include "codec.h"
+#include "logfmt.h"
+#include "logindex.h"
+#include "manifest.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_PERCENTILES 16 // Percentiles distintos que se pueden pedir con -p
+#define MAX_FILES 16384    // Archivos (o segmentos) que se pueden consultar a la vez
+
+// Acumulado de una consulta sobre uno o varios archivos
+typedef struct {
+    int64_t start_ms, end_ms; // Rango de tiempo pedido (incluido)
+    uint64_t count;           // Lecturas dentro del rango
+    double sum;               // Suma de los valores dentro del rango
+    float min, max;           // Extremos dentro del rango
+    int keep_values;          // 1 si hay que guardar los valores para calcular percentiles
+    float *values;            // Valores dentro del rango (sólo con percentiles)
+    size_t values_cap;        // Capacidad de values
+    uint64_t skipped, summarized, scanned; // Entradas del índice según cómo se resolvieron
+} query_result;
+
+// Agrega un valor al acumulado.
+static void add_value(query_result *q, float value) {
+    if (q->count == 0 || value < q->min) {
+        q->min = value;
+    }
+    if (q->count == 0 || value > q->max) {
+        q->max = value;
+    }
+    q->sum += value;
+    q->count++;
+
+    if (q->keep_values) {
+        if (q->count > q->values_cap) {
+            q->values_cap = q->values_cap ? q->values_cap * 2 : 4096;
+            q->values = realloc(q->values, q->values_cap * sizeof(float));
+            if (!q->values) {
+                perror("Error allocating memory for the percentile values");
+                exit(1);
+            }
+        }
+        q->values[q->count - 1] = value;
+    }
+}
+
+// Agrega el resumen de un grupo de lecturas que cae completo dentro del rango.
+static void add_summary(query_result *q, uint64_t count, float min, float max, double sum) {
+    if (q->count == 0 || min < q->min) {
+        q->min = min;
+    }
+    if (q->count == 0 || max > q->max) {
+        q->max = max;
+    }
+    q->sum += sum;
+    q->count += count;
+    q->summarized++;
+}
+
+// Visita de log_scan: agrega la lectura si está dentro del rango.
+static void visit_reading(int64_t ms, float value, void *ctx) {
+    query_result *q = ctx;
+    if (ms >= q->start_ms && ms <= q->end_ms) {
+        add_value(q, value);
+    }
+}
+
+// Columnas de un bloque comprimido (query atiende un archivo a la vez)
+static int64_t block_ms[LOG_BLOCK_MAX];
+static float block_values[LOG_BLOCK_MAX];
+
+// Agrega las lecturas de un segmento comprimido. Las cabeceras de sus bloques
+// hacen de índice: sólo se descomprimen los bloques que cortan el rango.
+static void query_compressed(const char *path, const log_map *map, query_result *q) {
+    size_t offset = 0;
+    const codec_block_header *b;
+    while ((b = codec_next_block(map, &offset)) != NULL) {
+        if (b->last_ms < q->start_ms || b->first_ms > q->end_ms) {
+            q->skipped++;
+            continue;
+        }
+        if (!q->keep_values && b->first_ms >= q->start_ms && b->last_ms <= q->end_ms) {
+            add_summary(q, b->count, b->min, b->max, b->sum);
+            continue;
+        }
+
+        if (codec_decode(b, block_ms, block_values) == -1) {
+            fprintf(stderr, "Warning: %s has a damaged block\n", path);
+            break;
+        }
+        for (uint32_t i = 0; i < b->count; i++) {
+            visit_reading(block_ms[i], block_values[i], q);
+        }
+        q->scanned++;
+    }
+}
+
+// Agrega al acumulado todas las lecturas de un archivo que caen en el rango.
+static int query_file(const char *path, uint32_t per_entry, query_result *q) {
+    log_map map;
+    if (log_map_open(path, &map) == -1) {
+        perror(path);
+        return -1;
+    }
+    if (codec_is_compressed(&map)) {
+        query_compressed(path, &map, q);
+        log_map_close(&map);
+        return 0;
+    }
+
+    log_index index;
+    if (log_index_update(path, &map, per_entry, &index) == -1) {
+        fprintf(stderr, "Error indexing %s\n", path);
+        log_map_close(&map);
+        return -1;
+    }
+    int binary = (int)index.header.binary;
+
+    for (uint64_t i = 0; i < index.header.entries; i++) {
+        const log_index_entry *e = &index.entries[i];
+
+        // Grupo fuera del rango: no se lee.
+        if (e->last_ms < q->start_ms || e->first_ms > q->end_ms) {
+            q->skipped++;
+            continue;
+        }
+
+        // Grupo completamente dentro del rango: basta su resumen (salvo que haya percentiles).
+        if (!q->keep_values && e->first_ms >= q->start_ms && e->last_ms <= q->end_ms) {
+            add_summary(q, e->count, e->min, e->max, e->sum);
+            continue;
+        }
+
+        // Grupo parcialmente dentro del rango: se recorren sus lecturas.
+        log_scan(&map, binary, e->offset, e->offset + e->length, visit_reading, q);
+        q->scanned++;
+    }
+
+    // Lecturas escritas después del último grupo completo del índice.
+    log_scan(&map, binary, index.header.indexed_bytes, map.size, visit_reading, q);
+
+    log_index_free(&index);
+    log_map_close(&map);
+    return 0;
+}
+
+// Cursor que recorre en orden las lecturas de un archivo para la vista combinada
+typedef struct {
+    log_map map;                   // Archivo proyectado
+    int binary;                    // 1 si está en formato binario
+    int compressed;                // 1 si es un segmento comprimido
+    int64_t *ms_column;            // Marcas de tiempo del bloque comprimido en curso
+    float *value_column;           // Valores del bloque comprimido en curso
+    uint32_t block_count;          // Lecturas del bloque comprimido en curso
+    size_t offset;                 // Próximo bloque o línea por leer
+    const log_block_header *block; // Bloque binario en curso (NULL si no hay)
+    uint32_t next;                 // Próxima lectura del bloque en curso
+    int64_t block_ms;              // Marca de tiempo acumulada dentro del bloque
+    int64_t ms;                    // Marca de tiempo de la lectura actual
+    float value;                   // Valor de la lectura actual
+    int valid;                     // 1 si hay una lectura actual
+} segment_cursor;
+
+// Avanza el cursor a la siguiente lectura completa del archivo.
+static void cursor_advance(segment_cursor *c) {
+    c->valid = 0;
+    if (c->compressed) {
+        while (c->next == c->block_count) {
+            const codec_block_header *h = codec_next_block(&c->map, &c->offset);
+            if (h == NULL || codec_decode(h, c->ms_column, c->value_column) == -1) {
+                return;
+            }
+            c->block_count = h->count;
+            c->next = 0;
+        }
+        c->ms = c->ms_column[c->next];
+        c->value = c->value_column[c->next];
+        c->next++;
+        c->valid = 1;
+        return;
+    }
+    if (c->binary) {
+        while (c->block == NULL || c->next == c->block->count) {
+            c->block = log_next_block(&c->map, &c->offset);
+            if (c->block == NULL) {
+                return;
+            }
+            c->next = 0;
+            c->block_ms = c->block->first_ms;
+        }
+        c->block_ms += log_block_deltas(c->block)[c->next];
+        c->ms = c->block_ms;
+        c->value = log_block_values(c->block)[c->next];
+        c->next++;
+        c->valid = 1;
+        return;
+    }
+
+    const char *data = (const char *)c->map.data;
+    while (c->offset < c->map.size) {
+        const char *line = data + c->offset;
+        const char *newline = memchr(line, '\n', c->map.size - c->offset);
+        if (newline == NULL) {
+            return; // Última línea incompleta: el monitor todavía la está escribiendo
+        }
+        c->offset = (size_t)(newline - data) + 1;
+        if (log_parse_line(line, newline, &c->ms, &c->value) == 0) {
+            c->valid = 1;
+            return;
+        }
+    }
+}
+
+// Abre un cursor en la primera lectura con marca de tiempo >= start_ms. El
+// índice permite empezar directamente en el primer grupo que puede contenerla.
+static int cursor_open(segment_cursor *c, const char *path, uint32_t per_entry, int64_t start_ms) {
+    memset(c, 0, sizeof(*c));
+    if (log_map_open(path, &c->map) == -1) {
+        perror(path);
+        return -1;
+    }
+
+    // Segmento comprimido: las cabeceras de los bloques indican dónde empezar.
+    if (codec_is_compressed(&c->map)) {
+        c->compressed = 1;
+        c->ms_column = malloc(LOG_BLOCK_MAX * sizeof(int64_t));
+        c->value_column = malloc(LOG_BLOCK_MAX * sizeof(float));
+        if (!c->ms_column || !c->value_column) {
+            perror("Error allocating memory for a compressed segment");
+            return -1;
+        }
+        size_t offset = 0;
+        const codec_block_header *h;
+        while ((h = codec_next_block(&c->map, &offset)) != NULL && h->last_ms < start_ms) {
+            c->offset = offset;
+        }
+        do {
+            cursor_advance(c);
+        } while (c->valid && c->ms < start_ms);
+        return 0;
+    }
+
+    log_index index;
+    if (log_index_update(path, &c->map, per_entry, &index) == -1) {
+        fprintf(stderr, "Error indexing %s\n", path);
+        log_map_close(&c->map);
+        return -1;
+    }
+    c->binary = (int)index.header.binary;
+    c->offset = index.header.indexed_bytes;
+    for (uint64_t i = 0; i < index.header.entries; i++) {
+        if (index.entries[i].last_ms >= start_ms) {
+            c->offset = index.entries[i].offset;
+            break;
+        }
+    }
+    log_index_free(&index);
+
+    do {
+        cursor_advance(c);
+    } while (c->valid && c->ms < start_ms);
+    return 0;
+}
+
+// Vista combinada: imprime en orden de tiempo las lecturas de todos los
+// archivos dentro del rango. Cada archivo (por ejemplo cada segmento de un
+// canal repartido entre consumidores) ya está ordenado, así que basta mezclar
+// sus cursores tomando siempre la lectura más antigua.
+static int merge_files(char *paths[], int count, uint32_t per_entry, int64_t start_ms, int64_t end_ms) {
+    segment_cursor *cursors = calloc((size_t)count, sizeof(segment_cursor));
+    if (!cursors) {
+        perror("Error allocating memory for the merge cursors");
+        return -1;
+    }
+    int opened;
+    for (opened = 0; opened < count; opened++) {
+        if (cursor_open(&cursors[opened], paths[opened], per_entry, start_ms) == -1) {
+            break;
+        }
+    }
+
+    char stamp[32];
+    while (opened == count) {
+        segment_cursor *oldest = NULL;
+        for (int i = 0; i < count; i++) {
+            segment_cursor *c = &cursors[i];
+            if (c->valid && c->ms <= end_ms && (oldest == NULL || c->ms < oldest->ms)) {
+                oldest = c;
+            }
+        }
+        if (oldest == NULL) {
+            break;
+        }
+        log_format_time(oldest->ms, stamp, sizeof(stamp));
+        printf("{%s} %f\n", stamp, oldest->value);
+        cursor_advance(oldest);
+    }
+
+    for (int i = 0; i < count; i++) {
+        log_map_close(&cursors[i].map);
+        free(cursors[i].ms_column);
+        free(cursors[i].value_column);
+    }
+    free(cursors);
+    return opened == count ? 0 : -1;
+}
+
+// Agrega un archivo a la lista.
+static int add_file(const char *path, char *paths[], int *count) {
+    if (*count == MAX_FILES) {
+        fprintf(stderr, "Error: Too many files (max %d)\n", MAX_FILES);
+        return -1;
+    }
+    paths[(*count)++] = strdup(path);
+    return 0;
+}
+
+// Agrega los segmentos de un manifiesto cuyo rango de tiempo corta el pedido;
+// los demás ni siquiera se abren. El segmento abierto se agrega siempre.
+static int add_manifest(const char *path, char *paths[], int *count, int64_t start_ms, int64_t end_ms) {
+    manifest m;
+    if (manifest_load(path, &m) == -1) {
+        perror(path);
+        return -1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < m.count && result == 0; i++) {
+        manifest_entry *e = &m.entries[i];
+        int open = strcmp(e->state, "open") == 0;
+        if ((!open && e->count == 0) || e->first_ms > end_ms || (!open && e->last_ms < start_ms)) {
+            continue;
+        }
+
+        // Un segmento cerrado puede comprimirse mientras se consulta: se busca también su ".z".
+        char file[4096];
+        if (manifest_file(path, e, file, sizeof(file)) == -1) {
+            continue;
+        }
+        if (access(file, F_OK) == -1 && strcmp(e->state, "closed") == 0) {
+            snprintf(e->state, sizeof(e->state), "compressed");
+            manifest_file(path, e, file, sizeof(file));
+        }
+        if (access(file, F_OK) == 0) {
+            result = add_file(file, paths, count);
+        }
+    }
+    manifest_free(&m);
+    return result;
+}
+
+// Agrega un archivo a la lista. Si no existe pero existe "<archivo>.manifest"
+// (monitor con rotación) se agregan sus segmentos, y si existen las partes
+// "<archivo>.0", "<archivo>.1"... (monitor con -j) se agregan todas ellas.
+static int add_path(const char *path, char *paths[], int *count, int64_t start_ms, int64_t end_ms) {
+    size_t len = strlen(path);
+    if (len > 9 && strcmp(path + len - 9, ".manifest") == 0) {
+        return add_manifest(path, paths, count, start_ms, end_ms);
+    }
+    if (access(path, F_OK) == 0) {
+        return add_file(path, paths, count);
+    }
+
+    char manifest_path[4096 + 16];
+    snprintf(manifest_path, sizeof(manifest_path), "%s.manifest", path);
+    if (access(manifest_path, F_OK) == 0) {
+        return add_manifest(manifest_path, paths, count, start_ms, end_ms);
+    }
+
+    int found = 0;
+    for (int k = 0;; k++) {
+        char segment[4096];
+        snprintf(segment, sizeof(segment), "%s.%d", path, k);
+        snprintf(manifest_path, sizeof(manifest_path), "%s.manifest", segment);
+        if (access(segment, F_OK) == -1 && access(manifest_path, F_OK) == -1) {
+            break;
+        }
+        if (add_path(segment, paths, count, start_ms, end_ms) == -1) {
+            return -1;
+        }
+        found++;
+    }
+    if (found == 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// Intercambia dos valores.
+static void swap_values(float *a, float *b) {
+    float t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Devuelve el k-ésimo menor valor (selección rápida, reordena el arreglo).
+static float select_kth(float *v, size_t n, size_t k) {
+    size_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        float pivot = v[lo + (hi - lo) / 2];
+        size_t i = lo, j = hi;
+        while (i <= j) {
+            while (v[i] < pivot) {
+                i++;
+            }
+            while (v[j] > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                swap_values(&v[i], &v[j]);
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+    return v[k];
+}
+
+int main(int argc, char *argv[]) {
+  int flags; // Almacena las flags de los argumentos de línea de comandos
+  query_result q;
+  memset(&q, 0, sizeof(q));
+  q.start_ms = INT64_MIN;
+  q.end_ms = INT64_MAX;
+  uint32_t per_entry = LOG_INDEX_PER_ENTRY; // Líneas de texto por entrada del índice
+  double percentiles[MAX_PERCENTILES];      // Percentiles pedidos
+  int percentile_count = 0;
+  int verbose = 0;                          // 1 para mostrar cómo se usó el índice
+  int list = 0;                             // 1 para listar las lecturas en orden de tiempo
+  char *paths[MAX_FILES];                   // Archivos a consultar (con los segmentos expandidos)
+  int path_count = 0;
+
+  while ((flags = getopt(argc, argv, "s:e:p:n:vl")) != -1) {
+    switch (flags) {
+    case 's': // Bandera del inicio del rango
+      if (log_parse_time(optarg, &q.start_ms) == -1) {
+        fprintf(stderr, "Error: Invalid start time '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case 'e': // Bandera del fin del rango
+      if (log_parse_time(optarg, &q.end_ms) == -1) {
+        fprintf(stderr, "Error: Invalid end time '%s'\n", optarg);
+        return 1;
+      }
+      break;
+    case 'p': // Bandera de un percentil (0-100), puede repetirse
+      if (percentile_count == MAX_PERCENTILES) {
+        fprintf(stderr, "Error: Too many percentiles (max %d)\n", MAX_PERCENTILES);
+        return 1;
+      }
+      percentiles[percentile_count] = atof(optarg);
+      if (percentiles[percentile_count] < 0 || percentiles[percentile_count] > 100) {
+        fprintf(stderr, "Error: Percentile must be between 0 and 100\n");
+        return 1;
+      }
+      percentile_count++;
+      break;
+    case 'n': // Bandera de líneas de texto por entrada del índice
+      per_entry = (uint32_t)atoi(optarg);
+      if (per_entry == 0) {
+        fprintf(stderr, "Error: Invalid index granularity\n");
+        return 1;
+      }
+      break;
+    case 'v': // Bandera para mostrar estadísticas del índice
+      verbose = 1;
+      break;
+    case 'l': // Bandera de la vista combinada en orden de tiempo
+      list = 1;
+      break;
+    default: // Mensaje de uso en caso de argumentos incorrectos
+      fprintf(stderr,
+              "Usage: %s [-s <start>] [-e <end>] [-p <percentile>]... [-n <lines-per-entry>] [-v] [-l] "
+              "<file>...\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    fprintf(stderr, "Usage: %s [-s <start>] [-e <end>] [-p <percentile>]... <file>...\n", argv[0]);
+    return 1;
+  }
+
+  // Un canal repartido entre varios consumidores o rotado en segmentos se consulta por su nombre base
+  for (int i = optind; i < argc; i++) {
+    if (add_path(argv[i], paths, &path_count, q.start_ms, q.end_ms) == -1) {
+      return 1;
+    }
+  }
+
+  // Vista combinada: las lecturas de todos los archivos en orden de tiempo
+  if (list) {
+    int result = merge_files(paths, path_count, per_entry, q.start_ms, q.end_ms);
+    for (int i = 0; i < path_count; i++) {
+      free(paths[i]);
+    }
+    return result == 0 ? 0 : 1;
+  }
+
+  // Consulta de cada archivo; los resultados se combinan
+  q.keep_values = percentile_count > 0;
+  for (int i = 0; i < path_count; i++) {
+    if (query_file(paths[i], per_entry, &q) == -1) {
+      return 1;
+    }
+    free(paths[i]);
+  }
+
+  // Impresión de los agregados
+  printf("count=%llu\n", (unsigned long long)q.count);
+  if (q.count > 0) {
+    printf("min=%f\nmax=%f\navg=%f\nsum=%f\n", q.min, q.max, q.sum / q.count, q.sum);
+    for (int i = 0; i < percentile_count; i++) {
+      size_t rank = (size_t)(percentiles[i] / 100.0 * (double)(q.count - 1) + 0.5);
+      printf("p%g=%f\n", percentiles[i], select_kth(q.values, q.count, rank));
+    }
+  }
+  if (verbose) {
+    fprintf(stderr, "index entries: %llu skipped, %llu summarized, %llu scanned\n",
+            (unsigned long long)q.skipped, (unsigned long long)q.summarized,
+            (unsigned long long)q.scanned);
+  }
+
+  free(q.values);
+  return 0;
+}
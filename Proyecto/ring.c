@@ -0,0 +1,360 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del buffer circular de muestras (un productor, un consumidor)
+**************************************************************/
+
+#include "ring.h"
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Duerme mientras *word valga expected (o hasta que otro hilo lo despierte).
+// Con timeout_ms >= 0 la espera dura como máximo ese tiempo.
+static void futex_wait(atomic_int *word, int expected, int timeout_ms) {
+    struct timespec timeout = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, timeout_ms >= 0 ? &timeout : NULL, NULL, 0);
+}
+
+// Milisegundos transcurridos en el reloj monotónico.
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Nanosegundos del reloj monotónico.
+static int64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Despierta a los hilos que duermen sobre word.
+static void futex_wake(atomic_int *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+// Despierta al otro extremo sólo si anunció que está dormido. Si se indica
+// wake_fd, el aviso se entrega por ese eventfd en lugar del futex.
+static void wake_if_waiting(atomic_int *waiting, int wake_fd) {
+    // La barrera ordena la publicación del índice antes de leer la bandera
+    // (el otro extremo hace lo simétrico), evitando perder un despertar.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiting, memory_order_relaxed)) {
+        atomic_store_explicit(waiting, 0, memory_order_relaxed);
+        if (wake_fd >= 0) {
+            uint64_t one = 1;
+            if (write(wake_fd, &one, sizeof(one)) == -1) {
+                // El contador del eventfd sólo puede desbordarse si nadie lo lee; no hay nada que hacer.
+            }
+        } else {
+            futex_wake(waiting);
+        }
+    }
+}
+
+// Inicializa el buffer con la menor potencia de 2 mayor o igual a min_capacity.
+int ring_init(spsc_ring *ring, size_t min_capacity) {
+    size_t capacity = 1;
+    while (capacity < min_capacity) {
+        capacity <<= 1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->wake_fd = -1;
+
+    // Un solo bloque contiguo y alineado a línea de caché para todas las muestras.
+    size_t bytes = capacity * sizeof(sample);
+    bytes = (bytes + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    ring->slots = aligned_alloc(CACHE_LINE, bytes);
+    if (!ring->slots) {
+        return -1;
+    }
+    return 0;
+}
+
+// Libera el arreglo de muestras.
+void ring_destroy(spsc_ring *ring) {
+    free(ring->slots);
+    free(ring->cells);
+    ring->slots = NULL;
+    ring->cells = NULL;
+}
+
+// Pasa el buffer al modo con descarte: el arreglo de muestras se reemplaza
+// por uno de seqlocks. Se llama antes de iniciar el productor y el consumidor.
+int ring_enable_overwrite(spsc_ring *ring) {
+    size_t bytes = ring->capacity * sizeof(ring_cell);
+    bytes = (bytes + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+    ring_cell *cells = aligned_alloc(CACHE_LINE, bytes);
+    if (!cells) {
+        return -1;
+    }
+    // Ninguna posición absoluta tiene stamp 0, así que todas empiezan vacías.
+    for (size_t i = 0; i < ring->capacity; i++) {
+        atomic_init(&cells[i].stamp, 0);
+        atomic_init(&cells[i].instance, 0);
+        atomic_init(&cells[i].value, 0);
+        atomic_init(&cells[i].sent_ns, 0);
+        atomic_init(&cells[i].seq, 0);
+        atomic_init(&cells[i].when_ms, 0);
+    }
+    free(ring->slots);
+    ring->slots = NULL;
+    ring->cells = cells;
+    ring->overwrite = 1;
+    return 0;
+}
+
+// Escribe la muestra de la posición absoluta pos. Con descarte se escribe
+// como seqlock: stamp impar, campos, stamp par.
+static void slot_store(spsc_ring *ring, size_t pos, const sample *item) {
+    if (!ring->overwrite) {
+        ring->slots[pos & ring->mask] = *item;
+        return;
+    }
+    ring_cell *cell = &ring->cells[pos & ring->mask];
+    uint32_t bits;
+    memcpy(&bits, &item->value, sizeof(bits));
+    atomic_store_explicit(&cell->stamp, 2 * (uint64_t)pos + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&cell->instance, item->instance, memory_order_relaxed);
+    atomic_store_explicit(&cell->value, bits, memory_order_relaxed);
+    atomic_store_explicit(&cell->sent_ns, item->sent_ns, memory_order_relaxed);
+    atomic_store_explicit(&cell->seq, item->seq, memory_order_relaxed);
+    atomic_store_explicit(&cell->when_ms, item->when_ms, memory_order_relaxed);
+    atomic_store_explicit(&cell->stamp, 2 * (uint64_t)pos + 2, memory_order_release);
+}
+
+// Copia la muestra de la posición absoluta pos en el modo con descarte.
+// Devuelve 0 si el productor la reescribió antes o durante la copia.
+static int cell_load(spsc_ring *ring, size_t pos, sample *item) {
+    ring_cell *cell = &ring->cells[pos & ring->mask];
+    uint64_t expected = 2 * (uint64_t)pos + 2;
+    if (atomic_load_explicit(&cell->stamp, memory_order_acquire) != expected) {
+        return 0;
+    }
+    uint32_t bits = atomic_load_explicit(&cell->value, memory_order_relaxed);
+    item->instance = atomic_load_explicit(&cell->instance, memory_order_relaxed);
+    item->sent_ns = atomic_load_explicit(&cell->sent_ns, memory_order_relaxed);
+    item->seq = atomic_load_explicit(&cell->seq, memory_order_relaxed);
+    item->when_ms = atomic_load_explicit(&cell->when_ms, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&cell->stamp, memory_order_relaxed) != expected) {
+        return 0;
+    }
+    memcpy(&item->value, &bits, sizeof(bits));
+    return 1;
+}
+
+// Encola una muestra. Si el buffer está lleno el productor duerme hasta que el consumidor libere espacio.
+// Devuelve los nanosegundos que estuvo dormido (0 si había espacio; el reloj sólo se lee al dormir).
+int64_t ring_push(spsc_ring *ring, const sample *item) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int64_t wait_start = 0;
+
+    while (head - ring->cached_tail == ring->capacity) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail < ring->capacity) {
+            break;
+        }
+
+        // Anunciar que se va a dormir y volver a comprobar antes de hacerlo.
+        atomic_store_explicit(&ring->producer_waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail < ring->capacity) {
+            atomic_store_explicit(&ring->producer_waiting, 0, memory_order_relaxed);
+            break;
+        }
+        if (wait_start == 0) {
+            wait_start = monotonic_ns();
+        }
+        futex_wait(&ring->producer_waiting, 1, -1);
+    }
+
+    slot_store(ring, head, item);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    wake_if_waiting(&ring->consumer_waiting, -1);
+    return wait_start ? monotonic_ns() - wait_start : 0;
+}
+
+// Encola una muestra sólo si hay espacio. Devuelve 1 si la encoló o 0 si el buffer está lleno.
+int ring_try_push(spsc_ring *ring, const sample *item) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head - ring->cached_tail == ring->capacity) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail == ring->capacity) {
+            return 0;
+        }
+    }
+
+    slot_store(ring, head, item);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    wake_if_waiting(&ring->consumer_waiting, -1);
+    return 1;
+}
+
+// Pide al consumidor que avise por wake_fd cuando libere espacio. Devuelve 1
+// si al volver a comprobar ya hay espacio (no queda aviso pendiente) o 0 si
+// el aviso quedó armado.
+int ring_arm_space(spsc_ring *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->producer_waiting, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - ring->cached_tail < ring->capacity) {
+        atomic_store_explicit(&ring->producer_waiting, 0, memory_order_relaxed);
+        return 1;
+    }
+    return 0;
+}
+
+// Encola una muestra; si el buffer está lleno descarta la más antigua sin
+// esperar. Sólo puede usarse después de ring_enable_overwrite: el productor
+// avanza tail con compare-and-swap antes de reescribir la posición, y el
+// consumidor valida el seqlock de cada posición que copia y también avanza
+// tail con compare-and-swap; si el productor le ganó, vuelve a leer.
+// Devuelve 1 si se descartó una muestra y, si evicted no es NULL, la copia ahí.
+int ring_push_overwrite(spsc_ring *ring, const sample *item, sample *evicted) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    int dropped = 0;
+
+    if (head - tail == ring->capacity) {
+        // Si el CAS falla es porque el consumidor acaba de liberar esa posición.
+        dropped = atomic_compare_exchange_strong_explicit(&ring->tail, &tail, tail + 1,
+                                                          memory_order_acq_rel, memory_order_acquire);
+        // Sólo el productor escribe las posiciones, así que la descartada sigue intacta.
+        if (dropped && evicted) {
+            cell_load(ring, tail, evicted);
+        }
+    }
+
+    slot_store(ring, head, item);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    wake_if_waiting(&ring->consumer_waiting, -1);
+    return dropped;
+}
+
+// 1 si según la última copia de head quedan muestras desde tail. La resta con
+// signo cubre el modo con descarte, donde el productor puede adelantar tail
+// más allá de la copia de head que tiene el consumidor.
+static int has_items(const spsc_ring *ring, size_t tail) {
+    return (ptrdiff_t)(ring->cached_head - tail) > 0;
+}
+
+// Desencola una muestra. Devuelve 1 si obtuvo una muestra o 0 si el buffer se cerró y está vacío.
+int ring_pop(spsc_ring *ring, sample *item) {
+    return ring_pop_timed(ring, item, -1);
+}
+
+// Desencola una muestra esperando como máximo timeout_ms (-1 = sin límite).
+// Devuelve 1 si obtuvo una muestra, 0 si el buffer se cerró y está vacío o -1 si venció el plazo.
+int ring_pop_timed(spsc_ring *ring, sample *item, int timeout_ms) {
+    return ring_pop_batch(ring, item, 1, timeout_ms);
+}
+
+// Desencola hasta max muestras seguidas (al menos una) esperando como máximo
+// timeout_ms (-1 = sin límite) a que haya alguna. Devuelve cuántas obtuvo, 0 si
+// el buffer se cerró y está vacío o -1 si venció el plazo.
+int ring_pop_batch(spsc_ring *ring, sample *items, size_t max, int timeout_ms) {
+    long long deadline = timeout_ms >= 0 ? monotonic_ms() + timeout_ms : 0;
+    size_t tail;
+
+retry:
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (!has_items(ring, tail)) {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (has_items(ring, tail)) {
+            break;
+        }
+
+        // Calcular cuánto queda del plazo antes de dormir.
+        int remaining = -1;
+        if (timeout_ms >= 0) {
+            long long left = deadline - monotonic_ms();
+            if (left <= 0) {
+                return -1;
+            }
+            remaining = (int)left;
+        }
+
+        // Anunciar que se va a dormir y volver a comprobar antes de hacerlo.
+        atomic_store_explicit(&ring->consumer_waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (has_items(ring, tail)) {
+            atomic_store_explicit(&ring->consumer_waiting, 0, memory_order_relaxed);
+            break;
+        }
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            atomic_store_explicit(&ring->consumer_waiting, 0, memory_order_relaxed);
+            return 0;
+        }
+        futex_wait(&ring->consumer_waiting, 1, remaining);
+        atomic_store_explicit(&ring->consumer_waiting, 0, memory_order_relaxed);
+    }
+
+    // Las muestras disponibles según la copia de head.
+    size_t count = ring->cached_head - tail;
+    if (count > max) {
+        count = max;
+    }
+    if (count > ring->capacity) {
+        count = ring->capacity;
+    }
+
+    if (ring->overwrite) {
+        // El productor pudo descartar alguna de estas muestras mientras se
+        // copiaban: si una posición cambió o tail ya no es el leído, la copia
+        // no vale y se vuelve a intentar desde el tail nuevo.
+        for (size_t i = 0; i < count; i++) {
+            if (!cell_load(ring, tail + i, &items[i])) {
+                goto retry;
+            }
+        }
+        if (!atomic_compare_exchange_strong_explicit(&ring->tail, &tail, tail + count,
+                                                     memory_order_acq_rel, memory_order_relaxed)) {
+            goto retry;
+        }
+    } else {
+        // En uno o dos tramos del arreglo.
+        size_t first = tail & ring->mask;
+        size_t run = ring->capacity - first < count ? ring->capacity - first : count;
+        memcpy(items, &ring->slots[first], run * sizeof(sample));
+        memcpy(items + run, ring->slots, (count - run) * sizeof(sample));
+        atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    }
+
+    wake_if_waiting(&ring->producer_waiting, ring->wake_fd);
+    return (int)count;
+}
+
+// Cantidad de muestras encoladas. Desde un hilo ajeno es una foto aproximada.
+size_t ring_depth(spsc_ring *ring) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return head - tail <= ring->capacity ? head - tail : 0;
+}
+
+// Marca el buffer como cerrado y despierta al consumidor para que termine de vaciarlo.
+void ring_close(spsc_ring *ring) {
+    atomic_store_explicit(&ring->closed, 1, memory_order_release);
+    wake_if_waiting(&ring->consumer_waiting, -1);
+}
@@ -0,0 +1,79 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del buffer circular de muestras (un productor, un consumidor)
+**************************************************************/
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE 64 // Tamaño de línea de caché usado para separar los índices
+
+// Muestra tipada que viaja del recolector a los hilos consumidores
+typedef struct {
+    uint32_t instance; // Instancia del sensor que produjo la lectura (el tipo lo da el canal)
+    float value;     // Valor medido
+    int64_t sent_ns; // Instante de envío en el sensor (0 si no se conoce)
+    uint64_t seq;    // Secuencia en el diario de ingesta (0 sin diario)
+    int64_t when_ms; // Hora de llegada de una muestra reinyectada del diario (0 = la pone el consumidor)
+} sample;
+
+// Posición del buffer en el modo con descarte (drop-oldest). Ahí el productor
+// puede reescribir la muestra más antigua mientras el consumidor la copia, así
+// que cada posición es un seqlock con campos atómicos, como en la difusión:
+// stamp = 2p + 1 mientras se escribe la muestra de la posición absoluta p y
+// 2p + 2 cuando está completa. El consumidor descarta una copia si stamp cambió.
+typedef struct {
+    atomic_uint_least64_t stamp; // Versión de la posición (ver arriba)
+    atomic_uint instance;        // Instancia del sensor
+    atomic_uint value;           // Bits del valor (float)
+    atomic_int_least64_t sent_ns; // Instante de envío en el sensor
+    atomic_uint_least64_t seq;   // Secuencia en el diario de ingesta
+    atomic_int_least64_t when_ms; // Hora de llegada de una muestra reinyectada
+} ring_cell;
+
+// Buffer circular contiguo sin mutex: el recolector es el único productor y
+// cada hilo consumidor es el único lector de su buffer. Sólo se hace una
+// llamada al sistema (futex) cuando el otro extremo está dormido esperando.
+typedef struct {
+    // Datos del productor
+    _Alignas(CACHE_LINE) atomic_size_t head; // Próxima posición a escribir
+    size_t cached_tail;                      // Última copia de tail vista por el productor
+    atomic_int producer_waiting;             // 1 si el productor duerme porque el buffer está lleno
+
+    // Datos del consumidor
+    _Alignas(CACHE_LINE) atomic_size_t tail; // Próxima posición a leer
+    size_t cached_head;                      // Última copia de head vista por el consumidor
+    atomic_int consumer_waiting;             // 1 si el consumidor duerme porque el buffer está vacío
+
+    // Datos compartidos de sólo lectura
+    _Alignas(CACHE_LINE) size_t capacity; // Capacidad (potencia de 2)
+    size_t mask;                          // capacity - 1
+    atomic_int closed;                    // 1 cuando el productor ya no enviará más muestras
+    int overwrite;                        // 1 si el productor puede descartar la muestra más antigua
+    int wake_fd;                          // eventfd que avisa al productor que hay espacio (-1 = futex)
+    sample *slots;                        // Arreglo contiguo de muestras (NULL con overwrite)
+    ring_cell *cells;                     // Arreglo de seqlocks (sólo con overwrite)
+} spsc_ring;
+
+// Prototipos de funciones
+int ring_init(spsc_ring *ring, size_t min_capacity); // Reserva el arreglo de muestras
+void ring_destroy(spsc_ring *ring);                  // Libera el arreglo de muestras
+int ring_enable_overwrite(spsc_ring *ring);          // Pasa al modo con descarte (antes de usarlo)
+int64_t ring_push(spsc_ring *ring, const sample *item); // Encola una muestra, esperando si está lleno; ns de espera
+int ring_try_push(spsc_ring *ring, const sample *item); // Encola sin esperar; 0 si está lleno
+int ring_arm_space(spsc_ring *ring);                 // Pide aviso por wake_fd al liberar espacio; 1 si ya hay
+int ring_push_overwrite(spsc_ring *ring, const sample *item, sample *evicted); // Encola descartando la más antigua si está lleno; 1 si descartó
+int ring_pop(spsc_ring *ring, sample *item);         // Desencola una muestra; 0 si se cerró y está vacío
+int ring_pop_timed(spsc_ring *ring, sample *item, int timeout_ms); // Igual que ring_pop; -1 si vence el plazo
+int ring_pop_batch(spsc_ring *ring, sample *items, size_t max, int timeout_ms); // Varias seguidas; cuántas, 0 o -1
+void ring_close(spsc_ring *ring);                    // Indica al consumidor que no habrá más muestras
+size_t ring_depth(spsc_ring *ring);                  // Muestras encoladas (lectura aproximada desde cualquier hilo)
+
+#endif // RING_H
@@ -0,0 +1,491 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la rotación y compresión de los segmentos de salida
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "segment.h"
+#include "codec.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// Configuración por defecto: sin rotación ni compresión
+segment_config segment_settings = { 0, 0, 0 };
+
+// Segmento cerrado que espera al hilo compresor
+typedef struct compress_job {
+    char manifest[SEGMENT_PATH_LEN]; // Manifiesto del segmento
+    manifest_entry entry;            // Estado del segmento al cerrarse
+    struct compress_job *next;       // Siguiente en la cola
+} compress_job;
+
+// Lecturas de un segmento recorrido (al comprimirlo o al recuperarlo)
+typedef struct {
+    int64_t first_ms, last_ms; // Primera y última marca de tiempo
+    uint64_t count;            // Lecturas
+} segment_range;
+
+// Estado de la compresión de un segmento
+typedef struct {
+    segment_range range;             // Lecturas comprimidas
+    int64_t ms[LOG_BLOCK_MAX];       // Marcas de tiempo del bloque en construcción
+    float values[LOG_BLOCK_MAX];     // Valores del bloque en construcción
+    uint32_t count;                  // Lecturas del bloque en construcción
+    unsigned char *out;              // Bloque comprimido (codec_bound(LOG_BLOCK_MAX) bytes)
+    int fd;                          // Archivo comprimido temporal
+    uint64_t bytes;                  // Bytes escritos en el archivo comprimido
+    int failed;                      // 1 si falló una escritura
+} compress_state;
+
+// Cola de segmentos por comprimir (se toca fuera del camino de cada lectura: una vez por rotación)
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static compress_job *queue_head, *queue_tail;
+static int queue_stopping;
+static int compressor_running;
+static pthread_t compressor;
+
+// Totales del hilo compresor (sólo los escribe él; se leen después del join)
+static uint64_t compressed_segments, compressed_in, compressed_out;
+
+// Visita de log_scan: acumula el rango de lecturas del segmento.
+static void range_visit(int64_t ms, float value, void *ctx) {
+    (void)value;
+    segment_range *r = ctx;
+    if (r->count == 0) {
+        r->first_ms = ms;
+    }
+    r->last_ms = ms;
+    r->count++;
+}
+
+// Encola un segmento cerrado para el hilo compresor (si está en marcha).
+static void enqueue(const char *manifest_path, const manifest_entry *e) {
+    if (!compressor_running) {
+        return;
+    }
+    compress_job *job = malloc(sizeof(compress_job));
+    if (!job) {
+        fprintf(stderr, "Error allocating the compression of %s\n", e->segment);
+        return;
+    }
+    snprintf(job->manifest, sizeof(job->manifest), "%s", manifest_path);
+    job->entry = *e;
+    job->next = NULL;
+
+    pthread_mutex_lock(&queue_lock);
+    if (queue_tail) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+// Escribe len bytes completos, repitiendo write() si la escritura es parcial.
+static int write_all(int fd, const unsigned char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Comprime el bloque en construcción y lo escribe.
+static void compress_block(compress_state *c) {
+    if (c->count == 0 || c->failed) {
+        return;
+    }
+    size_t size = codec_encode(c->ms, c->values, c->count, c->out);
+    if (write_all(c->fd, c->out, size) == -1) {
+        c->failed = 1;
+    }
+    c->bytes += size;
+    c->count = 0;
+}
+
+// Visita de log_scan: agrega la lectura al bloque y lo comprime cuando se llena.
+static void compress_visit(int64_t ms, float value, void *ctx) {
+    compress_state *c = ctx;
+    range_visit(ms, value, &c->range);
+    c->ms[c->count] = ms;
+    c->values[c->count] = value;
+    if (++c->count == LOG_BLOCK_MAX) {
+        compress_block(c);
+    }
+}
+
+// Comprime un segmento cerrado en "<segmento>.z". La copia se escribe en un
+// temporal, se sincroniza y se renombra; el original (y su índice) sólo se
+// borra después de que el manifiesto registra la copia comprimida.
+static void compress_segment(const compress_job *job) {
+    char path[SEGMENT_PATH_LEN], packed[SEGMENT_PATH_LEN + 8], tmp[SEGMENT_PATH_LEN + 8];
+    if (manifest_file(job->manifest, &job->entry, path, sizeof(path)) == -1) {
+        return;
+    }
+    snprintf(packed, sizeof(packed), "%s.z", path);
+    snprintf(tmp, sizeof(tmp), "%s.z.tmp", path);
+
+    log_map map;
+    if (log_map_open(path, &map) == -1) {
+        fprintf(stderr, "Error opening the segment %s for compression\n", path);
+        return;
+    }
+    compress_state *c = calloc(1, sizeof(compress_state));
+    if (c) {
+        c->out = malloc(codec_bound(LOG_BLOCK_MAX));
+    }
+    if (!c || !c->out || (c->fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1) {
+        fprintf(stderr, "Error creating the compressed segment %s\n", packed);
+        if (c) {
+            free(c->out);
+            free(c);
+        }
+        log_map_close(&map);
+        return;
+    }
+
+    log_scan(&map, log_is_binary(&map), 0, map.size, compress_visit, c);
+    compress_block(c);
+    int ok = !c->failed && c->range.count > 0 && fdatasync(c->fd) == 0;
+    ok = close(c->fd) == 0 && ok && rename(tmp, packed) == 0;
+
+    if (ok) {
+        manifest_entry entry = job->entry;
+        snprintf(entry.state, sizeof(entry.state), "compressed");
+        entry.first_ms = c->range.first_ms;
+        entry.last_ms = c->range.last_ms;
+        entry.count = c->range.count;
+        entry.bytes = c->bytes;
+        if (manifest_append(job->manifest, &entry) == 0) {
+            char idx[SEGMENT_PATH_LEN + 8];
+            snprintf(idx, sizeof(idx), "%s.idx", path);
+            unlink(path);
+            unlink(idx);
+        }
+        compressed_segments++;
+        compressed_in += map.size;
+        compressed_out += c->bytes;
+    } else {
+        unlink(tmp);
+        fprintf(stderr, "Error compressing the segment %s\n", path);
+    }
+
+    free(c->out);
+    free(c);
+    log_map_close(&map);
+}
+
+// Hilo compresor: atiende la cola hasta que se detiene y queda vacía.
+static void *compressor_thread(void *param) {
+    (void)param;
+
+    // Menor prioridad que los consumidores (en Linux nice se aplica por hilo).
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+
+    for (;;) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_head == NULL && !queue_stopping) {
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        }
+        compress_job *job = queue_head;
+        if (job) {
+            queue_head = job->next;
+            if (queue_head == NULL) {
+                queue_tail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&queue_lock);
+
+        if (job == NULL) {
+            break;
+        }
+        compress_segment(job);
+        free(job);
+    }
+    return NULL;
+}
+
+// Lanza el hilo compresor si la compresión está habilitada.
+int segment_start(void) {
+    if (!segment_settings.compress) {
+        return 0;
+    }
+    if (pthread_create(&compressor, NULL, compressor_thread, NULL) != 0) {
+        fprintf(stderr, "Error starting the segment compressor\n");
+        return -1;
+    }
+    compressor_running = 1;
+    return 0;
+}
+
+// Deja que el hilo compresor termine la cola y lo espera.
+void segment_stop(void) {
+    if (!compressor_running) {
+        return;
+    }
+    pthread_mutex_lock(&queue_lock);
+    queue_stopping = 1;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(compressor, NULL);
+    compressor_running = 0;
+
+    if (compressed_segments > 0) {
+        printf("Segments compressed: %llu (%llu -> %llu bytes)\n", (unsigned long long)compressed_segments,
+               (unsigned long long)compressed_in, (unsigned long long)compressed_out);
+    }
+}
+
+// 1 si las salidas se rotan en segmentos.
+static int rotating(void) {
+    return segment_settings.rotate_ms > 0 || segment_settings.rotate_bytes > 0;
+}
+
+// Abre el escritor por lotes sobre path con la medición de latencia y las métricas.
+static int attach(segment_writer *s, const char *path) {
+    if (writer_open(&s->out, path) == -1) {
+        return -1;
+    }
+    if (s->latency && writer_track_latency(&s->out, s->latency) == -1) {
+        writer_close(&s->out);
+        return -1;
+    }
+    writer_track_metrics(&s->out, s->metrics);
+    s->open = 1;
+    return 0;
+}
+
+// Cierra los segmentos que un monitor anterior dejó abiertos (por ejemplo,
+// al terminar por un fallo) y vuelve a encolar los que quedaron sin comprimir.
+static int recover(segment_writer *s) {
+    manifest m;
+    if (manifest_load(s->manifest, &m) == -1) {
+        fprintf(stderr, "Error reading the manifest %s\n", s->manifest);
+        return -1;
+    }
+
+    for (size_t i = 0; i < m.count; i++) {
+        manifest_entry *e = &m.entries[i];
+        if (strcmp(e->state, "open") == 0) {
+            char path[SEGMENT_PATH_LEN];
+            log_map map;
+            if (manifest_file(s->manifest, e, path, sizeof(path)) == -1 || log_map_open(path, &map) == -1) {
+                continue;
+            }
+            segment_range range = { 0 };
+            log_scan(&map, log_is_binary(&map), 0, map.size, range_visit, &range);
+            snprintf(e->state, sizeof(e->state), "closed");
+            e->first_ms = range.count ? range.first_ms : e->first_ms;
+            e->last_ms = range.count ? range.last_ms : e->first_ms;
+            e->count = range.count;
+            e->bytes = map.size;
+            log_map_close(&map);
+            manifest_append(s->manifest, e);
+        }
+        if (strcmp(e->state, "closed") == 0 && e->count > 0) {
+            enqueue(s->manifest, e);
+        }
+    }
+    manifest_free(&m);
+    return 0;
+}
+
+// Prepara la salida de un consumidor. Sin rotación abre base directamente;
+// con rotación el primer segmento se crea con la primera lectura.
+int segment_open(segment_writer *s, const char *base, histogram *latency, writer_metrics *metrics) {
+    memset(s, 0, sizeof(*s));
+    s->base = base;
+    s->latency = latency;
+    s->metrics = metrics;
+    s->partition_end = INT64_MAX;
+    if (!rotating()) {
+        return attach(s, base);
+    }
+
+    int n = snprintf(s->manifest, sizeof(s->manifest), "%s.manifest", base);
+    if (n < 0 || (size_t)n >= sizeof(s->manifest)) {
+        return -1;
+    }
+    return recover(s);
+}
+
+// Crea el segmento de la partición a la que pertenece when_ms y lo registra como abierto.
+static int start_partition(segment_writer *s, int64_t when_ms) {
+    int64_t start = when_ms;
+    s->partition_end = INT64_MAX;
+    if (segment_settings.rotate_ms > 0) {
+        start = when_ms - when_ms % segment_settings.rotate_ms;
+        s->partition_end = start + segment_settings.rotate_ms;
+    }
+
+    char stamp[32];
+    time_t seconds = (time_t)(start / 1000);
+    struct tm tm_info;
+    localtime_r(&seconds, &tm_info);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_info);
+
+    // Nunca se reabre un segmento anterior (por ejemplo, al reiniciar el monitor
+    // dentro de la misma partición o al rotar por tamaño): se agrega un sufijo.
+    for (int k = 0;; k++) {
+        char packed[SEGMENT_PATH_LEN + 8];
+        int n = k == 0 ? snprintf(s->path, sizeof(s->path), "%s.%s", s->base, stamp)
+                       : snprintf(s->path, sizeof(s->path), "%s.%s-%d", s->base, stamp, k);
+        if (n < 0 || (size_t)n >= sizeof(s->path)) {
+            return -1;
+        }
+        snprintf(packed, sizeof(packed), "%s.z", s->path);
+        if (access(s->path, F_OK) == -1 && access(packed, F_OK) == -1) {
+            break;
+        }
+    }
+
+    const char *slash = strrchr(s->path, '/');
+    const char *name = slash ? slash + 1 : s->path;
+    size_t name_len = strlen(name);
+    if (name_len >= sizeof(s->entry.segment) || attach(s, s->path) == -1) {
+        return -1;
+    }
+
+    memset(&s->entry, 0, sizeof(s->entry));
+    snprintf(s->entry.state, sizeof(s->entry.state), "open");
+    memcpy(s->entry.segment, name, name_len + 1);
+    s->entry.first_ms = when_ms;
+    s->entry.last_ms = -1;
+    if (manifest_append(s->manifest, &s->entry) == -1) {
+        fprintf(stderr, "Error writing the manifest %s\n", s->manifest);
+    }
+    s->entry.last_ms = when_ms;
+    return 0;
+}
+
+// Cierra el segmento abierto, lo registra con su rango y lo encola para comprimirlo.
+static int finish_partition(segment_writer *s) {
+    if (!s->open) {
+        return 0;
+    }
+    int result = writer_close(&s->out);
+    s->open = 0;
+
+    // Quien escribe puede registrar hasta dónde llegó el segmento antes de que
+    // figure como cerrado y se encole para comprimirlo.
+    if (s->on_finish) {
+        s->on_finish(s->hook_ctx, s->path, s->out.written);
+    }
+
+    snprintf(s->entry.state, sizeof(s->entry.state), "closed");
+    s->entry.bytes = s->out.written;
+    if (manifest_append(s->manifest, &s->entry) == -1) {
+        fprintf(stderr, "Error writing the manifest %s\n", s->manifest);
+    }
+    enqueue(s->manifest, &s->entry);
+    return result;
+}
+
+// Agrega una lectura. Antes cierra el segmento si la lectura cae en otra
+// partición o si el segmento alcanzó el tamaño máximo.
+int segment_append(segment_writer *s, int64_t when_ms, float value, int64_t sent_ns, uint64_t mark) {
+    if (!rotating()) {
+        return writer_append_sample(&s->out, when_ms, value, sent_ns, mark);
+    }
+
+    if (s->open && (when_ms >= s->partition_end ||
+                    (segment_settings.rotate_bytes > 0 && writer_size(&s->out) >= segment_settings.rotate_bytes))) {
+        finish_partition(s);
+    }
+    if (!s->open && start_partition(s, when_ms) == -1) {
+        return -1;
+    }
+    s->entry.last_ms = when_ms;
+    s->entry.count++;
+    s->fed = 1;
+    return writer_append_sample(&s->out, when_ms, value, sent_ns, mark);
+}
+
+// Milisegundos hasta que deba escribirse el lote pendiente o cerrarse la
+// partición abierta, o -1 si no hay segmento abierto.
+int segment_wait_ms(const segment_writer *s) {
+    if (!s->open) {
+        return -1;
+    }
+    int wait = writer_wait_ms(&s->out);
+    if (s->partition_end != INT64_MAX) {
+        int64_t end = s->fed_ms + SEGMENT_IDLE_MS;
+        if (s->partition_end > end) {
+            end = s->partition_end;
+        }
+        int64_t left = end - writer_epoch_ms();
+        int ms = left <= 0 ? 0 : left > INT_MAX ? INT_MAX : (int)left;
+        if (wait == -1 || ms < wait) {
+            wait = ms;
+        }
+    }
+    return wait;
+}
+
+// Cierra la partición si ya terminó (aunque no lleguen lecturas, para que el
+// segmento pueda archivarse) o escribe el lote si venció su plazo. Una
+// partición vencida que sigue recibiendo lecturas (las reinyectadas del
+// diario traen su hora de llegada) la cierra la primera lectura posterior, o
+// este aviso SEGMENT_IDLE_MS después de la última, así no se parte en dos.
+void segment_flush(segment_writer *s) {
+    if (!s->open) {
+        return;
+    }
+    int64_t now = writer_epoch_ms();
+    if (s->fed) {
+        s->fed = 0;
+        s->fed_ms = now;
+    }
+    if (s->partition_end != INT64_MAX && now >= s->partition_end && now >= s->fed_ms + SEGMENT_IDLE_MS) {
+        finish_partition(s);
+        return;
+    }
+    if (writer_wait_ms(&s->out) == 0) {
+        writer_flush(&s->out);
+    }
+}
+
+// Escribe lo pendiente y cierra el segmento abierto (con rotación queda
+// registrado como cerrado y encolado para comprimirse).
+int segment_close(segment_writer *s) {
+    if (!rotating()) {
+        return s->open ? writer_close(&s->out) : 0;
+    }
+    return finish_partition(s);
+}
+
+// Marca de la lectura más antigua que todavía no llegó al archivo (ver
+// writer_pending_mark), o 0 si no hay nada pendiente.
+uint64_t segment_pending_mark(const segment_writer *s) {
+    return s->open ? writer_pending_mark(&s->out) : 0;
+}
+
+// Archivo en el que se escribe (el de la parte o el último segmento; "" si
+// todavía no se abrió ninguno) y en *size los bytes que ya tiene escritos.
+const char *segment_position(const segment_writer *s, uint64_t *size) {
+    *size = s->out.written;
+    return rotating() ? s->path : s->base;
+}
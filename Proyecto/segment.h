@@ -0,0 +1,71 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la rotación y compresión de los segmentos de salida
+**************************************************************/
+
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <stdint.h>
+#include "hist.h"
+#include "manifest.h"
+#include "metrics.h"
+#include "writer.h"
+
+// Sin rotación cada consumidor escribe siempre en su archivo, como antes.
+// Con rotación escribe en particiones de tiempo fijo (por ejemplo, una por
+// hora, alineadas con el reloj) y/o de tamaño máximo. Cada partición es un
+// segmento "<archivo>.<YYYYmmdd-HHMMSS>" (la fecha es el inicio de la
+// partición) que se crea con su primera lectura y queda registrado en
+// "<archivo>.manifest" (ver manifest.h). Al cerrarse, un hilo en segundo plano
+// puede comprimirlo con el códec de codec.h y borrar el original.
+
+#define SEGMENT_PATH_LEN 512 // Longitud máxima de la ruta de un segmento
+#define SEGMENT_IDLE_MS 100  // Tiempo sin lecturas tras el cual se cierra una partición vencida
+
+// Parámetros comunes a la rotación de todos los archivos de salida
+typedef struct {
+    int64_t rotate_ms;     // Duración de cada partición (0 = sin rotación por tiempo)
+    uint64_t rotate_bytes; // Tamaño que provoca una rotación (0 = sin rotación por tamaño)
+    int compress;          // 1 para comprimir los segmentos cerrados en segundo plano
+} segment_config;
+
+// Aviso de que un segmento se cerró: path y size son su ruta y su tamaño final
+typedef void (*segment_hook)(void *ctx, const char *path, uint64_t size);
+
+// Archivo de salida de un consumidor, rotado en segmentos
+typedef struct {
+    const char *base;                // Archivo del canal o de la parte
+    char manifest[SEGMENT_PATH_LEN]; // "<archivo>.manifest"
+    char path[SEGMENT_PATH_LEN];     // Segmento abierto
+    manifest_entry entry;            // Estado del segmento abierto
+    batch_writer out;                // Escritor del segmento abierto
+    int open;                        // 1 si hay un segmento abierto
+    int64_t partition_end;           // Fin de la partición abierta (INT64_MAX si sólo se rota por tamaño)
+    int fed;                         // 1 si recibió lecturas desde el último segment_flush
+    int64_t fed_ms;                  // Último segment_flush que la encontró recibiendo lecturas
+    histogram *latency;              // Latencia de las lecturas escritas (se pasa a cada escritor)
+    writer_metrics *metrics;         // Métricas de escritura (se pasan a cada escritor)
+    segment_hook on_finish;          // Se llama al cerrar cada segmento, antes de registrarlo (NULL = nada)
+    void *hook_ctx;                  // Argumento de on_finish
+} segment_writer;
+
+// Declaración de variables globales
+extern segment_config segment_settings; // Configuración elegida en la línea de comandos
+
+// Prototipos de funciones
+int segment_start(void); // Lanza el hilo compresor si está habilitado
+void segment_stop(void); // Comprime los segmentos pendientes y espera al hilo
+int segment_open(segment_writer *s, const char *base, histogram *latency, writer_metrics *metrics); // Prepara la salida
+int segment_append(segment_writer *s, int64_t when_ms, float value, int64_t sent_ns,
+                   uint64_t mark); // Agrega una lectura (rota si toca)
+int segment_wait_ms(const segment_writer *s); // Milisegundos hasta el próximo lote o rotación (-1 si nada)
+void segment_flush(segment_writer *s);        // Escribe el lote vencido o cierra la partición terminada
+int segment_close(segment_writer *s);         // Escribe lo pendiente y cierra el segmento abierto
+uint64_t segment_pending_mark(const segment_writer *s); // Marca de la lectura más antigua sin escribir (0 si no hay)
+const char *segment_position(const segment_writer *s, uint64_t *size); // Archivo actual y bytes ya escritos
+
+#endif // SEGMENT_H
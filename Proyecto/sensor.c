@@ -6,21 +6,653 @@ Tema: Proyecto
 Fichero: Manejo de sensor.c
 **************************************************************/
 
+#include "logfmt.h"
+#include "protocol.h"
+#include "shmring.h"
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
 
+// Holgura del planificador de varios sensores: las lecturas que vencen dentro
+// de este margen salen junto con la que despertó al proceso, en el mismo write()
+#define SCHED_SLACK_NS 1000000
+
+// Transporte por memoria compartida con el monitor (NULL = registros de texto por el pipe)
+static shm_producer *shm = NULL;
+
+// Identificador de esta instancia del sensor; el monitor lo usa para elegir el
+// consumidor del canal, de modo que las lecturas de un sensor no se desordenen
+static uint32_t instance = 0;
+static int instance_given = 0; // 1 si la instancia se eligió con -i
+
+// Sin -i cada proceso usa el bloque de instancias (PID << INSTANCE_INDEX_BITS) | i,
+// con i = 0 para el sensor único o la posición del sensor virtual en el
+// manifiesto. Linux no pasa de 2^22 PID, así que el bloque cabe en 32 bits y
+// dos procesos nunca comparten una instancia. Con -i (o una instancia en el
+// manifiesto) quien lanza los sensores debe cuidar que no se repitan.
+#define INSTANCE_INDEX_BITS 10
+
+// Reenvío después de reconectarse (-b). El sensor guarda una copia de sus
+// últimas lecturas en un buffer circular de tamaño fijo; si el monitor deja de
+// recibir (por ejemplo, porque se reinicia después de un fallo) se reconecta y
+// las vuelve a enviar. Cada lectura lleva el PID del proceso como emisor: el
+// monitor con diario (-J) recuerda el último instante de envío de cada emisor
+// y descarta las reenviadas que ya tenía, así que no se repiten.
+#define RECONNECT_MS 30000      // Tiempo máximo intentando reconectarse
+#define RECONNECT_STEP_US 50000 // Pausa entre intentos
+
+// Lectura guardada para reenviarla
+typedef struct {
+  int sensorType;  // Tipo de sensor
+  uint32_t id;     // Instancia
+  float value;     // Valor
+  int64_t sent_ns; // Instante de envío original
+} sent_record;
+
+static sent_record *history = NULL; // Últimas lecturas enviadas (NULL = sin reenvío)
+static size_t history_cap = 0;      // Capacidad del buffer
+static size_t history_count = 0;    // Lecturas guardadas
+static size_t history_next = 0;     // Próxima posición a escribir
+static const char *monitor_path;    // Pipe o socket del monitor (para reconectarse)
+static int64_t last_sent_ns = 0;    // Último instante de envío usado
+static uint32_t sender = 0;         // Emisor que se informa al monitor (PID con -b, 0 sin reenvío)
+
+// Escribe len bytes completos en el descriptor. Devuelve 0 o -1 si falla.
+static int write_all(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, data, len);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// Registros de texto pendientes de escribir. Se agrupan hasta PIPE_BUF para
+// que cada write() siga siendo atómico aunque varios sensores compartan el pipe.
+static char batch[PIPE_BUF];
+static size_t batch_used = 0;
+
+// Guarda una copia de la lectura enviada (pisa la más antigua si está lleno).
+static void remember(int sensorType, uint32_t id, float value, int64_t sent_ns) {
+  if (!history) {
+    return;
+  }
+  history[history_next] = (sent_record){ sensorType, id, value, sent_ns };
+  history_next = (history_next + 1) % history_cap;
+  if (history_count < history_cap) {
+    history_count++;
+  }
+}
+
+// Vuelve a enviar las lecturas guardadas, de la más antigua a la más nueva.
+static int resend_history(int fd) {
+  char chunk[PIPE_BUF];
+  size_t used = 0;
+  for (size_t i = 0; i < history_count; i++) {
+    const sent_record *r = &history[(history_next + history_cap - history_count + i) % history_cap];
+    if (shm) {
+      if (shm_producer_push(shm, r->sensorType, r->id, r->value, r->sent_ns, sender) == -1) {
+        return -1;
+      }
+      continue;
+    }
+    char record[PROTO_MAX_RECORD];
+    int length = proto_format_timed(record, sizeof(record), r->sensorType, r->value, r->sent_ns, r->id, sender);
+    if (used + (size_t)length > sizeof(chunk)) {
+      if (write_all(fd, chunk, used) == -1) {
+        return -1;
+      }
+      used = 0;
+    }
+    memcpy(chunk + used, record, (size_t)length);
+    used += (size_t)length;
+  }
+  return used > 0 ? write_all(fd, chunk, used) : 0;
+}
+
+// Abre de nuevo el pipe o el socket del monitor sin quedarse esperando: un
+// pipe sin lector todavía (el monitor no arrancó) falla y se reintenta.
+static int reopen_monitor(void) {
+  struct stat st;
+  if (stat(monitor_path, &st) == 0 && S_ISFIFO(st.st_mode)) {
+    int fd = open(monitor_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd != -1) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    return fd;
+  }
+  return proto_connect(monitor_path);
+}
+
+// El monitor dejó de recibir: se reconecta (hasta RECONNECT_MS) sobre el mismo
+// número de descriptor y reenvía las lecturas guardadas, que incluyen las del
+// lote que falló. Devuelve 0 o -1 si no se pudo reconectar.
+static int reconnect(int fd) {
+  fprintf(stderr, "Error: The monitor stopped receiving, reconnecting...\n");
+  int64_t deadline = proto_now_ns() + (int64_t)RECONNECT_MS * 1000000;
+  while (proto_now_ns() < deadline) {
+    int fresh = reopen_monitor();
+    if (fresh != -1) {
+      dup2(fresh, fd);
+      close(fresh);
+      int ready = 1;
+      if (shm) {
+        shm_producer_close(shm);
+        ready = shm_producer_open(shm, fd) == 0;
+      }
+      if (ready && resend_history(fd) == 0) {
+        batch_used = 0;
+        printf("Reconnected to the monitor: %zu samples resent\n", history_count);
+        return 0;
+      }
+    }
+    usleep(RECONNECT_STEP_US);
+  }
+  fprintf(stderr, "Error: Could not reconnect to the monitor.\n");
+  return -1;
+}
+
+// Escribe los registros pendientes. Devuelve 0 o -1 si falla.
+static int flush_batch(int fd) {
+  if (batch_used > 0 && write_all(fd, batch, batch_used) == -1) {
+    if (history) {
+      return reconnect(fd);
+    }
+    perror("Error writing to the pipe");
+    return -1;
+  }
+  batch_used = 0;
+  return 0;
+}
+
+// Agrega una lectura del sensor id al lote (o la copia al buffer compartido con
+// el monitor). Devuelve 0 o -1 si el monitor dejó de recibir.
+static int send_sample(int fd, int sensorType, uint32_t id, float value, int64_t sent_ns) {
+  // Los instantes de envío son estrictamente crecientes: con ellos el monitor
+  // reconoce las lecturas reenviadas (varios sensores virtuales pueden salir en el mismo instante).
+  if (sent_ns <= last_sent_ns) {
+    sent_ns = last_sent_ns + 1;
+  }
+  last_sent_ns = sent_ns;
+
+  // Por memoria compartida la muestra se copia directo al buffer del monitor, sin texto ni write()
+  if (shm) {
+    int failed = shm_producer_push(shm, sensorType, id, value, sent_ns, sender) == -1;
+    remember(sensorType, id, value, sent_ns);
+    if (failed && (!history || reconnect(fd) == -1)) {
+      fprintf(stderr, "Error: The monitor closed the shared memory transport.\n");
+      return -1;
+    }
+    return 0;
+  }
+
+  char record[PROTO_MAX_RECORD];
+  int length = proto_format_timed(record, sizeof(record), sensorType, value, sent_ns, id, sender);
+  if (batch_used + (size_t)length > sizeof(batch) && flush_batch(fd) == -1) {
+    return -1;
+  }
+  memcpy(batch + batch_used, record, (size_t)length);
+  batch_used += (size_t)length;
+  remember(sensorType, id, value, sent_ns);
+  return 0;
+}
+
+// Duerme hasta el instante absoluto due_ns de CLOCK_MONOTONIC.
+static void sleep_until(int64_t due_ns) {
+  struct timespec next = { due_ns / 1000000000, due_ns % 1000000000 };
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {
+  }
+}
+
+// Muestra cuántas lecturas se enviaron y a qué velocidad.
+static void print_summary(const char *action, long sent, int64_t start_ns) {
+  double elapsed = (proto_now_ns() - start_ns) / 1e9;
+  printf("Sensor %s %ld samples in %.3f s (%.0f samples/s)\n", action, sent, elapsed,
+         elapsed > 0 ? sent / elapsed : 0.0);
+}
+
+// Modo generador de carga: envía count lecturas sintéticas entre low y high
+// a rate lecturas por segundo (0 = sin pausa). Cada registro lleva el instante
+// de envío para que el monitor mida la latencia de extremo a extremo.
+static int run_load_generator(int fd, int sensorType, double rate, long count,
+                              float low, float high) {
+  unsigned int seed = (unsigned int)getpid();
+  float value = (low + high) / 2;
+  int64_t start_ns = proto_now_ns();
+  int64_t period_ns = rate > 0 ? (int64_t)(1e9 / rate) : 0;
+  long sent;
+
+  for (sent = 0; count == 0 || sent < count; sent++) {
+    // Caminata aleatoria dentro del rango pedido
+    value += ((float)rand_r(&seed) / RAND_MAX - 0.5f) * (high - low) * 0.05f;
+    if (value < low || value > high) {
+      value = (low + high) / 2;
+    }
+
+    // Espera absoluta hasta el instante programado de esta lectura (sin deriva acumulada)
+    if (period_ns > 0) {
+      sleep_until(start_ns + sent * period_ns);
+    }
+
+    if (send_sample(fd, sensorType, instance, value, proto_now_ns()) == -1) {
+      return -1;
+    }
+
+    // Con pausa entre lecturas cada una se envía en cuanto se genera
+    if (period_ns > 0 && flush_batch(fd) == -1) {
+      return -1;
+    }
+  }
+  if (flush_batch(fd) == -1) {
+    return -1;
+  }
+
+  print_summary("sent", sent, start_ns);
+  return 0;
+}
+
+// Estado de una reproducción de archivo
+typedef struct {
+  int fd;              // Pipe o socket del monitor
+  int sensorType;      // Tipo de sensor
+  double speed;        // Multiplicador de velocidad (0 = sin pausas)
+  int64_t interval_ns; // Separación de las lecturas sin marca de tiempo
+  int64_t pass_ns;     // Instante de inicio de la pasada actual
+  int64_t first_ms;    // Primera marca de tiempo de la pasada (-1 si aún no hay)
+  int64_t offset_ns;   // Desplazamiento acumulado de las lecturas sin marca de tiempo
+  int64_t ready_ns;    // Hasta este instante no hace falta volver a mirar el reloj
+  long sent;           // Lecturas enviadas
+  int failed;          // 1 si el monitor dejó de recibir
+} replay_state;
+
+// Programa y envía una lectura de la reproducción. ms es su marca de tiempo
+// (-1 si la línea no trae una). Los valores negativos se omiten, como en el modo normal.
+static void replay_sample(int64_t ms, float value, void *ctx) {
+  replay_state *r = ctx;
+  if (r->failed || value < 0) {
+    return;
+  }
+
+  // El instante de envío se calcula desde el inicio de la pasada: las esperas
+  // son absolutas y el redondeo de cada una no se acumula.
+  if (r->speed > 0) {
+    int64_t offset_ns;
+    if (ms >= 0) {
+      if (r->first_ms < 0) {
+        r->first_ms = ms;
+      }
+      offset_ns = (int64_t)((ms - r->first_ms) * 1e6 / r->speed);
+    } else {
+      offset_ns = r->offset_ns;
+      r->offset_ns += (int64_t)(r->interval_ns / r->speed);
+    }
+
+    int64_t due_ns = r->pass_ns + offset_ns;
+    if (due_ns > r->ready_ns) {
+      r->ready_ns = proto_now_ns();
+      if (due_ns > r->ready_ns) {
+        // Lo acumulado sale antes de dormir para no retrasarlo hasta la siguiente lectura
+        if (flush_batch(r->fd) == -1) {
+          r->failed = 1;
+          return;
+        }
+        sleep_until(due_ns);
+        r->ready_ns = due_ns;
+      }
+    }
+  }
+
+  if (send_sample(r->fd, r->sensorType, instance, value, proto_now_ns()) == -1) {
+    r->failed = 1;
+    return;
+  }
+  r->sent++;
+}
+
+// Recorre un archivo de texto proyectado: cada línea es "valor" o
+// "{YYYY-mm-dd HH:MM:SS} valor" (el formato de texto que escribe el monitor).
+static void replay_text(const log_map *map, replay_state *r) {
+  const char *p = (const char *)map->data;
+  const char *end = p + map->size;
+  while (p < end && !r->failed) {
+    const char *newline = memchr(p, '\n', (size_t)(end - p));
+    const char *line_end = newline ? newline : end;
+
+    int64_t ms = -1;
+    float value;
+    if (*p == '{') {
+      if (log_parse_line(p, line_end, &ms, &value) == 0) {
+        replay_sample(ms, value, r);
+      }
+    } else if (log_parse_float(p, line_end, &value) != NULL) {
+      replay_sample(-1, value, r);
+    }
+    p = newline ? newline + 1 : end;
+  }
+}
+
+// Modo reproducción: envía las lecturas de un archivo proyectado en memoria.
+// Con speed 1 se respeta el ritmo de las marcas de tiempo del archivo, con N
+// se reproduce N veces más rápido y con 0 sin pausas. Las líneas sin marca de
+// tiempo se separan interval segundos. Con loop se repite el archivo hasta que
+// el monitor se cierre o se interrumpa el sensor.
+static int run_replay(int fd, int sensorType, const char *fileName, double speed,
+                      double interval, int loop) {
+  log_map map;
+  if (log_map_open(fileName, &map) == -1) {
+    fprintf(stderr, "Error opening the file: %s\n", fileName);
+    return -1;
+  }
+  printf("File mapped successfully (%zu bytes)\n", map.size);
+
+  int binary = log_is_binary(&map);
+  replay_state r = { .fd = fd, .sensorType = sensorType, .speed = speed,
+                     .interval_ns = (int64_t)(interval * 1e9) };
+  int64_t start_ns = proto_now_ns();
+  do {
+    long before = r.sent;
+    r.pass_ns = proto_now_ns();
+    r.ready_ns = r.pass_ns;
+    r.first_ms = -1;
+    r.offset_ns = 0;
+    if (binary) {
+      log_scan(&map, 1, 0, map.size, replay_sample, &r);
+    } else {
+      replay_text(&map, &r);
+    }
+
+    // Un archivo sin lecturas válidas no se repite en vacío
+    if (r.sent == before) {
+      break;
+    }
+  } while (loop && !r.failed);
+
+  if (!r.failed) {
+    flush_batch(fd);
+  }
+  log_map_close(&map);
+
+  print_summary("replayed", r.sent, start_ns);
+  return r.failed ? -1 : 0;
+}
+
+// Sensor virtual del modo de varios sensores
+typedef struct {
+  int sensorType;      // Tipo de sensor
+  uint32_t id;         // Instancia con la que se identifica ante el monitor
+  int64_t interval_ns; // Separación entre lecturas
+  int64_t due_ns;      // Instante (CLOCK_MONOTONIC) de la próxima lectura
+  char *path;          // Archivo de datos
+  log_map map;         // Archivo de datos proyectado (compartido si se repite)
+  int owns_map;        // 1 si este sensor libera la proyección
+  size_t offset;       // Próxima línea del archivo
+  long sent;           // Lecturas enviadas
+  long pass_sent;      // Lecturas enviadas en la pasada actual del archivo
+} virtual_sensor;
+
+// Devuelve en *value la próxima lectura válida del archivo del sensor ("valor" o
+// "{fecha} valor"; las negativas se omiten). Con loop vuelve al principio al
+// terminar. Devuelve 0 o -1 si no quedan lecturas.
+static int next_value(virtual_sensor *vs, int loop, float *value) {
+  const char *data = (const char *)vs->map.data;
+  for (;;) {
+    if (vs->offset >= vs->map.size) {
+      // Un archivo sin lecturas válidas no se repite en vacío
+      if (!loop || vs->pass_sent == 0) {
+        return -1;
+      }
+      vs->offset = 0;
+      vs->pass_sent = 0;
+    }
+
+    const char *p = data + vs->offset;
+    const char *end = data + vs->map.size;
+    const char *newline = memchr(p, '\n', (size_t)(end - p));
+    const char *line_end = newline ? newline : end;
+    vs->offset = (size_t)(line_end - data) + 1;
+
+    int64_t ms;
+    int ok = *p == '{' ? log_parse_line(p, line_end, &ms, value) == 0 : log_parse_float(p, line_end, value) != NULL;
+    if (ok && *value >= 0) {
+      vs->pass_sent++;
+      return 0;
+    }
+  }
+}
+
+// Montículo mínimo de sensores ordenado por el instante de su próxima lectura.
+// Hunde el elemento i hasta su posición.
+static void heap_down(virtual_sensor **heap, int n, int i) {
+  for (;;) {
+    int smallest = i, left = 2 * i + 1, right = left + 1;
+    if (left < n && heap[left]->due_ns < heap[smallest]->due_ns) {
+      smallest = left;
+    }
+    if (right < n && heap[right]->due_ns < heap[smallest]->due_ns) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      return;
+    }
+    virtual_sensor *t = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = t;
+    i = smallest;
+  }
+}
+
+// Libera los sensores virtuales y las proyecciones de sus archivos.
+static void free_sensors(virtual_sensor *sensors, int count) {
+  for (int i = 0; i < count; i++) {
+    if (sensors[i].owns_map) {
+      log_map_close(&sensors[i].map);
+    }
+    free(sensors[i].path);
+  }
+  free(sensors);
+}
+
+// Lee el manifiesto de sensores: una línea "<tipo> <archivo> <intervalo-s> [instancia]"
+// por sensor ('#' inicia un comentario). Devuelve la cantidad o -1 si hay un error.
+static int load_sensors(const char *path, virtual_sensor **out) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Error opening the sensor manifest: %s\n", path);
+    return -1;
+  }
+
+  virtual_sensor *sensors = NULL;
+  int count = 0, capacity = 0, line_number = 0, failed = 0;
+  char line[1024];
+  while (!failed && fgets(line, sizeof(line), f) != NULL) {
+    line_number++;
+    char *hash = strchr(line, '#');
+    if (hash) {
+      *hash = '\0';
+    }
+    int type;
+    char file[1024];
+    double interval;
+    unsigned int id = 0;
+    int fields = sscanf(line, "%d %1023s %lf %u", &type, file, &interval, &id);
+    if (fields <= 0) {
+      continue; // Línea vacía o comentario
+    }
+    if (fields < 3 || type <= 0 || interval <= 0) {
+      fprintf(stderr, "Error: Invalid sensor at %s:%d (type file interval [instance]).\n", path, line_number);
+      failed = 1;
+      break;
+    }
+
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      virtual_sensor *grown = realloc(sensors, (size_t)capacity * sizeof(virtual_sensor));
+      if (!grown) {
+        perror("Error allocating memory for the sensors");
+        failed = 1;
+        break;
+      }
+      sensors = grown;
+    }
+
+    // Los sensores sin instancia propia se numeran a partir de la de -i o
+    // dentro del bloque del proceso, que tiene lugar para 2^INSTANCE_INDEX_BITS.
+    if (fields < 4 && !instance_given && count >= 1 << INSTANCE_INDEX_BITS) {
+      fprintf(stderr, "Error: More than %d sensors without an instance at %s:%d; give them one or use -i.\n",
+              1 << INSTANCE_INDEX_BITS, path, line_number);
+      failed = 1;
+      break;
+    }
+    virtual_sensor *vs = &sensors[count];
+    memset(vs, 0, sizeof(*vs));
+    vs->sensorType = type;
+    vs->id = fields == 4 ? id : instance + (uint32_t)count;
+    vs->interval_ns = interval * 1e9 >= 1 ? (int64_t)(interval * 1e9) : 1;
+    vs->path = strdup(file);
+    count++;
+
+    // Varios sensores pueden reproducir el mismo archivo: se proyecta una sola vez
+    for (int i = 0; i < count - 1; i++) {
+      if (sensors[i].owns_map && strcmp(sensors[i].path, file) == 0) {
+        vs->map = sensors[i].map;
+        break;
+      }
+    }
+    if (vs->map.data == NULL) {
+      if (!vs->path || log_map_open(file, &vs->map) == -1) {
+        fprintf(stderr, "Error opening the file: %s\n", file);
+        failed = 1;
+      }
+      vs->owns_map = !failed;
+    }
+  }
+  fclose(f);
+
+  if (failed) {
+    free_sensors(sensors, count);
+    return -1;
+  }
+  *out = sensors;
+  return count;
+}
+
+// Modo de varios sensores: un solo proceso simula todos los sensores del
+// manifiesto. Un montículo ordena los sensores por el instante de su próxima
+// lectura y un timerfd despierta al proceso en el más próximo; las lecturas
+// que vencen dentro de SCHED_SLACK_NS salen en un mismo write() (hasta PIPE_BUF bytes). Cada
+// sensor mantiene su propio ritmo sin deriva (el siguiente instante se suma al
+// programado, no al real) y las fases se reparten para que no coincidan todos.
+static int run_sensors(int fd, const char *manifestName, int loop) {
+  virtual_sensor *sensors;
+  int count = load_sensors(manifestName, &sensors);
+  if (count <= 0) {
+    if (count == 0) {
+      fprintf(stderr, "Error: The sensor manifest %s has no sensors.\n", manifestName);
+    }
+    return -1;
+  }
+
+  virtual_sensor **heap = malloc((size_t)count * sizeof(virtual_sensor *));
+  int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (!heap || timer == -1) {
+    perror("Error creating the sensor scheduler");
+    free(heap);
+    free_sensors(sensors, count);
+    return -1;
+  }
+  printf("Virtual sensors: %d\n", count);
+
+  // Fase inicial de cada sensor y armado del montículo
+  int64_t start_ns = proto_now_ns();
+  for (int i = 0; i < count; i++) {
+    sensors[i].due_ns = start_ns + sensors[i].interval_ns * i / count;
+    heap[i] = &sensors[i];
+  }
+  for (int i = count / 2 - 1; i >= 0; i--) {
+    heap_down(heap, count, i);
+  }
+
+  int alive = count, failed = 0;
+  long sent = 0;
+  while (alive > 0 && !failed) {
+    // Dormir hasta la lectura más próxima (si todavía no venció)
+    int64_t now_ns = proto_now_ns();
+    if (heap[0]->due_ns > now_ns) {
+      struct itimerspec at = { { 0, 0 }, { heap[0]->due_ns / 1000000000, heap[0]->due_ns % 1000000000 } };
+      uint64_t expirations;
+      if (timerfd_settime(timer, TFD_TIMER_ABSTIME, &at, NULL) == -1) {
+        perror("Error arming the sensor timer");
+        failed = 1;
+        break;
+      }
+      while (read(timer, &expirations, sizeof(expirations)) == -1 && errno == EINTR) {
+      }
+      now_ns = proto_now_ns();
+    }
+
+    // Enviar todas las lecturas vencidas (o por vencer dentro de la holgura); si el
+    // proceso se atrasó, cada sensor recupera las lecturas que le faltan en lugar de perderlas.
+    while (alive > 0 && heap[0]->due_ns <= now_ns + SCHED_SLACK_NS) {
+      virtual_sensor *vs = heap[0];
+      float value;
+      if (next_value(vs, loop, &value) == -1) {
+        heap[0] = heap[--alive];
+      } else {
+        if (send_sample(fd, vs->sensorType, vs->id, value, now_ns) == -1) {
+          failed = 1;
+          break;
+        }
+        vs->sent++;
+        sent++;
+        vs->due_ns += vs->interval_ns;
+      }
+      heap_down(heap, alive, 0);
+    }
+
+    if (!failed && flush_batch(fd) == -1) {
+      failed = 1;
+    }
+  }
+
+  close(timer);
+  free(heap);
+  free_sensors(sensors, count);
+  print_summary("sent", sent, start_ns);
+  return failed ? -1 : 0;
+}
+
 int main(int argc, char *argv[]) {
   int flags; // Almacena las flags de los argumentos de línea de comandos
   char *sensorType = NULL;   // Puntero al tipo de sensor
   char *timeInterval = NULL; // Puntero al intervalo de tiempo
   char *fileName = NULL;     // Puntero al nombre del archivo de datos
   char *pipeName = NULL;     // Puntero al nombre del pipe nominal
+  double rate = -1;          // Lecturas por segundo en modo generador de carga (-1 = modo normal)
+  long count = 0;            // Lecturas a enviar en modo generador de carga (0 = sin límite)
+  float low = 20, high = 30; // Rango de los valores sintéticos
+  int use_shm = 0;           // 1 para enviar por memoria compartida (-m shm)
+  double speed = -1;         // Velocidad de reproducción del archivo (-1 = modo normal)
+  int loop = 0;              // 1 para repetir la reproducción sin fin
+  char *manifestName = NULL; // Manifiesto de sensores virtuales (modo de varios sensores)
+  long resend = 0;           // Lecturas guardadas para reenviar al reconectarse (0 = sin reenvío)
+  instance = (uint32_t)getpid() << INSTANCE_INDEX_BITS; // Por omisión, el bloque de instancias del proceso
 
   // Maneja de banderas mediante argumentos de línea de comandos
-  while ((flags = getopt(argc, argv, "s:t:f:p:")) != -1) {
+  while ((flags = getopt(argc, argv, "s:t:f:p:r:n:g:m:x:li:M:b:")) != -1) {
     switch (flags) {
     case 's': // Bandera de sensor
       sensorType = argv[optind - 1];
@@ -34,28 +666,77 @@ int main(int argc, char *argv[]) {
     case 'p': // Bandera del nombre del pipe
       pipeName = argv[optind - 1];
       break;
+    case 'r': // Bandera de la tasa del generador de carga (lecturas/s, 0 = sin pausa)
+      rate = atof(optarg);
+      break;
+    case 'n': // Bandera de la cantidad de lecturas del generador de carga
+      count = atol(optarg);
+      break;
+    case 'g': // Bandera del rango de valores sintéticos "min:max"
+      if (sscanf(optarg, "%f:%f", &low, &high) != 2 || low > high) {
+        fprintf(stderr, "Error: Invalid synthetic range '%s' (min:max).\n", optarg);
+        return 1;
+      }
+      break;
+    case 'm': // Bandera del transporte hacia el monitor (pipe | shm)
+      if (strcmp(optarg, "shm") == 0) {
+        use_shm = 1;
+      } else if (strcmp(optarg, "pipe") != 0) {
+        fprintf(stderr, "Error: Unknown transport '%s' (pipe | shm).\n", optarg);
+        return 1;
+      }
+      break;
+    case 'x': // Bandera de la velocidad de reproducción (1 = tiempo real, N = N veces, 0 = sin pausas)
+      speed = atof(optarg);
+      if (speed < 0) {
+        fprintf(stderr, "Error: Invalid replay speed '%s'.\n", optarg);
+        return 1;
+      }
+      break;
+    case 'l': // Bandera para repetir la reproducción
+      loop = 1;
+      break;
+    case 'i': // Bandera del identificador de la instancia del sensor
+      instance = (uint32_t)strtoul(optarg, NULL, 10);
+      instance_given = 1;
+      break;
+    case 'M': // Bandera del manifiesto de sensores virtuales ("tipo archivo intervalo [instancia]")
+      manifestName = optarg;
+      break;
+    case 'b': // Bandera de lecturas guardadas para reenviar si el monitor se reinicia
+      resend = atol(optarg);
+      if (resend <= 0) {
+        fprintf(stderr, "Error: Invalid resend buffer '%s' (samples).\n", optarg);
+        return 1;
+      }
+      break;
     default: // Mensaje de uso en caso de argumentos incorrectos
       fprintf(
           stderr,
-          "Usage: %s -s sensorType -t timeInterval -f fileName -p pipeName\n",
-          argv[0]);
+          "Usage: %s -s sensorType -t timeInterval -f fileName -p pipeName [-m pipe|shm]\n"
+          "       %s -s sensorType -f fileName -x speed [-t interval] [-l] -p pipeName [-m pipe|shm] [-i instance] "
+          "[-b resend-samples]\n"
+          "       %s -s sensorType -r rate [-n count] [-g min:max] -p pipeName [-m pipe|shm] [-i instance] "
+          "[-b resend-samples]\n"
+          "       %s -M sensorManifest [-l] -p pipeName [-m pipe|shm] [-i first-instance] [-b resend-samples]\n",
+          argv[0], argv[0], argv[0], argv[0]);
       return 1;
     }
   }
 
   // Conversión de cadenas de 'sensorType' y 'timeInterval' a enteros
-  int sensorTypeInt = atoi(sensorType);
-  int timeIntervalInt = atoi(timeInterval);
+  int sensorTypeInt = sensorType ? atoi(sensorType) : 0;
+  int timeIntervalInt = timeInterval ? atoi(timeInterval) : 0;
 
-  // Verificación de la validez del tipo de sensor
-  if (sensorTypeInt != 1 && sensorTypeInt != 2) {
+  // Verificación de la validez del tipo de sensor (en el manifiesto cada sensor trae el suyo)
+  if (sensorTypeInt <= 0 && !manifestName) {
     fprintf(stderr,
-            "Error: Invalid sensor type. Sensor type must be 1 or 2.\n");
+            "Error: Invalid sensor type. Sensor type must be a positive id.\n");
     return 1;
   }
 
-  // Apertura del pipe nominal en modo escritura
-  int pipeNominal = open(pipeName, O_WRONLY);
+  // Apertura del pipe nominal (o conexión al socket del monitor) en modo escritura
+  int pipeNominal = proto_connect(pipeName);
   if (pipeNominal == -1) {
     perror("Error opening the pipe");
     exit(1);
@@ -63,6 +744,69 @@ int main(int argc, char *argv[]) {
     printf("Pipe opened successfully: %s\n", pipeName);
   }
 
+  // Si el monitor se cierra, write() devuelve un error en lugar de terminar el proceso
+  signal(SIGPIPE, SIG_IGN);
+
+  // Buffer de reenvío (sólo en los modos que marcan el instante de envío: -r, -x y -M)
+  monitor_path = pipeName;
+  if (resend > 0) {
+    history = malloc((size_t)resend * sizeof(sent_record));
+    if (!history) {
+      perror("Error allocating the resend buffer");
+      close(pipeNominal);
+      return 1;
+    }
+    history_cap = (size_t)resend;
+    sender = (uint32_t)getpid();
+  }
+
+  // Con -m shm el socket del monitor sólo sirve para entregarle el buffer compartido
+  shm_producer producer;
+  if (use_shm) {
+    struct stat st;
+    if (fstat(pipeNominal, &st) == -1 || !S_ISSOCK(st.st_mode)) {
+      fprintf(stderr, "Error: Shared memory mode needs the monitor socket (-u), not a pipe.\n");
+      close(pipeNominal);
+      return 1;
+    }
+    if (shm_producer_open(&producer, pipeNominal) == -1) {
+      close(pipeNominal);
+      return 1;
+    }
+    shm = &producer;
+  }
+
+  // Modo de varios sensores: todos los del manifiesto desde este proceso
+  if (manifestName) {
+    int result = run_sensors(pipeNominal, manifestName, loop);
+    if (shm) {
+      shm_producer_close(shm);
+    }
+    close(pipeNominal);
+    return result == 0 ? 0 : 1;
+  }
+
+  // Modo generador de carga: lecturas sintéticas sin archivo de datos
+  if (rate >= 0) {
+    int result = run_load_generator(pipeNominal, sensorTypeInt, rate, count, low, high);
+    if (shm) {
+      shm_producer_close(shm);
+    }
+    close(pipeNominal);
+    return result == 0 ? 0 : 1;
+  }
+
+  // Modo reproducción: archivo proyectado en memoria con ritmo controlado
+  if (speed >= 0) {
+    int result = run_replay(pipeNominal, sensorTypeInt, fileName, speed,
+                            timeInterval ? atof(timeInterval) : 1, loop);
+    if (shm) {
+      shm_producer_close(shm);
+    }
+    close(pipeNominal);
+    return result == 0 ? 0 : 1;
+  }
+
   // Apertura del archivo de datos en modo lectura
   FILE *fileData = fopen(fileName, "r");
   if (!fileData) {
@@ -76,26 +820,33 @@ int main(int argc, char *argv[]) {
   // Lectura y envío de datos al pipe nominal
   char line[1024];
   while (fgets(line, sizeof(line), fileData)) {
-    float valData = atof(line);
+    float valData = 0; // Una línea que no es un número se envía como 0, igual que con atof
+    log_parse_float(line, line + strlen(line), &valData);
 
     // Se omite si el valor es negativo
     if (valData < 0) {
       continue;
     }
 
-    char buffer[1024];
-    snprintf(buffer, sizeof(buffer), "%d:%.2f\n", sensorTypeInt, valData);
+    char buffer[PROTO_MAX_RECORD];
+    int length = proto_format(buffer, sizeof(buffer), sensorTypeInt, valData);
 
     // Se imprime el tipo de sensor y el valor leído
     if (sensorTypeInt == 1) {
       printf("Sensor sends temperature: %.2f\n", valData);
     } else if (sensorTypeInt == 2) {
       printf("Sensor sends pH: %.2f\n", valData);
+    } else {
+      printf("Sensor sends type %d: %.2f\n", sensorTypeInt, valData);
     }
 
-    // Escritura en el pipe nominal
-    ssize_t bytes_written = write(pipeNominal, buffer, strlen(buffer));
-    if (bytes_written == -1) {
+    // Escritura en el pipe nominal (o en el buffer compartido con el monitor)
+    if (shm) {
+      if (shm_producer_push(shm, sensorTypeInt, 0, valData, 0, 0) == -1) {
+        fprintf(stderr, "Error: The monitor closed the shared memory transport.\n");
+        break;
+      }
+    } else if (write(pipeNominal, buffer, length) == -1) {
       perror("Error writing to the pipe");
       break;
     }
@@ -105,6 +856,9 @@ int main(int argc, char *argv[]) {
   }
 
   // Cierre del archivo y el pipe
+  if (shm) {
+    shm_producer_close(shm);
+  }
   fclose(fileData);
   close(pipeNominal);
 
@@ -0,0 +1,280 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del transporte por memoria compartida entre sensor y monitor
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "shmring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_WAIT_MS 100 // Espera máxima del sensor antes de comprobar si el monitor sigue vivo
+#define SHM_CHECK_MS 100 // Cada cuánto el sensor comprueba si el monitor sigue vivo aunque haya espacio
+
+// Tamaño del segmento para una capacidad dada.
+static size_t segment_size(uint64_t capacity) {
+    return sizeof(shm_ring) + capacity * sizeof(shm_sample);
+}
+
+// Milisegundos del reloj monotónico de baja resolución (no hace falta más
+// precisión para el plazo de comprobación y es mucho más barato de leer).
+static int64_t coarse_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Envía el mensaje de saludo con los dos descriptores al monitor.
+static int send_handshake(int sock_fd, int shm_fd, int event_fd) {
+    char text[] = SHM_HANDSHAKE;
+    struct iovec iov = { text, sizeof(text) - 1 };
+    union {
+        struct cmsghdr header;
+        char space[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.space;
+    msg.msg_controllen = sizeof(control.space);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    int fds[2] = { shm_fd, event_fd };
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t n;
+    do {
+        n = sendmsg(sock_fd, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    return n == (ssize_t)iov.iov_len ? 0 : -1;
+}
+
+// Crea el segmento y el eventfd, y los pasa al monitor por el socket.
+// El nombre del segmento se borra enseguida: sólo lo conservan los dos mapeos.
+int shm_producer_open(shm_producer *p, int sock_fd) {
+    memset(p, 0, sizeof(*p));
+    p->sock_fd = sock_fd;
+    p->event_fd = -1;
+
+    char name[64];
+    snprintf(name, sizeof(name), "/sensor-%d-%ld", (int)getpid(), (long)time(NULL));
+    int shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (shm_fd == -1) {
+        perror("Error creating the shared memory segment");
+        return -1;
+    }
+    shm_unlink(name);
+
+    p->map_size = segment_size(SHM_RING_CAPACITY);
+    if (ftruncate(shm_fd, (off_t)p->map_size) == -1) {
+        perror("Error sizing the shared memory segment");
+        close(shm_fd);
+        return -1;
+    }
+    p->ring = mmap(NULL, p->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (p->ring == MAP_FAILED) {
+        perror("Error mapping the shared memory segment");
+        close(shm_fd);
+        p->ring = NULL;
+        return -1;
+    }
+
+    // ftruncate deja el segmento en ceros: índices en 0 y sin esperas.
+    p->ring->magic = SHM_RING_MAGIC;
+    p->ring->version = SHM_RING_VERSION;
+    p->ring->capacity = SHM_RING_CAPACITY;
+    p->checked_ms = coarse_ms();
+
+    p->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (p->event_fd == -1 || send_handshake(sock_fd, shm_fd, p->event_fd) == -1) {
+        perror("Error handing the shared memory segment to the monitor");
+        close(shm_fd);
+        shm_producer_close(p);
+        return -1;
+    }
+    close(shm_fd);
+    return 0;
+}
+
+// Duerme (futex compartido entre procesos) mientras *word valga expected.
+static void futex_wait_shared(atomic_int *word, int expected, int timeout_ms) {
+    struct timespec timeout = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, &timeout, NULL, 0);
+}
+
+// Despierta al monitor si anunció que va a dormir.
+static void wake_consumer(shm_producer *p) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&p->ring->consumer_idle, memory_order_relaxed) &&
+        atomic_exchange_explicit(&p->ring->consumer_idle, 0, memory_order_relaxed)) {
+        uint64_t one = 1;
+        if (write(p->event_fd, &one, sizeof(one)) == -1) {
+            // Sólo falla si el contador se desborda; el monitor ya tiene un aviso pendiente.
+        }
+    }
+}
+
+// 1 si el monitor cerró su extremo del socket.
+static int monitor_gone(shm_producer *p) {
+    struct pollfd pfd = { .fd = p->sock_fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR));
+}
+
+// Encola una muestra. Si el buffer está lleno el sensor duerme hasta que el
+// monitor libere espacio. Con poca carga el buffer nunca se llena, así que
+// además se comprueba cada SHM_CHECK_MS que el monitor siga vivo: si murió,
+// el sensor no sigue escribiendo en un segmento que nadie lee. Devuelve 0 o
+// -1 si el monitor se desconectó (la muestra no se encoló).
+int shm_producer_push(shm_producer *p, int sensor_type, uint32_t instance, float value, int64_t sent_ns,
+                      uint32_t sender) {
+    shm_ring *ring = p->ring;
+
+    int64_t now_ms = coarse_ms();
+    if (now_ms - p->checked_ms >= SHM_CHECK_MS) {
+        p->checked_ms = now_ms;
+        if (monitor_gone(p)) {
+            return -1;
+        }
+    }
+
+    while (p->head - p->cached_tail == ring->capacity) {
+        p->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (p->head - p->cached_tail < ring->capacity) {
+            break;
+        }
+
+        // Anunciar que se va a dormir y volver a comprobar antes de hacerlo.
+        atomic_store_explicit(&ring->producer_waiting, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        p->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (p->head - p->cached_tail < ring->capacity) {
+            atomic_store_explicit(&ring->producer_waiting, 0, memory_order_relaxed);
+            break;
+        }
+        futex_wait_shared(&ring->producer_waiting, 1, SHM_WAIT_MS);
+        if (monitor_gone(p)) {
+            return -1;
+        }
+    }
+
+    shm_sample *slot = &ring->slots[p->head & (ring->capacity - 1)];
+    slot->sensor_type = sensor_type;
+    slot->value = value;
+    slot->sent_ns = sent_ns;
+    slot->instance = instance;
+    slot->sender = sender;
+    p->head++;
+    atomic_store_explicit(&ring->head, p->head, memory_order_release);
+
+    wake_consumer(p);
+    return 0;
+}
+
+// Marca el fin de las muestras, despierta al monitor y libera el extremo del sensor.
+void shm_producer_close(shm_producer *p) {
+    if (p->ring) {
+        // Un último aviso para que el monitor lea lo que quede antes de notar el cierre del socket.
+        atomic_store_explicit(&p->ring->consumer_idle, 1, memory_order_relaxed);
+        if (p->event_fd != -1) {
+            wake_consumer(p);
+        }
+        munmap(p->ring, p->map_size);
+        p->ring = NULL;
+    }
+    if (p->event_fd != -1) {
+        close(p->event_fd);
+        p->event_fd = -1;
+    }
+}
+
+// Mapea el segmento recibido y comprueba que el encabezado sea válido.
+// El segmento viene de otro proceso, por eso se valida su tamaño antes de usarlo.
+int shm_consumer_attach(shm_consumer *c, int shm_fd) {
+    struct stat st;
+    if (fstat(shm_fd, &st) == -1 || (size_t)st.st_size < sizeof(shm_ring)) {
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    shm_ring *ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (ring == MAP_FAILED) {
+        return -1;
+    }
+
+    uint64_t capacity = ring->capacity;
+    if (ring->magic != SHM_RING_MAGIC || ring->version != SHM_RING_VERSION || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0 || capacity > (size - sizeof(shm_ring)) / sizeof(shm_sample)) {
+        munmap(ring, size);
+        return -1;
+    }
+
+    c->ring = ring;
+    c->map_size = size;
+    c->mask = capacity - 1;
+    c->tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return 0;
+}
+
+// Desencola una muestra sin esperar. Devuelve 1 si obtuvo una, 0 si el buffer
+// está vacío o -1 si el índice head del segmento es inválido.
+int shm_consumer_pop(shm_consumer *c, shm_sample *item) {
+    uint64_t head = atomic_load_explicit(&c->ring->head, memory_order_acquire);
+    if (head == c->tail) {
+        return 0;
+    }
+    if (head - c->tail > c->mask + 1) {
+        return -1;
+    }
+
+    *item = c->ring->slots[c->tail & c->mask];
+    c->tail++;
+    atomic_store_explicit(&c->ring->tail, c->tail, memory_order_release);
+    return 1;
+}
+
+// Anuncia que el monitor vació el buffer y esperará el eventfd. Devuelve 1
+// si sigue vacío o 0 si llegó una muestra entre medio (hay que seguir leyendo).
+int shm_consumer_idle(shm_consumer *c) {
+    atomic_store_explicit(&c->ring->consumer_idle, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&c->ring->head, memory_order_acquire) != c->tail) {
+        atomic_store_explicit(&c->ring->consumer_idle, 0, memory_order_relaxed);
+        return 0;
+    }
+    return 1;
+}
+
+// Despierta al sensor si duerme esperando espacio.
+void shm_consumer_wake_producer(shm_consumer *c) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&c->ring->producer_waiting, memory_order_relaxed)) {
+        atomic_store_explicit(&c->ring->producer_waiting, 0, memory_order_relaxed);
+        syscall(SYS_futex, &c->ring->producer_waiting, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// Desmapea el segmento.
+void shm_consumer_detach(shm_consumer *c) {
+    munmap(c->ring, c->map_size);
+    c->ring = NULL;
+}
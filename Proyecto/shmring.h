@@ -0,0 +1,89 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del transporte por memoria compartida entre sensor y monitor
+**************************************************************/
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Con "-m shm" el sensor no escribe registros de texto en el pipe: crea un
+// segmento de memoria compartida (shm_open + mmap) con un buffer circular de
+// muestras binarias y se lo pasa al monitor por su socket Unix, junto con un
+// eventfd, en un solo mensaje con SCM_RIGHTS:
+//   sensor -> monitor: "shm\n" + [descriptor del segmento, eventfd]
+// Después el socket sólo sirve para que el monitor note la desconexión.
+//
+// Despertares: el sensor escribe el eventfd sólo si el monitor anunció que
+// vació el buffer y va a dormir; el monitor despierta al sensor (futex
+// compartido entre procesos) sólo si el sensor duerme con el buffer lleno.
+
+#define SHM_RING_MAGIC 0x53484d52u // "SHMR"
+#define SHM_RING_VERSION 3         // Versión del formato del segmento
+#define SHM_RING_CAPACITY 65536    // Muestras del buffer que crea el sensor (1.5 MiB)
+#define SHM_HANDSHAKE "shm\n"      // Mensaje que acompaña a los descriptores
+
+// Muestra tal como viaja por la memoria compartida
+typedef struct {
+    int32_t sensor_type; // Tipo de sensor
+    float value;         // Valor medido
+    int64_t sent_ns;     // Instante de envío (CLOCK_MONOTONIC en ns, 0 si no se conoce)
+    uint32_t instance;   // Instancia del sensor (0 = la de la conexión)
+    uint32_t sender;     // PID del sensor si reenvía sus lecturas al reconectarse (0 si no)
+} shm_sample;
+
+// Encabezado del segmento, seguido de capacity muestras
+typedef struct {
+    uint32_t magic;    // SHM_RING_MAGIC
+    uint32_t version;  // SHM_RING_VERSION
+    uint64_t capacity; // Capacidad (potencia de 2)
+
+    // Datos del productor (sensor)
+    _Alignas(64) atomic_uint_least64_t head; // Próxima posición a escribir
+    atomic_int producer_waiting;             // 1 si el sensor duerme con el buffer lleno (futex)
+
+    // Datos del consumidor (monitor)
+    _Alignas(64) atomic_uint_least64_t tail; // Próxima posición a leer
+    atomic_int consumer_idle;                // 1 si el monitor vació el buffer y espera el eventfd
+
+    _Alignas(64) shm_sample slots[];         // Arreglo contiguo de muestras
+} shm_ring;
+
+// Extremo del sensor
+typedef struct {
+    shm_ring *ring;  // Segmento mapeado
+    size_t map_size; // Tamaño del mapeo
+    int event_fd;    // eventfd que despierta al monitor
+    int sock_fd;     // Socket del monitor (para notar si se cerró)
+    uint64_t head;   // Copia local de head
+    uint64_t cached_tail; // Última copia de tail vista
+    int64_t checked_ms;   // Última vez que se comprobó que el monitor sigue vivo
+} shm_producer;
+
+// Extremo del monitor. La capacidad y tail se guardan fuera del segmento
+// porque el sensor podría modificarlos (o dañarlos) después de validarlos.
+typedef struct {
+    shm_ring *ring;  // Segmento mapeado
+    size_t map_size; // Tamaño del mapeo
+    uint64_t mask;   // Capacidad - 1
+    uint64_t tail;   // Próxima posición a leer
+} shm_consumer;
+
+// Prototipos de funciones
+int shm_producer_open(shm_producer *p, int sock_fd); // Crea el segmento y lo pasa al monitor
+int shm_producer_push(shm_producer *p, int sensor_type, uint32_t instance, float value, int64_t sent_ns,
+                      uint32_t sender); // Encola (espera si está lleno)
+void shm_producer_close(shm_producer *p);            // Marca el fin, despierta al monitor y libera
+int shm_consumer_attach(shm_consumer *c, int shm_fd); // Mapea y valida el segmento recibido
+int shm_consumer_pop(shm_consumer *c, shm_sample *item); // Desencola sin esperar; 0 si vacío, -1 si dañado
+int shm_consumer_idle(shm_consumer *c);              // Anuncia que el monitor va a dormir; 0 si llegó algo
+void shm_consumer_wake_producer(shm_consumer *c);    // Despierta al sensor si espera espacio
+void shm_consumer_detach(shm_consumer *c);           // Desmapea el segmento
+
+#endif // SHMRING_H
@@ -0,0 +1,491 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de la tabla del último valor de cada sensor
+**************************************************************/
+
+#define _GNU_SOURCE
+#include "snapshot.h"
+#include "detect.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SNAPSHOT_CLIENTS 32    // Conexiones de consulta abiertas a la vez
+#define SNAPSHOT_REQUEST_LEN 128 // Longitud máxima de una petición
+#define SNAPSHOT_SPINS 64      // Reintentos de lectura antes de ceder el procesador
+
+// Tabla del monitor (NULL si no se publica)
+snapshot_table *snapshot_shared = NULL;
+
+static size_t shared_size;          // Tamaño del mapeo de la tabla
+static const char *shared_name;     // Nombre del segmento (NULL si es memoria anónima)
+static pthread_t serve_thread;      // Hilo que atiende el socket de consultas
+static int serve_running = 0;       // 1 si el hilo está activo
+static int listen_fd = -1;          // Socket Unix de consultas
+static int stop_fd = -1;            // eventfd que despierta al hilo para terminar
+
+// Conexión de consulta con su petición a medio recibir
+typedef struct {
+    int fd;                            // Descriptor (-1 = libre)
+    char request[SNAPSHOT_REQUEST_LEN]; // Bytes recibidos de la petición en curso
+    size_t len;                        // Bytes en request
+} snapshot_client;
+
+// Posición inicial de la búsqueda de una clave (hash multiplicativo).
+static uint32_t key_hash(uint64_t key, uint32_t capacity) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+}
+
+// Clave de un sensor; nunca es 0 porque los tipos empiezan en 1.
+static uint64_t sensor_key(int type, uint32_t instance) {
+    return ((uint64_t)(uint32_t)type << 32) | instance;
+}
+
+// Crea la tabla del monitor. Con nombre, en un segmento de memoria compartida
+// que otros procesos pueden mapear sólo para lectura; sin nombre, en memoria anónima.
+int snapshot_create(const char *shm_name) {
+    shared_size = sizeof(snapshot_table) + (size_t)SNAPSHOT_CAPACITY * sizeof(snapshot_slot);
+
+    void *map;
+    if (shm_name) {
+        // Un segmento que quedó de una ejecución anterior se reemplaza.
+        shm_unlink(shm_name);
+        int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            perror("Error creating the snapshot segment");
+            return -1;
+        }
+        if (ftruncate(fd, (off_t)shared_size) == -1) {
+            perror("Error sizing the snapshot segment");
+            close(fd);
+            shm_unlink(shm_name);
+            return -1;
+        }
+        map = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        shared_name = shm_name;
+    } else {
+        map = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (map == MAP_FAILED) {
+        perror("Error mapping the snapshot table");
+        if (shm_name) {
+            shm_unlink(shm_name);
+        }
+        return -1;
+    }
+
+    // ftruncate y MAP_ANONYMOUS dejan la tabla en ceros: todas las posiciones libres.
+    snapshot_table *t = map;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    t->capacity = SNAPSHOT_CAPACITY;
+    t->slot_size = sizeof(snapshot_slot);
+    t->started_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    t->pid = (int32_t)getpid();
+    t->version = SNAPSHOT_VERSION;
+    atomic_thread_fence(memory_order_release);
+    t->magic = SNAPSHOT_MAGIC; // Al final: un lector que lo ve encuentra el encabezado completo
+
+    snapshot_shared = t;
+    if (shm_name) {
+        printf("Publishing latest values in shared memory: '%s'\n", shm_name);
+    }
+    return 0;
+}
+
+// Registra el nombre de un tipo de sensor (antes de que empiecen los consumidores).
+int snapshot_set_name(int type, const char *name) {
+    if (!snapshot_shared || type <= 0 || type >= SNAPSHOT_TYPES) {
+        return -1;
+    }
+    snprintf(snapshot_shared->names[type], SNAPSHOT_NAME_LEN, "%s", name);
+    return 0;
+}
+
+// Posición del sensor, que se da de alta si es nuevo. Sólo la llama el
+// consumidor de la parte que atiende al sensor. Devuelve NULL si la tabla está llena.
+snapshot_slot *snapshot_claim(snapshot_table *t, int type, uint32_t instance) {
+    uint64_t key = sensor_key(type, instance);
+    uint32_t mask = t->capacity - 1;
+    uint32_t i = key_hash(key, t->capacity);
+    for (uint32_t probe = 0; probe < t->capacity; probe++, i = (i + 1) & mask) {
+        snapshot_slot *s = &t->slots[i];
+        uint64_t current = atomic_load_explicit(&s->key, memory_order_acquire);
+        if (current == key) {
+            return s;
+        }
+        if (current != 0) {
+            continue;
+        }
+
+        // Posición libre: otra parte puede ganarla con la clave de otro sensor.
+        if (atomic_compare_exchange_strong_explicit(&s->key, &current, key, memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            atomic_fetch_add_explicit(&t->used, 1, memory_order_relaxed);
+            return s;
+        }
+        if (current == key) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Escribe la lectura en la posición (único escritor): seq impar, datos, seq par.
+void snapshot_publish(snapshot_slot *s, float value, int64_t when_ms, uint32_t alarms) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&s->value, bits, memory_order_relaxed);
+    atomic_store_explicit(&s->alarms, alarms, memory_order_relaxed);
+    atomic_store_explicit(&s->when_ms, when_ms, memory_order_relaxed);
+    atomic_store_explicit(&s->count, atomic_load_explicit(&s->count, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+
+    atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+}
+
+// Busca la posición de un sensor sin darlo de alta. Como nunca se borran
+// posiciones, la búsqueda termina en la primera libre.
+const snapshot_slot *snapshot_find(const snapshot_table *t, int type, uint32_t instance) {
+    uint64_t key = sensor_key(type, instance);
+    uint32_t mask = t->capacity - 1;
+    uint32_t i = key_hash(key, t->capacity);
+    for (uint32_t probe = 0; probe < t->capacity; probe++, i = (i + 1) & mask) {
+        uint64_t current = atomic_load_explicit(&t->slots[i].key, memory_order_acquire);
+        if (current == key) {
+            return &t->slots[i];
+        }
+        if (current == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Copia la posición sin bloquear al consumidor: si seq era impar o cambió
+// durante la copia, el consumidor escribió a la vez y se vuelve a leer.
+// Devuelve 0, o -1 si la posición está libre o todavía no tiene lecturas.
+int snapshot_read(const snapshot_slot *s, snapshot_value *out) {
+    uint64_t key = atomic_load_explicit(&s->key, memory_order_acquire);
+    if (key == 0) {
+        return -1;
+    }
+
+    for (int spins = 0;; spins++) {
+        if (spins >= SNAPSHOT_SPINS) {
+            sched_yield(); // El consumidor perdió el procesador a mitad de la escritura
+            spins = 0;
+        }
+        unsigned before = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        uint32_t bits = atomic_load_explicit(&s->value, memory_order_relaxed);
+        out->alarms = atomic_load_explicit(&s->alarms, memory_order_relaxed);
+        out->when_ms = atomic_load_explicit(&s->when_ms, memory_order_relaxed);
+        out->count = atomic_load_explicit(&s->count, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == before) {
+            memcpy(&out->value, &bits, sizeof(bits));
+            break;
+        }
+    }
+
+    out->type = (int)(key >> 32);
+    out->instance = (uint32_t)key;
+    return out->count > 0 ? 0 : -1;
+}
+
+// Escribe la línea de texto de un sensor (sin salto de línea). Devuelve su
+// longitud o -1 si no cabe.
+int snapshot_format(const snapshot_table *t, const snapshot_value *v, char *out, size_t size) {
+    static const char *alarm_names[DETECT_KINDS] = DETECT_KIND_NAMES;
+    char alarms[96] = "";
+    size_t len = 0;
+    for (int kind = 0; kind < DETECT_KINDS; kind++) {
+        if (v->alarms & (1u << kind)) {
+            len += (size_t)snprintf(alarms + len, sizeof(alarms) - len, "%s%s", len ? "," : "", alarm_names[kind]);
+        }
+    }
+    if (v->alarms & SNAPSHOT_OUT_OF_RANGE) {
+        snprintf(alarms + len, sizeof(alarms) - len, "%sout-of-range", len ? "," : "");
+    }
+
+    const char *name = v->type > 0 && v->type < SNAPSHOT_TYPES && t->names[v->type][0] ? t->names[v->type] : "-";
+    int n = snprintf(out, size, "type=%d name=%.*s instance=%u value=%f time_ms=%lld count=%llu alarms=%s",
+                     v->type, SNAPSHOT_NAME_LEN, name, v->instance, v->value, (long long)v->when_ms,
+                     (unsigned long long)v->count, alarms[0] ? alarms : "none");
+    return n < 0 || (size_t)n >= size ? -1 : n;
+}
+
+// Mapea sólo para lectura la tabla publicada por un monitor con -L y valida
+// su encabezado. Devuelve la tabla (y el tamaño del mapeo) o NULL.
+snapshot_table *snapshot_attach(const char *shm_name, size_t *size) {
+    int fd = shm_open(shm_name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(snapshot_table)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    snapshot_table *t = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (t == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (t->magic != SNAPSHOT_MAGIC || t->version != SNAPSHOT_VERSION || t->slot_size != sizeof(snapshot_slot) ||
+        t->capacity == 0 || (t->capacity & (t->capacity - 1)) != 0 ||
+        sizeof(snapshot_table) + (size_t)t->capacity * sizeof(snapshot_slot) > (size_t)st.st_size) {
+        munmap(t, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return t;
+}
+
+// Agrega al texto de la respuesta la línea de un sensor.
+static void append_sensor(FILE *out, const snapshot_slot *s) {
+    snapshot_value v;
+    char line[256];
+    if (snapshot_read(s, &v) == 0 && snapshot_format(snapshot_shared, &v, line, sizeof(line)) != -1) {
+        fprintf(out, "%s\n", line);
+    }
+}
+
+// Responde una petición ("get <tipo> <instancia>", "type <tipo>" o "all").
+static void answer(FILE *out, const char *request) {
+    snapshot_table *t = snapshot_shared;
+    int type;
+    unsigned int instance;
+    char extra;
+    if (sscanf(request, "get %d %u %c", &type, &instance, &extra) == 2) {
+        const snapshot_slot *s = snapshot_find(t, type, instance);
+        if (s) {
+            append_sensor(out, s);
+        }
+    } else if (sscanf(request, "type %d %c", &type, &extra) == 1 || strcmp(request, "all") == 0) {
+        int all = request[0] == 'a';
+        for (uint32_t i = 0; i < t->capacity; i++) {
+            uint64_t key = atomic_load_explicit(&t->slots[i].key, memory_order_acquire);
+            if (key != 0 && (all || (int)(key >> 32) == type)) {
+                append_sensor(out, &t->slots[i]);
+            }
+        }
+    } else {
+        fprintf(out, "error unknown request (get <type> <instance> | type <type> | all)\n");
+    }
+    fprintf(out, "end\n");
+}
+
+// Escribe todo el buffer (el socket tiene límite de tiempo de envío).
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Lee lo que mandó el cliente y responde cada petición completa.
+// Devuelve -1 si hay que cerrar la conexión.
+static int serve_client(snapshot_client *c) {
+    ssize_t n = read(c->fd, c->request + c->len, sizeof(c->request) - c->len);
+    if (n <= 0) {
+        return n == -1 && errno == EINTR ? 0 : -1;
+    }
+    c->len += (size_t)n;
+
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    if (out == NULL) {
+        return -1;
+    }
+
+    // Las peticiones que llegaron juntas se responden con una sola escritura.
+    size_t start = 0;
+    char *newline;
+    while ((newline = memchr(c->request + start, '\n', c->len - start)) != NULL) {
+        *newline = '\0';
+        if (newline > c->request + start && newline[-1] == '\r') {
+            newline[-1] = '\0';
+        }
+        answer(out, c->request + start);
+        start = (size_t)(newline - c->request) + 1;
+    }
+    fclose(out);
+    memmove(c->request, c->request + start, c->len - start);
+    c->len -= start;
+
+    int result = write_all(c->fd, text, text_len);
+    free(text);
+    if (c->len == sizeof(c->request)) {
+        return -1; // Petición demasiado larga
+    }
+    return result;
+}
+
+// Hilo de consultas: atiende varias conexiones a la vez, cada una con
+// peticiones de una línea. Sólo lee la tabla, nunca la modifica.
+static void *serve_loop(void *param) {
+    (void)param;
+    struct pollfd fds[2 + SNAPSHOT_CLIENTS];
+    snapshot_client clients[SNAPSHOT_CLIENTS];
+    for (int i = 0; i < SNAPSHOT_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    while (1) {
+        fds[0] = (struct pollfd){ .fd = stop_fd, .events = POLLIN };
+        fds[1] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        for (int i = 0; i < SNAPSHOT_CLIENTS; i++) {
+            fds[2 + i] = (struct pollfd){ .fd = clients[i].fd, .events = POLLIN };
+        }
+
+        int ready = poll(fds, 2 + SNAPSHOT_CLIENTS, -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error waiting for snapshot clients");
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+
+        for (int i = 0; i < SNAPSHOT_CLIENTS; i++) {
+            if (fds[2 + i].revents && serve_client(&clients[i]) == -1) {
+                close(clients[i].fd);
+                clients[i].fd = -1;
+            }
+        }
+
+        if (fds[1].revents) {
+            int client = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (client == -1) {
+                continue;
+            }
+            int free_slot = 0;
+            while (free_slot < SNAPSHOT_CLIENTS && clients[free_slot].fd != -1) {
+                free_slot++;
+            }
+            if (free_slot == SNAPSHOT_CLIENTS) {
+                close(client); // Demasiadas conexiones abiertas
+                continue;
+            }
+            // Un cliente que no lee no debe detener las demás consultas.
+            struct timeval limit = { 1, 0 };
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+            clients[free_slot].fd = client;
+            clients[free_slot].len = 0;
+        }
+    }
+
+    for (int i = 0; i < SNAPSHOT_CLIENTS; i++) {
+        if (clients[i].fd != -1) {
+            close(clients[i].fd);
+        }
+    }
+    return NULL;
+}
+
+// Abre el socket Unix de consultas y lanza el hilo que lo atiende.
+int snapshot_serve_start(const char *socket_path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (!snapshot_shared || strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Invalid snapshot socket path: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("Error creating the snapshot socket");
+        return -1;
+    }
+
+    // Un socket que quedó de una ejecución anterior impediría el bind.
+    struct stat st;
+    if (stat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(socket_path);
+    }
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listen_fd, 16) == -1) {
+        perror("Error listening on the snapshot socket");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd == -1 || pthread_create(&serve_thread, NULL, serve_loop, NULL) != 0) {
+        perror("Error starting the snapshot thread");
+        return -1;
+    }
+    serve_running = 1;
+    printf("Serving latest values on socket: '%s'\n", socket_path);
+    return 0;
+}
+
+// Detiene el hilo de consultas y cierra el socket.
+void snapshot_serve_stop(void) {
+    if (!serve_running) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) == -1) {
+        perror("Error stopping the snapshot thread");
+    }
+    pthread_join(serve_thread, NULL);
+    serve_running = 0;
+    close(stop_fd);
+    close(listen_fd);
+}
+
+// Libera la tabla y borra el segmento (los lectores que lo tienen mapeado
+// conservan la última foto).
+void snapshot_destroy(void) {
+    if (!snapshot_shared) {
+        return;
+    }
+    munmap(snapshot_shared, shared_size);
+    snapshot_shared = NULL;
+    if (shared_name) {
+        shm_unlink(shared_name);
+    }
+}
@@ -0,0 +1,95 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de la tabla del último valor de cada sensor
+**************************************************************/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// El monitor mantiene una tabla con la última lectura de cada sensor (tipo e
+// instancia): valor, hora y alarmas activas. La escriben los consumidores y
+// nunca esperan a los lectores:
+//   - Cada posición tiene un único escritor: las lecturas de un sensor siempre
+//     van a la misma parte del canal (channel_route), así que una posición sólo
+//     la escribe el consumidor de esa parte. Sólo el alta de un sensor nuevo
+//     usa un compare-and-swap sobre la clave (no se borran posiciones).
+//   - Cada posición es un seqlock: el consumidor deja seq impar mientras
+//     escribe y par al terminar; el lector repite la lectura si seq cambió.
+// La tabla se publica de dos formas (ambas opcionales):
+//   -L <nombre>  segmento de memoria compartida (shm_open) que los lectores
+//                mapean sólo para lectura; una consulta no hace llamadas al sistema.
+//   -Q <socket>  socket Unix de peticiones y respuestas de una línea:
+//                  get <tipo> <instancia> | type <tipo> | all
+//                cada respuesta son cero o más líneas de sensor y una línea "end"
+//                (o "error <motivo>" y "end"). Una conexión admite varias peticiones.
+
+#define SNAPSHOT_MAGIC 0x54414e53u // "SNAT"
+#define SNAPSHOT_VERSION 1         // Versión del formato del segmento
+#define SNAPSHOT_CAPACITY 16384    // Sensores de la tabla (potencia de 2, 1 MiB)
+#define SNAPSHOT_TYPES 256         // Tipos de sensor con nombre (igual que MAX_SENSOR_TYPES)
+#define SNAPSHOT_NAME_LEN 32       // Longitud máxima del nombre de un tipo
+
+// Bit de alarms que indica que la última lectura quedó fuera del rango del
+// tipo; los bits 0 .. DETECT_KINDS - 1 son las alertas activas de cada detector.
+#define SNAPSHOT_OUT_OF_RANGE (1u << 31)
+
+// Última lectura de un sensor (una línea de caché, así los consumidores de
+// partes distintas no comparten líneas)
+typedef struct {
+    _Alignas(64) atomic_uint_least64_t key; // (tipo << 32) | instancia; 0 = posición libre
+    atomic_uint seq;                        // Impar mientras el consumidor escribe
+    atomic_uint alarms;                     // Alertas activas (bit = detector) y SNAPSHOT_OUT_OF_RANGE
+    atomic_uint value;                      // Bits del último valor (float)
+    atomic_int_least64_t when_ms;           // Hora de la última lectura (ms desde la época)
+    atomic_uint_least64_t count;            // Lecturas del sensor (0 = todavía sin lectura)
+} snapshot_slot;
+
+// Encabezado del segmento, seguido de capacity posiciones
+typedef struct {
+    uint32_t magic;      // SNAPSHOT_MAGIC
+    uint32_t version;    // SNAPSHOT_VERSION
+    uint32_t capacity;   // Posiciones (potencia de 2)
+    uint32_t slot_size;  // sizeof(snapshot_slot)
+    int64_t started_ms;  // Hora de inicio del monitor
+    int32_t pid;         // PID del monitor
+    atomic_uint used;    // Posiciones ocupadas
+    char names[SNAPSHOT_TYPES][SNAPSHOT_NAME_LEN]; // Nombre de cada tipo ("" si no está configurado)
+    _Alignas(64) snapshot_slot slots[];
+} snapshot_table;
+
+// Copia coherente de una posición
+typedef struct {
+    int type;          // Tipo de sensor
+    uint32_t instance; // Instancia del sensor
+    float value;       // Último valor
+    int64_t when_ms;   // Hora de la última lectura
+    uint64_t count;    // Lecturas del sensor
+    uint32_t alarms;   // Alertas activas
+} snapshot_value;
+
+// Declaración de variables globales
+extern snapshot_table *snapshot_shared; // Tabla del monitor (NULL si no se publica)
+
+// Prototipos de funciones (monitor)
+int snapshot_create(const char *shm_name); // Crea la tabla (en memoria compartida si hay nombre)
+int snapshot_set_name(int type, const char *name); // Registra el nombre de un tipo
+snapshot_slot *snapshot_claim(snapshot_table *t, int type, uint32_t instance); // Posición del sensor (NULL si llena)
+void snapshot_publish(snapshot_slot *s, float value, int64_t when_ms, uint32_t alarms); // Escribe la lectura
+int snapshot_serve_start(const char *socket_path); // Atiende consultas por socket Unix
+void snapshot_serve_stop(void);                    // Detiene el socket
+void snapshot_destroy(void);                       // Libera la tabla y borra el segmento
+
+// Prototipos de funciones (lectores)
+snapshot_table *snapshot_attach(const char *shm_name, size_t *size); // Mapea un segmento sólo para lectura
+const snapshot_slot *snapshot_find(const snapshot_table *t, int type, uint32_t instance); // NULL si no está
+int snapshot_read(const snapshot_slot *s, snapshot_value *out); // Copia coherente; 0 o -1 si sin lectura
+int snapshot_format(const snapshot_table *t, const snapshot_value *v, char *out, size_t size); // Línea de texto
+
+#endif // SNAPSHOT_H
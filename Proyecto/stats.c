@@ -0,0 +1,236 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación de las estadísticas móviles y agregados por ventana de cada canal
+**************************************************************/
+
+#include "stats.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Configuración por defecto: ventana de 60 lecturas, alfa 0.1, sin agregados en archivo
+stats_config stats_settings = { 60, 0.1, 0 };
+
+// Duración y sufijo de archivo de cada ventana fija
+static const int64_t rollup_periods[ROLLUP_LEVELS] = { 1000, 60 * 1000, 60 * 60 * 1000 };
+static const char *rollup_suffixes[ROLLUP_LEVELS] = { "1s", "1m", "1h" };
+
+// Reserva la cola monótona con espacio para window + 1 candidatos.
+static int deque_init(mono_deque *q, size_t window) {
+    size_t capacity = 1;
+    while (capacity < window + 1) {
+        capacity <<= 1;
+    }
+    q->seq = malloc(capacity * sizeof(uint64_t));
+    q->value = malloc(capacity * sizeof(float));
+    q->mask = capacity - 1;
+    q->head = 0;
+    q->tail = 0;
+    return (q->seq && q->value) ? 0 : -1;
+}
+
+// Agrega un valor a la cola monótona y descarta los candidatos que salieron de la ventana.
+// Con is_max = 0 la cabeza es el mínimo de la ventana; con is_max = 1, el máximo.
+static void deque_push(mono_deque *q, uint64_t seq, float value, size_t window, int is_max) {
+    // Un candidato que nunca podrá ser el extremo se elimina desde el final.
+    while (q->tail != q->head) {
+        float back = q->value[(q->tail - 1) & q->mask];
+        if (is_max ? back > value : back < value) {
+            break;
+        }
+        q->tail--;
+    }
+    q->seq[q->tail & q->mask] = seq;
+    q->value[q->tail & q->mask] = value;
+    q->tail++;
+
+    // El extremo actual se descarta cuando sale de la ventana.
+    while (seq - q->seq[q->head & q->mask] >= window) {
+        q->head++;
+    }
+}
+
+// Escribe la ventana fija abierta como una línea del archivo de agregados.
+static void rollup_emit(rollup *r) {
+    if (r->count == 0) {
+        return;
+    }
+
+    size_t stamp_len;
+    const char *stamp = writer_stamp(&r->out, (time_t)(r->bucket_start / 1000), &stamp_len);
+    char line[192];
+    memcpy(line, stamp, stamp_len);
+    int n = snprintf(line + stamp_len, sizeof(line) - stamp_len,
+                     " count=%llu min=%f max=%f avg=%f last=%f\n", (unsigned long long)r->count,
+                     r->min, r->max, r->sum / r->count, r->last);
+    if (n > 0 && (size_t)n < sizeof(line) - stamp_len) {
+        writer_append(&r->out, line, stamp_len + (size_t)n);
+    }
+    r->count = 0;
+    r->sum = 0;
+}
+
+// Reserva las colas de la ventana deslizante y, si están habilitados, abre los archivos de agregados.
+int stats_init(channel_stats *st, const char *file) {
+    memset(st, 0, sizeof(*st));
+    if (stats_settings.window == 0 || deque_init(&st->window_min, stats_settings.window) == -1 ||
+        deque_init(&st->window_max, stats_settings.window) == -1) {
+        return -1;
+    }
+
+    st->rollups_enabled = stats_settings.rollups;
+    if (!st->rollups_enabled) {
+        return 0;
+    }
+
+    // Los agregados se escriben siempre en texto, aunque las lecturas estén en binario.
+    for (int i = 0; i < ROLLUP_LEVELS; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s.%s", file, rollup_suffixes[i]);
+        st->levels[i].period_ms = rollup_periods[i];
+        st->levels[i].bucket_start = -1;
+        if (writer_open_as(&st->levels[i].out, path, WRITER_FORMAT_TEXT) == -1) {
+            fprintf(stderr, "Error opening the rollup file: %s\n", path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Actualiza media, varianza, media exponencial y extremos de la ventana deslizante.
+void stats_add(channel_stats *st, float value) {
+    // Welford: actualización numéricamente estable de media y varianza.
+    st->total.count++;
+    double delta = value - st->total.mean;
+    st->total.mean += delta / (double)st->total.count;
+    st->total.m2 += delta * (value - st->total.mean);
+
+    // Media móvil exponencial.
+    if (st->ewma_ready) {
+        st->ewma += stats_settings.ewma_alpha * (value - st->ewma);
+    } else {
+        st->ewma = value;
+        st->ewma_ready = 1;
+    }
+
+    // Extremos de las últimas window lecturas.
+    deque_push(&st->window_min, st->seq, value, stats_settings.window, 0);
+    deque_push(&st->window_max, st->seq, value, stats_settings.window, 1);
+    st->seq++;
+}
+
+// Acumula una lectura aceptada en cada ventana fija, cerrando la anterior si ya terminó.
+void stats_rollup(channel_stats *st, int64_t when_ms, float value) {
+    if (!st->rollups_enabled) {
+        return;
+    }
+
+    st->fed = 1;
+    for (int i = 0; i < ROLLUP_LEVELS; i++) {
+        rollup *r = &st->levels[i];
+        int64_t bucket = when_ms - when_ms % r->period_ms;
+        if (bucket != r->bucket_start) {
+            rollup_emit(r);
+            r->bucket_start = bucket;
+        }
+
+        if (r->count == 0 || value < r->min) {
+            r->min = value;
+        }
+        if (r->count == 0 || value > r->max) {
+            r->max = value;
+        }
+        r->sum += value;
+        r->last = value;
+        r->count++;
+    }
+}
+
+// Milisegundos hasta que haya que cerrar una ventana fija o escribir un lote de agregados (-1 si nada).
+int stats_wait_ms(const channel_stats *st) {
+    if (!st->rollups_enabled) {
+        return -1;
+    }
+
+    int64_t now = writer_epoch_ms();
+    int wait = -1;
+    for (int i = 0; i < ROLLUP_LEVELS; i++) {
+        const rollup *r = &st->levels[i];
+        if (r->count > 0) {
+            int64_t end = st->fed_ms + ROLLUP_IDLE_MS;
+            if (r->bucket_start + r->period_ms > end) {
+                end = r->bucket_start + r->period_ms;
+            }
+            int64_t left = end - now;
+            int ms = left > 0 ? (int)left : 0;
+            if (wait == -1 || ms < wait) {
+                wait = ms;
+            }
+        }
+        int pending = writer_wait_ms(&r->out);
+        if (pending != -1 && (wait == -1 || pending < wait)) {
+            wait = pending;
+        }
+    }
+    return wait;
+}
+
+// Cierra las ventanas fijas que ya terminaron y escribe los lotes vencidos.
+// Una ventana vencida que sigue recibiendo lecturas (reinyectadas del diario)
+// espera a la primera posterior o a ROLLUP_IDLE_MS sin lecturas, para no partirse.
+void stats_flush(channel_stats *st) {
+    if (!st->rollups_enabled) {
+        return;
+    }
+
+    int64_t now = writer_epoch_ms();
+    if (st->fed) {
+        st->fed = 0;
+        st->fed_ms = now;
+    }
+    for (int i = 0; i < ROLLUP_LEVELS; i++) {
+        rollup *r = &st->levels[i];
+        if (r->count > 0 && now >= r->bucket_start + r->period_ms && now >= st->fed_ms + ROLLUP_IDLE_MS) {
+            rollup_emit(r);
+        }
+        if (writer_wait_ms(&r->out) == 0) {
+            writer_flush(&r->out);
+        }
+    }
+}
+
+// Escribe las ventanas abiertas, cierra los archivos de agregados y libera las colas.
+void stats_close(channel_stats *st) {
+    if (st->rollups_enabled) {
+        for (int i = 0; i < ROLLUP_LEVELS; i++) {
+            rollup_emit(&st->levels[i]);
+            writer_close(&st->levels[i].out);
+        }
+    }
+    free(st->window_min.seq);
+    free(st->window_min.value);
+    free(st->window_max.seq);
+    free(st->window_max.value);
+}
+
+// Varianza muestral de todas las lecturas.
+double stats_variance(const channel_stats *st) {
+    return st->total.count > 1 ? st->total.m2 / (double)(st->total.count - 1) : 0.0;
+}
+
+// Mínimo de la ventana deslizante (NAN si no hay lecturas).
+float stats_window_min(const channel_stats *st) {
+    const mono_deque *q = &st->window_min;
+    return q->head == q->tail ? NAN : q->value[q->head & q->mask];
+}
+
+// Máximo de la ventana deslizante (NAN si no hay lecturas).
+float stats_window_max(const channel_stats *st) {
+    const mono_deque *q = &st->window_max;
+    return q->head == q->tail ? NAN : q->value[q->head & q->mask];
+}
@@ -0,0 +1,81 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz de las estadísticas móviles y agregados por ventana de cada canal
+**************************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "writer.h"
+
+#define ROLLUP_LEVELS 3 // Ventanas fijas de agregación: 1 s, 1 min y 1 h
+#define ROLLUP_IDLE_MS 100 // Tiempo sin lecturas tras el cual se cierra una ventana vencida
+
+// Media y varianza acumuladas (algoritmo de Welford)
+typedef struct {
+    uint64_t count; // Lecturas acumuladas
+    double mean;    // Media
+    double m2;      // Suma de cuadrados de las diferencias con la media
+} welford;
+
+// Cola monótona de tamaño fijo para el mínimo o máximo de una ventana deslizante
+typedef struct {
+    uint64_t *seq; // Número de secuencia de cada candidato
+    float *value;  // Valor de cada candidato
+    size_t mask;   // Capacidad - 1 (potencia de 2)
+    size_t head;   // Primer candidato (el extremo actual)
+    size_t tail;   // Posición siguiente al último candidato
+} mono_deque;
+
+// Agregado de una ventana fija (1 s, 1 min o 1 h) que se escribe al cerrarse
+typedef struct {
+    int64_t period_ms;    // Duración de la ventana
+    int64_t bucket_start; // Inicio de la ventana abierta (-1 si no hay)
+    uint64_t count;       // Lecturas en la ventana abierta
+    double sum;           // Suma de la ventana abierta
+    float min, max;       // Extremos de la ventana abierta
+    float last;           // Último valor de la ventana abierta
+    batch_writer out;     // Archivo "<archivo>.1s", ".1m" o ".1h"
+} rollup;
+
+// Estadísticas de un canal, actualizadas en O(1) por lectura y sin reservar memoria
+typedef struct {
+    welford total;        // Media y varianza desde el inicio
+    double ewma;          // Media móvil exponencial
+    int ewma_ready;       // 1 cuando ewma tiene al menos una lectura
+    uint64_t seq;         // Lecturas vistas (posición en la ventana deslizante)
+    mono_deque window_min; // Mínimo de las últimas stats_settings.window lecturas
+    mono_deque window_max; // Máximo de las últimas stats_settings.window lecturas
+    int rollups_enabled;  // 1 si se escriben los agregados por ventana fija
+    rollup levels[ROLLUP_LEVELS];
+    int fed;              // 1 si recibió lecturas desde el último stats_flush
+    int64_t fed_ms;       // Último stats_flush que encontró lecturas nuevas
+} channel_stats;
+
+// Parámetros comunes a las estadísticas de todos los canales
+typedef struct {
+    size_t window;     // Lecturas de la ventana deslizante (por defecto 60)
+    double ewma_alpha; // Peso de la lectura nueva en la media exponencial (por defecto 0.1)
+    int rollups;       // 1 para escribir los agregados de 1 s, 1 min y 1 h
+} stats_config;
+
+// Declaración de variables globales
+extern stats_config stats_settings; // Configuración elegida en la línea de comandos
+
+// Prototipos de funciones
+int stats_init(channel_stats *st, const char *file);              // Reserva las colas y abre los agregados
+void stats_add(channel_stats *st, float value);                     // Acumula una lectura aceptada en las estadísticas móviles
+void stats_rollup(channel_stats *st, int64_t when_ms, float value); // Acumula una lectura aceptada en las ventanas fijas
+int stats_wait_ms(const channel_stats *st);                       // Vencimiento más próximo de los agregados
+void stats_flush(channel_stats *st);                              // Escribe los agregados vencidos
+void stats_close(channel_stats *st);                              // Cierra las ventanas y libera memoria
+double stats_variance(const channel_stats *st);                   // Varianza muestral
+float stats_window_min(const channel_stats *st);                  // Mínimo de la ventana deslizante
+float stats_window_max(const channel_stats *st);                  // Máximo de la ventana deslizante
+
+#endif // STATS_H
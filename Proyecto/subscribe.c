@@ -0,0 +1,124 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Manejo de subscribe.c (suscriptor de la difusión de lecturas del monitor)
+**************************************************************/
+
+#include "bcast.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_TYPES 256 // Identificadores de tipo válidos: 1 .. MAX_TYPES - 1
+
+static volatile sig_atomic_t stop = 0; // 1 al recibir SIGINT o SIGTERM
+
+// Manejador de SIGINT y SIGTERM: termina después de la muestra en curso.
+static void on_signal(int signal_number) {
+  (void)signal_number;
+  stop = 1;
+}
+
+// Instante monotónico en nanosegundos (el mismo reloj con el que el sensor marca el envío).
+static int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+  int flags;                     // Almacena las flags de los argumentos de línea de comandos
+  char *socket_path = NULL;      // Socket de suscripción del monitor
+  unsigned char wanted[MAX_TYPES] = { 0 }; // Tipos elegidos con -t
+  int filtered = 0;              // 1 si se eligió algún tipo
+  long limit = 0;                // Muestras a recibir antes de terminar (0 = sin límite)
+  long delay_us = 0;             // Pausa después de cada muestra (simula un suscriptor lento)
+  int quiet = 0;                 // 1 para mostrar sólo el resumen
+
+  while ((flags = getopt(argc, argv, "B:t:n:d:q")) != -1) {
+    switch (flags) {
+    case 'B': // Bandera del socket de suscripción del monitor
+      socket_path = optarg;
+      break;
+    case 't': { // Bandera de un tipo de sensor (puede repetirse)
+      int type = atoi(optarg);
+      if (type <= 0 || type >= MAX_TYPES) {
+        fprintf(stderr, "Error: Invalid sensor type '%s'\n", optarg);
+        return 1;
+      }
+      wanted[type] = 1;
+      filtered = 1;
+      break;
+    }
+    case 'n': // Bandera de muestras a recibir
+      limit = atol(optarg);
+      break;
+    case 'd': // Bandera de la pausa en microsegundos después de cada muestra
+      delay_us = atol(optarg);
+      break;
+    case 'q': // Bandera para mostrar sólo el resumen
+      quiet = 1;
+      break;
+    default: // Mensaje de uso en caso de argumentos incorrectos
+      fprintf(stderr, "Usage: %s -B <broadcast-socket> [-t <type>]... [-n <samples>] [-d <delay-us>] [-q]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (socket_path == NULL || limit < 0 || delay_us < 0) {
+    fprintf(stderr, "Usage: %s -B <broadcast-socket> [-t <type>]... [-n <samples>] [-d <delay-us>] [-q]\n",
+            argv[0]);
+    return 1;
+  }
+
+  bcast_subscriber sub;
+  if (bcast_subscribe(&sub, socket_path) == -1) {
+    fprintf(stderr, "Error subscribing to '%s': %s\n", socket_path, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  // Las muestras de los tipos no elegidos se saltan sin copiarlas a ningún lado.
+  long received = 0;
+  double latency_sum = 0;
+  long latency_count = 0;
+  bcast_sample s;
+  int status;
+  while (!stop && (limit == 0 || received < limit) && (status = bcast_next(&sub, &s, 200)) != -1) {
+    if (status == 0 || (filtered && (s.sensor_type <= 0 || s.sensor_type >= MAX_TYPES || !wanted[s.sensor_type]))) {
+      continue;
+    }
+    received++;
+
+    double latency_us = s.sent_ns > 0 ? (now_ns() - s.sent_ns) / 1e3 : -1;
+    if (latency_us >= 0) {
+      latency_sum += latency_us;
+      latency_count++;
+    }
+    if (!quiet) {
+      printf("type=%d instance=%u value=%f time_ms=%lld latency_us=%.1f\n", s.sensor_type, s.instance, s.value,
+             (long long)s.when_ms, latency_us);
+    }
+    if (delay_us > 0) {
+      usleep((useconds_t)delay_us);
+    }
+  }
+
+  // Resumen: las muestras perdidas son las que se pisaron mientras el suscriptor iba atrasado.
+  printf("received=%ld lost=%llu avg_latency_us=%.1f\n", received, (unsigned long long)sub.lost,
+         latency_count ? latency_sum / latency_count : 0.0);
+  bcast_unsubscribe(&sub);
+  return 0;
+}
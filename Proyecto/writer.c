@@ -0,0 +1,352 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Archivo: Implementación del escritor por lotes de los archivos de salida
+**************************************************************/
+
+#include "writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Configuración por defecto: lotes de 64 KiB o 100 ms, sin fdatasync, en texto
+writer_config writer_settings = { 64 * 1024, 100, WRITER_SYNC_NONE, WRITER_FORMAT_TEXT, 60000 };
+
+// Reloj monotónico en milisegundos.
+long long writer_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Reloj monotónico en nanosegundos.
+static long long writer_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Hora actual en milisegundos desde la época.
+int64_t writer_epoch_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Abre el archivo de salida en modo añadir con el formato configurado.
+int writer_open(batch_writer *w, const char *path) {
+    return writer_open_as(w, path, writer_settings.format);
+}
+
+// Abre el archivo de salida en modo añadir con el formato indicado y reserva el lote.
+int writer_open_as(batch_writer *w, const char *path, int format) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    return writer_attach(w, fd, format);
+}
+
+// Prepara el escritor sobre un descriptor ya abierto (que pasa a ser suyo) y reserva el lote.
+int writer_attach(batch_writer *w, int fd, int format) {
+    memset(w, 0, sizeof(*w));
+    w->stamp_second = (time_t)-1;
+    w->fd = fd;
+
+    // El archivo se abre en modo añadir: el tamaño parte de lo que ya tenía.
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        w->written = (uint64_t)st.st_size;
+    }
+
+    w->cap = writer_settings.batch_bytes;
+    w->buf = malloc(w->cap);
+    if (!w->buf) {
+        close(w->fd);
+        return -1;
+    }
+
+    // En formato binario las lecturas se agrupan en un bloque antes de pasar al lote.
+    if (format == WRITER_FORMAT_BINARY) {
+        w->block = malloc(sizeof(log_block_builder));
+        if (!w->block) {
+            free(w->buf);
+            close(w->fd);
+            return -1;
+        }
+        log_block_reset(w->block);
+    }
+    return 0;
+}
+
+// Escribe len bytes completos, repitiendo write() si la escritura es parcial.
+static int write_all(int fd, const char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error writing the output file");
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Registra la latencia de las primeras n lecturas pendientes (ya escritas) y las quita de la lista.
+static void latency_written(batch_writer *w, size_t n) {
+    if (!w->latency || n == 0) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    for (size_t i = 0; i < n; i++) {
+        int64_t elapsed = now_ns - w->pending_sent[i];
+        hist_record(w->latency, elapsed > 0 ? (uint64_t)elapsed : 0);
+        if (w->metrics) {
+            metric_observe(&w->metrics->latency, elapsed > 0 ? (uint64_t)elapsed : 0);
+        }
+    }
+
+    memmove(w->pending_sent, w->pending_sent + n, (w->pending_count - n) * sizeof(int64_t));
+    w->pending_count -= n;
+    w->pending_in_batch -= n;
+}
+
+// Escribe todo el lote pendiente con un solo write() (salvo escrituras parciales).
+static int writer_flush_batch(batch_writer *w) {
+    long long started = w->metrics && w->len > 0 ? writer_now_ns() : 0;
+    if (write_all(w->fd, w->buf, w->len) == -1) {
+        return -1;
+    }
+    w->written += w->len;
+
+    if (w->len > 0 && writer_settings.durability == WRITER_SYNC_DATA) {
+        fdatasync(w->fd);
+    }
+    if (started) {
+        // Métricas de la escritura: cantidad, bytes y duración (incluye fdatasync).
+        metric_add(&w->metrics->writes, 1);
+        metric_add(&w->metrics->bytes, w->len);
+        metric_observe(&w->metrics->write_time, (uint64_t)(writer_now_ns() - started));
+    }
+    w->len = 0;
+    w->batch_mark = 0;
+    latency_written(w, w->pending_in_batch);
+    return 0;
+}
+
+// Cierra el bloque binario abierto y lo pasa al lote.
+static int seal_block(batch_writer *w) {
+    if (!w->block || w->block->count == 0) {
+        return 0;
+    }
+
+    // El bloque se serializa directamente en el lote si cabe.
+    size_t size = log_block_size(w->block->count);
+    if (w->len + size > w->cap && writer_flush_batch(w) == -1) {
+        return -1;
+    }
+
+    int result = 0;
+    if (size > w->cap) {
+        char *tmp = malloc(size);
+        if (!tmp) {
+            return -1;
+        }
+        log_block_encode(w->block, tmp);
+        result = write_all(w->fd, tmp, size);
+        w->written += size;
+        free(tmp);
+        latency_written(w, w->pending_count);
+    } else {
+        if (w->len == 0) {
+            w->first_pending_ms = writer_now_ms();
+        }
+        w->len += log_block_encode(w->block, w->buf + w->len);
+        w->pending_in_batch = w->pending_count;
+        if (w->batch_mark == 0) {
+            w->batch_mark = w->block_mark;
+        }
+    }
+    w->block_mark = 0;
+    log_block_reset(w->block);
+    return result;
+}
+
+// Escribe el lote pendiente. En formato binario antes se cierra el bloque
+// abierto si ya cumplió su tiempo máximo.
+int writer_flush(batch_writer *w) {
+    if (w->block && w->block->count > 0 &&
+        writer_now_ms() - w->block_started_ms >= writer_settings.block_ms && seal_block(w) == -1) {
+        return -1;
+    }
+    return writer_flush_batch(w);
+}
+
+// Agrega bytes al lote; si no caben se escribe primero lo pendiente.
+int writer_append(batch_writer *w, const char *data, size_t len) {
+    if (w->len + len > w->cap && writer_flush_batch(w) == -1) {
+        return -1;
+    }
+    if (len > w->cap) {
+        // Un bloque mayor que el lote se escribe directamente.
+        w->written += len;
+        return write_all(w->fd, data, len);
+    }
+
+    if (w->len == 0) {
+        w->first_pending_ms = writer_now_ms();
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+    return 0;
+}
+
+// Devuelve la marca de tiempo "{YYYY-mm-dd HH:MM:SS}" del segundo indicado.
+// Sólo se recalcula con localtime/strftime cuando cambia el segundo.
+const char *writer_stamp(batch_writer *w, time_t when, size_t *len) {
+    if (when != w->stamp_second) {
+        struct tm tm_info;
+        localtime_r(&when, &tm_info);
+        w->stamp_len = strftime(w->stamp, sizeof(w->stamp), "{%Y-%m-%d %H:%M:%S}", &tm_info);
+        w->stamp_second = when;
+    }
+    *len = w->stamp_len;
+    return w->stamp;
+}
+
+// Agrega una lectura con el formato "{YYYY-mm-dd HH:MM:SS} valor\n".
+int writer_append_reading(batch_writer *w, time_t when, float value) {
+    size_t stamp_len;
+    writer_stamp(w, when, &stamp_len);
+
+    char line[96];
+    memcpy(line, w->stamp, w->stamp_len);
+    int n = snprintf(line + w->stamp_len, sizeof(line) - w->stamp_len, " %f\n", value);
+    if (n < 0 || (size_t)n >= sizeof(line) - w->stamp_len) {
+        return -1;
+    }
+    return writer_append(w, line, w->stamp_len + (size_t)n);
+}
+
+// Anota el instante de envío de una lectura que acaba de entrar al escritor.
+static void latency_pending(batch_writer *w, int64_t sent_ns, int in_batch) {
+    if (!w->latency || sent_ns == 0) {
+        return;
+    }
+    if (w->pending_count == w->pending_cap) {
+        w->untracked++;
+        return;
+    }
+    w->pending_sent[w->pending_count++] = sent_ns;
+    if (in_batch) {
+        w->pending_in_batch = w->pending_count;
+    }
+}
+
+// Agrega una lectura en el formato configurado. sent_ns es el instante de
+// envío en el sensor (0 si no se conoce) para medir la latencia hasta el write().
+// mark identifica la lectura para quien escribe (por ejemplo, su secuencia en el
+// diario de ingesta; 0 si no se usa): las marcas crecen con cada lectura y
+// writer_pending_mark dice desde cuál todavía no llegó al archivo.
+int writer_append_sample(batch_writer *w, int64_t when_ms, float value, int64_t sent_ns, uint64_t mark) {
+    if (!w->block) {
+        int result = writer_append_reading(w, (time_t)(when_ms / 1000), value);
+        latency_pending(w, sent_ns, 1);
+        if (result == 0 && w->batch_mark == 0) {
+            w->batch_mark = mark;
+        }
+        return result;
+    }
+
+    if (w->block->count == 0) {
+        w->block_started_ms = writer_now_ms();
+        w->block_mark = mark;
+    }
+    int full = log_block_add(w->block, when_ms, value);
+    latency_pending(w, sent_ns, 0);
+    if (full) {
+        return seal_block(w);
+    }
+    return 0;
+}
+
+// Activa la medición de latencia: cada lectura con instante de envío se
+// registra en latency cuando el lote que la contiene se escribe.
+int writer_track_latency(batch_writer *w, histogram *latency) {
+    // Cabe una lectura cada 8 bytes del lote más un bloque binario completo.
+    w->pending_cap = w->cap / 8 + LOG_BLOCK_MAX;
+    w->pending_sent = malloc(w->pending_cap * sizeof(int64_t));
+    if (!w->pending_sent) {
+        w->pending_cap = 0;
+        return -1;
+    }
+    w->latency = latency;
+    return 0;
+}
+
+// Activa las métricas en vivo de las escrituras del archivo.
+void writer_track_metrics(batch_writer *w, writer_metrics *metrics) {
+    w->metrics = metrics;
+}
+
+// Milisegundos que faltan para que el lote pendiente (o el bloque abierto)
+// deba escribirse, o -1 si no hay nada pendiente.
+int writer_wait_ms(const batch_writer *w) {
+    long long deadline = -1;
+    if (w->len > 0) {
+        deadline = w->first_pending_ms + writer_settings.flush_ms;
+    }
+    if (w->block && w->block->count > 0) {
+        long long block_deadline = w->block_started_ms + writer_settings.block_ms;
+        if (deadline == -1 || block_deadline < deadline) {
+            deadline = block_deadline;
+        }
+    }
+    if (deadline == -1) {
+        return -1;
+    }
+
+    long long left = deadline - writer_now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+// Tamaño del archivo contando el lote pendiente (no el bloque binario abierto).
+uint64_t writer_size(const batch_writer *w) {
+    return w->written + w->len;
+}
+
+// Marca de la lectura más antigua que todavía no se escribió (en el lote o en
+// el bloque abierto), o 0 si todo lo agregado ya está en el archivo.
+uint64_t writer_pending_mark(const batch_writer *w) {
+    return w->batch_mark ? w->batch_mark : w->block_mark;
+}
+
+// Escribe lo pendiente, sincroniza si corresponde y cierra el archivo.
+int writer_close(batch_writer *w) {
+    int result = seal_block(w);
+    if (writer_flush_batch(w) == -1) {
+        result = -1;
+    }
+    close(w->fd);
+    free(w->buf);
+    free(w->block);
+    free(w->pending_sent);
+    w->buf = NULL;
+    w->block = NULL;
+    w->pending_sent = NULL;
+    w->fd = -1;
+    return result;
+}
@@ -0,0 +1,82 @@
+/*************************************************************
+Autores: Juan David Rincón - Juan Felipe Morales
+Fecha: 18 de octubre de 2026
+Materia: Sistemas Operativos
+Tema: Proyecto
+Fichero: Interfaz del escritor por lotes de los archivos de salida
+**************************************************************/
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "hist.h"
+#include "logfmt.h"
+#include "metrics.h"
+
+// Modos de durabilidad de cada lote escrito
+#define WRITER_SYNC_NONE 0  // Sólo write(); el kernel decide cuándo llega al disco
+#define WRITER_SYNC_DATA 1  // fdatasync() después de cada lote
+
+// Formatos de los archivos de salida
+#define WRITER_FORMAT_TEXT 0   // Líneas "{YYYY-mm-dd HH:MM:SS} valor"
+#define WRITER_FORMAT_BINARY 1 // Bloques por columnas (ver logfmt.h)
+
+// Parámetros comunes a todos los escritores del monitor
+typedef struct {
+    size_t batch_bytes; // Tamaño del lote que provoca una escritura (por defecto 64 KiB)
+    int flush_ms;       // Tiempo máximo que una lectura espera en memoria (por defecto 100 ms)
+    int durability;     // WRITER_SYNC_NONE o WRITER_SYNC_DATA
+    int format;         // WRITER_FORMAT_TEXT o WRITER_FORMAT_BINARY
+    int block_ms;       // Tiempo máximo que un bloque binario permanece abierto (por defecto 60 s)
+} writer_config;
+
+// Escritor que acumula líneas en memoria y las escribe con un solo write()
+typedef struct {
+    int fd;                   // Descriptor del archivo de salida
+    char *buf;                // Lote pendiente de escribir
+    size_t len;               // Bytes pendientes en el lote
+    size_t cap;               // Capacidad del lote
+    uint64_t written;         // Bytes del archivo ya escritos (incluye lo que tenía al abrirlo)
+    long long first_pending_ms; // Momento en que entró la primera línea pendiente
+    time_t stamp_second;      // Segundo al que corresponde stamp
+    char stamp[24];           // Marca de tiempo "{YYYY-mm-dd HH:MM:SS}" en caché
+    size_t stamp_len;         // Longitud de stamp
+    log_block_builder *block; // Bloque binario abierto (NULL en formato texto)
+    long long block_started_ms; // Momento en que se abrió el bloque binario
+    histogram *latency;       // Latencia de extremo a extremo de las lecturas escritas (NULL si no se mide)
+    int64_t *pending_sent;    // Instante de envío de cada lectura aún no escrita, en orden
+    size_t pending_count;     // Lecturas pendientes con instante de envío
+    size_t pending_in_batch;  // Cuántas de ellas ya están en el lote (el resto en el bloque abierto)
+    size_t pending_cap;       // Capacidad de pending_sent
+    unsigned long untracked;  // Lecturas cuya latencia no se pudo registrar
+    writer_metrics *metrics;  // Métricas en vivo de las escrituras (NULL si no se exportan)
+    uint64_t batch_mark;      // Marca de la primera lectura del lote pendiente (0 si no hay)
+    uint64_t block_mark;      // Marca de la primera lectura del bloque abierto (0 si no hay)
+} batch_writer;
+
+// Declaración de variables globales
+extern writer_config writer_settings; // Configuración elegida en la línea de comandos
+
+// Prototipos de funciones
+int writer_open(batch_writer *w, const char *path); // Abre el archivo en modo añadir con el formato configurado
+int writer_open_as(batch_writer *w, const char *path, int format); // Igual, con un formato explícito
+int writer_attach(batch_writer *w, int fd, int format); // Igual, sobre un descriptor ya abierto
+const char *writer_stamp(batch_writer *w, time_t when, size_t *len); // "{YYYY-mm-dd HH:MM:SS}" en caché
+int writer_append(batch_writer *w, const char *data, size_t len); // Agrega bytes al lote
+int writer_append_reading(batch_writer *w, time_t when, float value); // Agrega "{fecha} valor\n"
+int writer_append_sample(batch_writer *w, int64_t when_ms, float value, int64_t sent_ns,
+                         uint64_t mark); // Agrega una lectura
+int writer_track_latency(batch_writer *w, histogram *latency); // Mide la latencia hasta que cada lectura se escribe
+void writer_track_metrics(batch_writer *w, writer_metrics *metrics); // Exporta escrituras, bytes y tiempos
+int writer_flush(batch_writer *w);              // Escribe el lote pendiente
+int writer_wait_ms(const batch_writer *w);      // Milisegundos hasta el próximo vencimiento (-1 si vacío)
+uint64_t writer_size(const batch_writer *w);    // Tamaño del archivo contando el lote pendiente
+uint64_t writer_pending_mark(const batch_writer *w); // Marca de la lectura más antigua sin escribir (0 si no hay)
+int writer_close(batch_writer *w);              // Escribe lo pendiente y cierra el archivo
+long long writer_now_ms(void);                  // Reloj monotónico en milisegundos
+int64_t writer_epoch_ms(void);                  // Hora actual en milisegundos desde la época
+
+#endif // WRITER_H